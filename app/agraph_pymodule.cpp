@@ -22,6 +22,7 @@
 
 #include <bingocpp/agraph/agraph.h>
 #include <bingocpp/equation.h>
+#include <bingocpp/population_evaluator.h>
 #include <python/py_equation.h>
 
 namespace py = pybind11;
@@ -44,9 +45,12 @@ void add_agraph_class(py::module &parent) {
   py::class_<AGraph, bingo::Equation>(parent, "AGraph")
     .def(py::init<bool>(), py::arg("use_simplification")=false)
     .def_property_readonly_static("engine", [](py::object /* self */) { return "c++"; })
+    // a copy: the array may be shared with other AGraphs
     .def_property("command_array",
-                  &AGraph::GetCommandArray,
+                  py::cpp_function(&AGraph::GetCommandArray,
+                                   py::return_value_policy::copy),
                   &AGraph::SetCommandArray)
+    // a view, valid until the AGraph is next evaluated or its array set
     .def_property("mutable_command_array",
                   &AGraph::GetCommandArrayModifiable,
                   &AGraph::SetCommandArray)
@@ -76,6 +80,7 @@ void add_agraph_class(py::module &parent) {
     .def("set_local_optimization_params", py::overload_cast<Eigen::VectorXd>(&AGraph::SetLocalOptimizationParamsV), py::arg("params"))
     .def("set_local_optimization_params", py::overload_cast<Eigen::ArrayXXd>(&AGraph::SetLocalOptimizationParamsA), py::arg("params"))
     .def("evaluate_equation_at", &AGraph::EvaluateEquationAt, py::arg("x"))
+    .def("evaluate_equation_at", &AGraph::EvaluateEquationSingleAt, py::arg("x"))
     .def("evaluate_equation_with_x_gradient_at",
         &AGraph::EvaluateEquationWithXGradientAt,
         py::arg("x"))
@@ -88,7 +93,48 @@ void add_agraph_class(py::module &parent) {
     .def("get_complexity", &AGraph::GetComplexity)
     .def("distance", &AGraph::Distance, py::arg("chromosome"))
     .def("copy", &AGraph::Copy)
+    .def("compact", &AGraph::Compact)
+    .def_property_readonly("is_compact", &AGraph::IsCompact)
+    .def_static("set_jit_threshold", &AGraph::SetJitThreshold,
+                py::arg("num_evaluations"))
+    .def_static("get_jit_threshold", &AGraph::GetJitThreshold)
+    .def_property("subexpression_cache", &AGraph::GetSubexpressionCache,
+                  &AGraph::SetSubexpressionCache)
+    .def_static("set_row_caching", &AGraph::SetRowCaching,
+                py::arg("enabled"))
+    .def_static("get_row_caching", &AGraph::GetRowCaching)
+    .def_static("set_forward_tape_budget", &AGraph::SetForwardTapeBudget,
+                py::arg("bytes"))
+    .def_static("get_forward_tape_budget", &AGraph::GetForwardTapeBudget)
     .def("__getstate__", &AGraph::DumpState)
     .def("__setstate__", [](AGraph &ag, const AGraphState &state) {
             new (&ag) AGraph(state); });
-}
\ No newline at end of file
+
+  py::class_<PopulationEvaluator>(parent, "PopulationEvaluator")
+    .def(py::init<int>(), py::arg("num_threads") = 1)
+    .def("evaluate_population_at",
+         py::overload_cast<const std::vector<AGraph *> &,
+                           const Eigen::ArrayXXd &>(
+             &PopulationEvaluator::EvaluatePopulationAt),
+         py::arg("population"), py::arg("x"),
+         py::call_guard<py::gil_scoped_release>())
+    .def("evaluate_population_fitness",
+         py::overload_cast<const std::vector<AGraph *> &,
+                           const FitnessFunction &>(
+             &PopulationEvaluator::EvaluatePopulationFitness),
+         py::arg("population"), py::arg("fitness_function"),
+         py::call_guard<py::gil_scoped_release>())
+    .def("evaluate_population_fitness_and_gradient",
+         py::overload_cast<const std::vector<AGraph *> &,
+                           const GradientMixin &>(
+             &PopulationEvaluator::EvaluatePopulationFitnessAndGradient),
+         py::arg("population"), py::arg("fitness_function"),
+         py::call_guard<py::gil_scoped_release>())
+    .def_property_readonly("num_threads",
+                           &PopulationEvaluator::GetNumThreads)
+    .def_property("subexpression_cache",
+                  &PopulationEvaluator::GetSubexpressionCache,
+                  &PopulationEvaluator::SetSubexpressionCache)
+    .def_property_readonly("num_evaluated",
+                           &PopulationEvaluator::GetNumEvaluated);
+}
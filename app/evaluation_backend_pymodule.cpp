@@ -14,6 +14,8 @@
  * License for the specific language governing permissions and limitations under
  * the License.
  */
+#include <stdexcept>
+
 #include <pybind11/pybind11.h>
 #include <pybind11/eigen.h>
 #include <pybind11/stl.h>
@@ -21,6 +23,8 @@
 #include <Eigen/Dense>
 
 #include "bingocpp/agraph/evaluation_backend/evaluation_backend.h"
+#include "bingocpp/agraph/evaluation_backend/jit_compiler.h"
+#include "bingocpp/agraph/evaluation_backend/subexpression_cache.h"
 
 namespace py = pybind11;
 using namespace bingo;
@@ -30,15 +34,178 @@ void add_evaluation_backend_submodule(py::module &parent)
       py::module m = parent.def_submodule("evaluation_backend",
                                           "The evaluation backend for Agraphs");
       m.attr("ENGINE") = "c++";
-      m.def("evaluate", &evaluation_backend::Evaluate, "Evaluate an equation",
+      py::enum_<evaluation_backend::Accuracy>(m, "Accuracy")
+          .value("STRICT", evaluation_backend::kStrict)
+          .value("FAST", evaluation_backend::kFast);
+      py::enum_<evaluation_backend::Precision>(m, "Precision")
+          .value("DOUBLE", evaluation_backend::kDouble)
+          .value("SINGLE", evaluation_backend::kSingle);
+      py::enum_<evaluation_backend::DerivativeMode>(m, "DerivativeMode")
+          .value("AUTOMATIC", evaluation_backend::kAutomatic)
+          .value("FORWARD", evaluation_backend::kForwardMode)
+          .value("REVERSE", evaluation_backend::kReverseMode);
+      m.def("evaluate",
+            [](const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+               const Eigen::Ref<const Eigen::ArrayXXd> &x,
+               const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+               evaluation_backend::Accuracy accuracy,
+               int num_threads) {
+                  evaluation_backend::EvaluationWorkspace workspace;
+                  workspace.SetAccuracy(accuracy);
+                  workspace.SetNumThreads(num_threads);
+                  return Eigen::ArrayXXd(evaluation_backend::Evaluate(
+                      stack, x, constants, workspace));
+            },
+            "Evaluate an equation",
+            py::arg("stack"),
+            py::arg("x"),
+            py::arg("constants"),
+            py::arg("accuracy") = evaluation_backend::kStrict,
+            py::arg("num_threads") = 1);
+      // float32 arrays match this overload without being converted
+      m.def("evaluate",
+            [](const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+               const Eigen::Ref<const Eigen::ArrayXXf> &x,
+               const Eigen::Ref<const Eigen::ArrayXXd> &constants) {
+                  evaluation_backend::EvaluationWorkspace workspace;
+                  return Eigen::ArrayXXf(evaluation_backend::EvaluateSingle(
+                      stack, x, constants, workspace));
+            },
+            "Evaluate an equation in single precision",
             py::arg("stack"),
             py::arg("x"),
             py::arg("constants"));
       m.def("evaluate_with_derivative",
-            &evaluation_backend::EvaluateWithDerivative,
+            [](const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+               const Eigen::Ref<const Eigen::ArrayXXd> &x,
+               const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+               const bool wrt_param_x_or_c,
+               evaluation_backend::Accuracy accuracy,
+               int num_threads,
+               evaluation_backend::DerivativeMode derivative_mode) {
+                  evaluation_backend::EvaluationWorkspace workspace;
+                  workspace.SetAccuracy(accuracy);
+                  workspace.SetNumThreads(num_threads);
+                  workspace.SetDerivativeMode(derivative_mode);
+                  return EvalAndDerivative(
+                      evaluation_backend::EvaluateWithDerivative(
+                          stack, x, constants, wrt_param_x_or_c, workspace));
+            },
             "Evaluate equation and take derivative",
             py::arg("stack"),
             py::arg("x"),
             py::arg("constants"),
-            py::arg("wrt_param_x_or_c"));
-}
\ No newline at end of file
+            py::arg("wrt_param_x_or_c"),
+            py::arg("accuracy") = evaluation_backend::kStrict,
+            py::arg("num_threads") = 1,
+            py::arg("derivative_mode") = evaluation_backend::kAutomatic);
+      m.def("evaluate_constant_sets",
+            [](const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+               const Eigen::Ref<const Eigen::ArrayXXd> &x,
+               const Eigen::Ref<const Eigen::ArrayXXd> &constant_sets,
+               evaluation_backend::Accuracy accuracy,
+               int num_threads) {
+                  evaluation_backend::EvaluationWorkspace workspace;
+                  workspace.SetAccuracy(accuracy);
+                  workspace.SetNumThreads(num_threads);
+                  return EvalAndDerivative(
+                      evaluation_backend::EvaluateConstantSets(
+                          stack, x, constant_sets, workspace));
+            },
+            "Evaluate equation and constant Jacobian for every column of constants",
+            py::arg("stack"),
+            py::arg("x"),
+            py::arg("constant_sets"),
+            py::arg("accuracy") = evaluation_backend::kStrict,
+            py::arg("num_threads") = 1);
+      m.def("evaluate_vector_jacobian_product",
+            [](const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+               const Eigen::Ref<const Eigen::ArrayXXd> &x,
+               const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+               const Eigen::Ref<const Eigen::ArrayXd> &weights,
+               evaluation_backend::Accuracy accuracy) {
+                  if (weights.size() != x.rows())
+                  {
+                        throw std::invalid_argument(
+                            "weights must have one value per sample of x");
+                  }
+                  evaluation_backend::EvaluationWorkspace workspace;
+                  workspace.SetAccuracy(accuracy);
+                  return EvalAndDerivative(
+                      evaluation_backend::EvaluateVectorJacobianProduct(
+                          stack, x, constants,
+                          [&](int start,
+                              const Eigen::Ref<const Eigen::ArrayXXd> &values,
+                              Eigen::Ref<Eigen::ArrayXd> seed) {
+                                seed = weights.segment(start, values.rows());
+                          },
+                          workspace));
+            },
+            "Evaluate equation and the weighted sum of its constant derivatives",
+            py::arg("stack"),
+            py::arg("x"),
+            py::arg("constants"),
+            py::arg("weights"),
+            py::arg("accuracy") = evaluation_backend::kStrict);
+      m.def("evaluate_batch",
+            [](const std::vector<Eigen::ArrayX3i> &stacks,
+               const Eigen::Ref<const Eigen::ArrayXXd> &x,
+               const std::vector<Eigen::ArrayXXd> &constants,
+               evaluation_backend::Accuracy accuracy) {
+                  evaluation_backend::EvaluationWorkspace workspace;
+                  workspace.SetAccuracy(accuracy);
+                  std::vector<Eigen::ArrayXXd> values;
+                  evaluation_backend::EvaluateBatch(stacks, x, constants,
+                                                    values, workspace);
+                  return values;
+            },
+            "Evaluate many equations, identical stacks in lock-step",
+            py::arg("stacks"),
+            py::arg("x"),
+            py::arg("constants"),
+            py::arg("accuracy") = evaluation_backend::kStrict);
+      py::class_<evaluation_backend::SubexpressionCache,
+                 std::shared_ptr<evaluation_backend::SubexpressionCache>>(
+          m, "SubexpressionCache")
+          .def(py::init<std::size_t>(),
+               py::arg("memory_budget") =
+                   evaluation_backend::kDefaultSubexpressionBudget)
+          .def("new_generation",
+               &evaluation_backend::SubexpressionCache::NewGeneration)
+          .def("clear", &evaluation_backend::SubexpressionCache::Clear)
+          .def_property_readonly(
+              "memory_budget",
+              &evaluation_backend::SubexpressionCache::GetMemoryBudget)
+          .def_property_readonly(
+              "memory_usage",
+              &evaluation_backend::SubexpressionCache::GetMemoryUsage)
+          .def_property_readonly(
+              "num_hits", &evaluation_backend::SubexpressionCache::GetNumHits)
+          .def_property_readonly(
+              "num_misses",
+              &evaluation_backend::SubexpressionCache::GetNumMisses);
+      m.def("set_num_threads",
+            [](int num_threads, int parallel_threshold) {
+                  evaluation_backend::EvaluationWorkspace &workspace =
+                      evaluation_backend::ThreadWorkspace();
+                  workspace.SetNumThreads(num_threads);
+                  workspace.SetParallelThreshold(parallel_threshold);
+            },
+            "Split AGraph evaluations made from this thread over threads",
+            py::arg("num_threads"),
+            py::arg("parallel_threshold") =
+                evaluation_backend::kDefaultParallelThreshold);
+      m.def("set_memory_budget",
+            [](std::size_t bytes) {
+                  evaluation_backend::ThreadWorkspace().SetMemoryBudget(bytes);
+            },
+            "Bound the buffers of AGraph evaluations made from this thread",
+            py::arg("bytes"));
+      m.def("set_jit_compiler", &evaluation_backend::SetJitCompiler,
+            "Set the command used to compile AGraphs to native code",
+            py::arg("command"));
+      m.def("set_jit_cache_capacity", &evaluation_backend::SetJitCacheCapacity,
+            "Set the number of AGraphs kept compiled to native code",
+            py::arg("capacity"));
+      m.def("get_jit_cache_capacity", &evaluation_backend::GetJitCacheCapacity);
+}
@@ -3,6 +3,7 @@
 #include <bingocpp/agraph/agraph.h>
 #include <bingocpp/explicit_regression.h>
 #include <bingocpp/implicit_regression.h>
+#include <bingocpp/population_evaluator.h>
 #include <bingocpp/utils.h>
 
 #include <benchmarking/benchmark_data.h>
@@ -10,11 +11,15 @@
 
 #define EXPLICIT "explicit regression"
 #define IMPLICIT "implicit regression"
+#define PARALLEL_EXPLICIT "explicit regression (pool)"
+#define PARALLEL_IMPLICIT "implicit regression (pool)"
 
 using namespace bingo;
 
 void BenchmarkRegression(std::vector<AGraph> &agraph_list,
                          const VectorBasedFunction &fitness_function);
+void BenchmarkParallelRegression(std::vector<AGraph> &agraph_list,
+                                 const VectorBasedFunction &fitness_function);
 Eigen::ArrayXd TimeBenchmark(
     void (*benchmark)(std::vector<AGraph>&, const VectorBasedFunction &),
     BenchmarkTestData &test_data,
@@ -49,9 +54,16 @@ void RunRegressionBenchmarks(BenchmarkTestData &benchmark_test_data) {
   Eigen::ArrayXd implicit_times = TimeBenchmark(
     BenchmarkRegression, benchmark_test_data, i_regression);
 
+  Eigen::ArrayXd parallel_explicit_times = TimeBenchmark(
+    BenchmarkParallelRegression, benchmark_test_data, e_regression);
+  Eigen::ArrayXd parallel_implicit_times = TimeBenchmark(
+    BenchmarkParallelRegression, benchmark_test_data, i_regression);
+
   PrintHeader("REGRESSION BENCHMARKS");
   PrintResults(explicit_times, EXPLICIT);
   PrintResults(implicit_times, IMPLICIT);
+  PrintResults(parallel_explicit_times, PARALLEL_EXPLICIT);
+  PrintResults(parallel_implicit_times, PARALLEL_IMPLICIT);
   delete i_training_data;
   delete e_training_data;
 }
@@ -79,4 +91,14 @@ void BenchmarkRegression(std::vector<AGraph> &agraph_list,
   for(indv = agraph_list.begin(); indv != agraph_list.end(); indv ++) {
     fitness_function.EvaluateIndividualFitness(*indv);
   }
-}
\ No newline at end of file
+}
+
+void BenchmarkParallelRegression(std::vector<AGraph> &agraph_list,
+                                 const VectorBasedFunction &fitness_function) {
+  // one thread per core
+  static PopulationEvaluator evaluator(0);
+  for (AGraph &indv : agraph_list) {
+    indv.SetFitnessStatus(false);
+  }
+  evaluator.EvaluatePopulationFitness(agraph_list, fitness_function);
+}
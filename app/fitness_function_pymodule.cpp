@@ -4,6 +4,7 @@
 
 #include <Eigen/Dense>
 
+#include <bingocpp/fitness_cache.h>
 #include <bingocpp/fitness_function.h>
 #include <bingocpp/training_data.h>
 #include <python/py_fitness_function.h>
@@ -17,7 +18,9 @@ void add_fitness_classes(py::module &parent) {
          py::arg("training_data") = py::none())
     .def("__call__", &FitnessFunction::EvaluateIndividualFitness)
     .def_property("eval_count", &FitnessFunction::GetEvalCount, &FitnessFunction::SetEvalCount)
-    .def_property("training_data", &FitnessFunction::GetTrainingData, &FitnessFunction::SetTrainingData);
+    .def_property("training_data", &FitnessFunction::GetTrainingData, &FitnessFunction::SetTrainingData)
+    .def_property("accuracy", &FitnessFunction::GetAccuracy, &FitnessFunction::SetAccuracy)
+    .def_property("precision", &FitnessFunction::GetPrecision, &FitnessFunction::SetPrecision);
 
   py::class_<TrainingData, PyTrainingData /* trampoline */>(parent, "TrainingData")
     .def(py::init<>())
@@ -31,5 +34,15 @@ void add_fitness_classes(py::module &parent) {
          py::arg("training_data") = py::none(),
          py::arg("metric") = "mae")
     .def("__call__", &VectorBasedFunction::EvaluateIndividualFitness)
-    .def("evaluate_fitness_vector", &VectorBasedFunction::EvaluateFitnessVector);
+    .def("evaluate_fitness_vector", &VectorBasedFunction::EvaluateFitnessVector)
+    .def_property("fitness_cache", &VectorBasedFunction::GetFitnessCache, &VectorBasedFunction::SetFitnessCache);
+
+  py::class_<FitnessCache, std::shared_ptr<FitnessCache>>(parent, "FitnessCache")
+    .def(py::init<std::size_t>(),
+         py::arg("capacity") = kDefaultFitnessCacheCapacity)
+    .def("clear", &FitnessCache::Clear)
+    .def_property_readonly("capacity", &FitnessCache::GetCapacity)
+    .def("__len__", &FitnessCache::GetSize)
+    .def_property_readonly("num_hits", &FitnessCache::GetNumHits)
+    .def_property_readonly("num_misses", &FitnessCache::GetNumMisses);
 }
\ No newline at end of file
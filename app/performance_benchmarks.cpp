@@ -1,23 +1,76 @@
+#include <atomic>
 #include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <vector>
 
 #include <benchmarking/benchmark_data.h>
 #include <benchmarking/benchmark_logging.h>
+#include <bingocpp/agraph/evaluation_backend/subexpression_cache.h>
+#include <bingocpp/agraph/operator_definitions.h>
+#include <bingocpp/population_evaluator.h>
 
 #define EVALUATE "pure c++: evaluate"
 #define X_DERIVATIVE "pure c++: x derivative"
 #define C_DERIVATIVE "pure c++: c derivative"
+#define WORKSPACE_EVALUATE "pure c++: evaluate (ws)"
+#define FAST_EVALUATE "pure c++: evaluate (fast)"
+#define POPULATION_EVALUATE "pure c++: evaluate (pop)"
+#define OFFSPRING_EVALUATE "pure c++: offspring"
+#define SHARED_EVALUATE "pure c++: offspring (cse)"
+// Shared subexpressions only pay off once columns are longer than the
+// benchmark data, so the offspring benchmarks repeat it
+#define OFFSPRING_DATA_REPEATS 16
+
+#if defined(__GLIBC__)
+// Count heap allocations, including Eigen's, by interposing malloc
+namespace {
+std::atomic<long> allocation_count(0);
+}
+
+extern "C" void *__libc_malloc(std::size_t size);
+extern "C" void *__libc_realloc(void *ptr, std::size_t size);
+
+extern "C" void *malloc(std::size_t size) {
+  ++allocation_count;
+  return __libc_malloc(size);
+}
+
+extern "C" void *realloc(void *ptr, std::size_t size) {
+  ++allocation_count;
+  return __libc_realloc(ptr, size);
+}
+
+#define COUNTS_ALLOCATIONS 1
+#endif
 
 void DoBenchmarking();
 Eigen::ArrayXd TimeBenchmark(
   void (*benchmark)(const std::vector<AGraph>&, const Eigen::ArrayXXd&), 
   const BenchmarkTestData &test_data, int number=100, int repeat=10);
+Eigen::ArrayXd CountAllocations(
+  void (*benchmark)(const std::vector<AGraph>&, const Eigen::ArrayXXd&),
+  const BenchmarkTestData &test_data, int repeat=10);
 void RunBenchmarks(const BenchmarkTestData &benchmark_test_data);
+void RunAllocationBenchmarks(const BenchmarkTestData &benchmark_test_data);
 void BenchmarkEvaluate(const std::vector<AGraph> &indv_list,
                        const Eigen::ArrayXXd &x_vals);
 void BenchmarkEvaluateAndXDerivative(const std::vector<AGraph> &indv_list,
                                      const Eigen::ArrayXXd &x_vals);
 void BenchmarkEvaluateAndCDerivative(const std::vector<AGraph> &indv_list,
                                      const Eigen::ArrayXXd &x_vals);
+void BenchmarkWorkspaceEvaluate(const std::vector<AGraph> &indv_list,
+                                const Eigen::ArrayXXd &x_vals);
+void BenchmarkFastEvaluate(const std::vector<AGraph> &indv_list,
+                           const Eigen::ArrayXXd &x_vals);
+void BenchmarkPopulationEvaluate(const std::vector<AGraph> &indv_list,
+                                 const Eigen::ArrayXXd &x_vals);
+std::vector<AGraph> MakeOffspringPopulation(
+  const std::vector<AGraph> &indv_list);
+void BenchmarkOffspringEvaluate(const std::vector<AGraph> &indv_list,
+                                const Eigen::ArrayXXd &x_vals);
+void BenchmarkSharedEvaluate(const std::vector<AGraph> &indv_list,
+                             const Eigen::ArrayXXd &x_vals);
 
 int main() {
   DoBenchmarking();
@@ -28,16 +81,57 @@ void DoBenchmarking() {
   BenchmarkTestData benchmark_test_data =  BenchmarkTestData();
   LoadBenchmarkData(benchmark_test_data);
   RunBenchmarks(benchmark_test_data);
+#ifdef COUNTS_ALLOCATIONS
+  RunAllocationBenchmarks(benchmark_test_data);
+#endif
 }
 
 void RunBenchmarks(const BenchmarkTestData &benchmark_test_data) {
   Eigen::ArrayXd evaluate_times = TimeBenchmark(BenchmarkEvaluate, benchmark_test_data);
   Eigen::ArrayXd x_derivative_times = TimeBenchmark(BenchmarkEvaluateAndXDerivative, benchmark_test_data);
   Eigen::ArrayXd c_derivative_times = TimeBenchmark(BenchmarkEvaluateAndCDerivative, benchmark_test_data);
+  Eigen::ArrayXd workspace_evaluate_times = TimeBenchmark(BenchmarkWorkspaceEvaluate, benchmark_test_data);
+  Eigen::ArrayXd fast_evaluate_times = TimeBenchmark(BenchmarkFastEvaluate, benchmark_test_data);
+  Eigen::ArrayXd population_evaluate_times = TimeBenchmark(BenchmarkPopulationEvaluate, benchmark_test_data);
+  Eigen::ArrayXd offspring_evaluate_times = TimeBenchmark(BenchmarkOffspringEvaluate, benchmark_test_data, 10);
+  Eigen::ArrayXd shared_evaluate_times = TimeBenchmark(BenchmarkSharedEvaluate, benchmark_test_data, 10);
   PrintHeader();
   PrintResults(evaluate_times, EVALUATE);
   PrintResults(x_derivative_times, X_DERIVATIVE);
   PrintResults(c_derivative_times, C_DERIVATIVE);
+  PrintResults(workspace_evaluate_times, WORKSPACE_EVALUATE);
+  PrintResults(fast_evaluate_times, FAST_EVALUATE);
+  PrintResults(population_evaluate_times, POPULATION_EVALUATE);
+  PrintResults(offspring_evaluate_times, OFFSPRING_EVALUATE);
+  PrintResults(shared_evaluate_times, SHARED_EVALUATE);
+}
+
+void RunAllocationBenchmarks(const BenchmarkTestData &benchmark_test_data) {
+  Eigen::ArrayXd evaluate_allocations = CountAllocations(BenchmarkEvaluate, benchmark_test_data);
+  Eigen::ArrayXd x_derivative_allocations = CountAllocations(BenchmarkEvaluateAndXDerivative, benchmark_test_data);
+  Eigen::ArrayXd c_derivative_allocations = CountAllocations(BenchmarkEvaluateAndCDerivative, benchmark_test_data);
+  Eigen::ArrayXd workspace_evaluate_allocations = CountAllocations(BenchmarkWorkspaceEvaluate, benchmark_test_data);
+  PrintHeader("ALLOCATIONS PER EQUATION");
+  PrintResults(evaluate_allocations, EVALUATE);
+  PrintResults(x_derivative_allocations, X_DERIVATIVE);
+  PrintResults(c_derivative_allocations, C_DERIVATIVE);
+  PrintResults(workspace_evaluate_allocations, WORKSPACE_EVALUATE);
+}
+
+Eigen::ArrayXd CountAllocations(
+  void (*benchmark)(const std::vector<AGraph>&, const Eigen::ArrayXXd&),
+  const BenchmarkTestData &test_data, int repeat) {
+  Eigen::ArrayXd allocations = Eigen::ArrayXd(repeat);
+#ifdef COUNTS_ALLOCATIONS
+  for (int run=0; run<repeat; run++) {
+    long start = allocation_count;
+    benchmark(test_data.indv_list, test_data.x_vals);
+    long stop = allocation_count;
+    allocations(run) = static_cast<double>(stop - start)
+                       / test_data.indv_list.size();
+  }
+#endif
+  return allocations;
 }
 
 Eigen::ArrayXd TimeBenchmark(
@@ -81,4 +175,105 @@ void BenchmarkEvaluateAndCDerivative(const std::vector<AGraph> &indv_list,
     evaluation_backend::EvaluateWithDerivative(
       indv->GetCommandArray(), x_vals, indv->GetLocalOptimizationParams(), false);
   }
-}
\ No newline at end of file
+}
+
+void BenchmarkWorkspaceEvaluate(const std::vector<AGraph> &indv_list,
+                                const Eigen::ArrayXXd &x_vals) {
+  static evaluation_backend::EvaluationWorkspace workspace;
+  std::vector<AGraph>::const_iterator indv;
+  for(indv=indv_list.begin(); indv!=indv_list.end(); indv++) {
+    evaluation_backend::Evaluate(
+      indv->GetCommandArray(), x_vals, indv->GetLocalOptimizationParams(),
+      workspace);
+  }
+}
+
+void BenchmarkFastEvaluate(const std::vector<AGraph> &indv_list,
+                           const Eigen::ArrayXXd &x_vals) {
+  static evaluation_backend::EvaluationWorkspace workspace;
+  workspace.SetAccuracy(evaluation_backend::kFast);
+  std::vector<AGraph>::const_iterator indv;
+  for(indv=indv_list.begin(); indv!=indv_list.end(); indv++) {
+    evaluation_backend::Evaluate(
+      indv->GetCommandArray(), x_vals, indv->GetLocalOptimizationParams(),
+      workspace);
+  }
+}
+
+void BenchmarkPopulationEvaluate(const std::vector<AGraph> &indv_list,
+                                 const Eigen::ArrayXXd &x_vals) {
+  static std::vector<AGraph> population(indv_list);
+  static PopulationEvaluator evaluator;
+  evaluator.EvaluatePopulationAt(population, x_vals);
+}
+
+// The parents, their single point crossovers and their point mutations, as
+// evaluated together in one generation of an evolutionary algorithm
+std::vector<AGraph> MakeOffspringPopulation(
+  const std::vector<AGraph> &indv_list) {
+  std::vector<AGraph> population(indv_list);
+  const int num_parents = indv_list.size();
+  for (int i=0; i<num_parents; i++) {
+    const AGraph &parent = indv_list[i];
+    const AGraph &donor = indv_list[(i + 1) % num_parents];
+    Eigen::ArrayX3i stack = parent.GetCommandArray();
+    int point = stack.rows() / 2 + i % (stack.rows() / 4);
+    stack.bottomRows(stack.rows() - point) =
+      donor.GetCommandArray().bottomRows(stack.rows() - point);
+    AGraph child(parent);
+    child.SetCommandArray(stack);
+    const Eigen::ArrayXXd &parent_constants =
+      parent.GetLocalOptimizationParams();
+    Eigen::VectorXd constants = Eigen::VectorXd::Ones(
+      child.GetNumberLocalOptimizationParams());
+    for (int j=0; j<constants.size() && j<parent_constants.rows(); j++) {
+      constants(j) = parent_constants(j, 0);
+    }
+    child.SetLocalOptimizationParams(constants);
+    population.push_back(child);
+
+    Eigen::ArrayX3i mutated = parent.GetCommandArray();
+    std::vector<bool> utilized = parent.GetUtilizedCommands();
+    for (int row=point; row<mutated.rows(); row++) {
+      if (!utilized[row]) {
+        continue;
+      }
+      int op = mutated(row, 0);
+      if (op == Op::kAddition || op == Op::kMultiplication) {
+        mutated(row, 0) = op == Op::kAddition ? Op::kMultiplication
+                                              : Op::kAddition;
+        break;
+      }
+      if (op == Op::kSin || op == Op::kCos) {
+        mutated(row, 0) = op == Op::kSin ? Op::kCos : Op::kSin;
+        break;
+      }
+    }
+    AGraph mutant(parent);
+    mutant.SetCommandArray(mutated);
+    mutant.SetLocalOptimizationParamsA(parent.GetLocalOptimizationParams());
+    population.push_back(mutant);
+  }
+  return population;
+}
+
+void BenchmarkOffspringEvaluate(const std::vector<AGraph> &indv_list,
+                                const Eigen::ArrayXXd &x_vals) {
+  static std::vector<AGraph> population = MakeOffspringPopulation(indv_list);
+  static Eigen::ArrayXXd x = x_vals.replicate(OFFSPRING_DATA_REPEATS, 1);
+  static PopulationEvaluator evaluator;
+  evaluator.EvaluatePopulationAt(population, x);
+}
+
+void BenchmarkSharedEvaluate(const std::vector<AGraph> &indv_list,
+                             const Eigen::ArrayXXd &x_vals) {
+  static std::vector<AGraph> population = MakeOffspringPopulation(indv_list);
+  static Eigen::ArrayXXd x = x_vals.replicate(OFFSPRING_DATA_REPEATS, 1);
+  static std::shared_ptr<evaluation_backend::SubexpressionCache> cache =
+    std::make_shared<evaluation_backend::SubexpressionCache>();
+  static PopulationEvaluator evaluator;
+  evaluator.SetSubexpressionCache(cache);
+  // only subexpressions shared within the population are reused
+  cache->Clear();
+  evaluator.EvaluatePopulationAt(population, x);
+}
@@ -42,6 +42,9 @@ void add_regressor_classes(py::module &parent) {
     .def("get_fitness_and_gradient", &VectorGradientMixin::GetIndividualFitnessAndGradient,
          py::arg("individual"))
     .def("get_fitness_vector_and_jacobian", &VectorGradientMixin::GetFitnessVectorAndJacobian,
+         py::arg("individual"))
+    .def("get_fitness_vector_and_normal_equations",
+         &VectorGradientMixin::GetFitnessVectorAndNormalEquations,
          py::arg("individual"));
 
   py::class_<ImplicitTrainingData, TrainingData>(parent, "ImplicitTrainingData")
@@ -93,6 +96,7 @@ void add_regressor_classes(py::module &parent) {
     .def("evaluate_fitness_vector", &ExplicitRegression::EvaluateFitnessVector, py::arg("individual"))
     .def("get_fitness_and_gradient", &ExplicitRegression::GetIndividualFitnessAndGradient, py::arg("individual"))
     .def("get_fitness_vector_and_jacobian", &ExplicitRegression::GetFitnessVectorAndJacobian, py::arg("individual"))
+    .def("get_fitness_vector_and_normal_equations", &ExplicitRegression::GetFitnessVectorAndNormalEquations, py::arg("individual"))
     .def("__getstate__", &ExplicitRegression::DumpState)
     .def("__setstate__", [](ExplicitRegression &r, const ExplicitRegressionState &state) {
             new (&r) ExplicitRegression(state); });
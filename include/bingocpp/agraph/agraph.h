@@ -17,6 +17,7 @@
 #ifndef BINGOCPP_INCLUDE_BINGOCPP_AGRAPH_H_
 #define BINGOCPP_INCLUDE_BINGOCPP_AGRAPH_H_
 
+#include <memory>
 #include <set>
 #include <unordered_map>
 #include <string>
@@ -28,6 +29,13 @@
 #include <Eigen/Core>
 
 #include <bingocpp/equation.h>
+#include <bingocpp/agraph/copy_on_write.h>
+#include <bingocpp/agraph/packed_command_array.h>
+#include <bingocpp/agraph/evaluation_backend/folded_stack.h>
+#include <bingocpp/agraph/evaluation_backend/forward_tape.h>
+#include <bingocpp/agraph/evaluation_backend/jit_compiler.h>
+#include <bingocpp/agraph/evaluation_backend/row_cache.h>
+#include <bingocpp/agraph/evaluation_backend/subexpression_cache.h>
 
 typedef std::pair<Eigen::ArrayXXd, Eigen::ArrayXXd> EvalAndDerivative;
 typedef std::tuple<Eigen::ArrayX3i, Eigen::ArrayX3i, Eigen::ArrayXXd,
@@ -51,7 +59,7 @@ namespace bingo
     AGraph(const AGraph &agraph);
     AGraph(const AGraphState &state);
     AGraph(AGraph &&) = default;
-    AGraph &operator=(const AGraph &) = default;
+    AGraph &operator=(const AGraph &agraph);
     AGraph &operator=(AGraph &&) = default;
     virtual ~AGraph() = default;
 
@@ -72,12 +80,57 @@ namespace bingo
     /**
      * @brief Get the Command Array object
      *
+     * A compact AGraph unpacks its command array on the first call.
+     *
      * @return Eigen::ArrayX3i The command array for this graph.
      */
     const Eigen::ArrayX3i &GetCommandArray() const;
 
+    /**
+     * @brief Get the Command Array object for modification
+     *
+     * The array is copied first if it is shared with copies of this graph.
+     * Until the graph is next updated (e.g. evaluated) or its command array
+     * set, copies of it get their own command array, so writes through the
+     * reference never reach them; after that the reference is invalid.
+     *
+     * @return Eigen::ArrayX3i& The command array for this graph.
+     */
     Eigen::ArrayX3i &GetCommandArrayModifiable();
 
+    /**
+     * @brief Get the simplified Command Array object
+     *
+     * @return Eigen::ArrayX3i The command array that is evaluated: the
+     * utilized commands, simplified.
+     */
+    const Eigen::ArrayX3i &GetSimplifiedCommandArray();
+
+    /**
+     * @brief Hash of the simplified command array and the constants.
+     *
+     * AGraphs that only differ in unused or simplified away commands
+     * have the same hash.
+     *
+     * @return std::size_t
+     */
+    std::size_t GetStructuralHash();
+
+    /**
+     * @brief Set the cache of subexpression values EvaluateEquationAt
+     * shares with the other AGraphs of a population.
+     *
+     * Applies with a single set of constants and takes precedence over
+     * row caching. Copies share the cache of the AGraph they were copied
+     * from.
+     *
+     * @param cache The cache, or nullptr (default) for none.
+     */
+    void SetSubexpressionCache(
+        std::shared_ptr<evaluation_backend::SubexpressionCache> cache);
+    std::shared_ptr<evaluation_backend::SubexpressionCache>
+    GetSubexpressionCache() const;
+
     /**
      * @brief Set the Command Array object
      *
@@ -202,6 +255,20 @@ namespace bingo
     EvalAndDerivative
     EvaluateEquationWithXGradientAt(const Eigen::ArrayXXd &x);
 
+    /**
+     * @brief Evaluate the AGraph equation in single precision
+     *
+     * Evaluation of the AGraph Equation at points x with float buffers, for
+     * screening. Never uses the native code of the JIT compiler.
+     *
+     * @param x Values at which to evaluate the equations. x is MxD where D is the
+     * number of dimensions in x and M is the number of data points in x.
+     *
+     * @return Eigen::ArrayXXf The evaluation of function at points x.
+     */
+    Eigen::ArrayXXf
+    EvaluateEquationSingleAt(const Eigen::ArrayXXf &x);
+
     /**
      * @brief Evluate the AGraph and get its derivatives.
      *
@@ -218,6 +285,44 @@ namespace bingo
     EvalAndDerivative
     EvaluateEquationWithLocalOptGradientAt(const Eigen::ArrayXXd &x);
 
+    /**
+     * @brief Evaluate the AGraph and the weighted sum of its derivatives.
+     *
+     * Seeds the reverse sweep of the evaluation backend with the weights,
+     * so the Jacobian with respect to the constants is never formed. Native
+     * code from the JIT compiler reduces its Jacobian instead.
+     *
+     * @param x Values at which to evaluate the equations. x is MxD where D is the
+     * number of dimensions in x and M is the number of data points in x.
+     *
+     * @param seed Weights of the samples, given their values.
+     *
+     * @return EvalAndDerivative The evaluation of the function of this AGraph
+     * along the points x and the Cx1 product with respect to the C constants.
+     */
+    EvalAndDerivative
+    EvaluateEquationWithLocalOptVectorJacobianProductAt(
+        const Eigen::ArrayXXd &x, const SeedFunction &seed);
+
+    /**
+     * @brief Evaluate the AGraph and the normal equations of its residuals.
+     *
+     * The evaluation backend forms the Jacobian with respect to the
+     * constants one tile at a time and only keeps its products. Native code
+     * from the JIT compiler forms the whole Jacobian instead.
+     *
+     * @param x Values at which to evaluate the equations. x is MxD where D is the
+     * number of dimensions in x and M is the number of data points in x.
+     *
+     * @param residuals Residuals of the samples, given their values.
+     *
+     * @return EvalAndNormalEquations The evaluation of the function of this
+     * AGraph along the points x, the CxC and the Cx1 products.
+     */
+    EvalAndNormalEquations
+    EvaluateEquationWithLocalOptNormalEquationsAt(
+        const Eigen::ArrayXXd &x, const ResidualFunction &residuals);
+
     /**
      * @brief Output a string description of the the AGraph in a given format.
      *
@@ -241,22 +346,101 @@ namespace bingo
 
     int Distance(const AGraph &agraph);
 
+    /**
+     * @brief Store the AGraph in as little memory as possible.
+     *
+     * Keeps the command array and the simplified command array packed (see
+     * PackedCommandArray) and releases everything derived from them: the
+     * compiled stack, native code, row caches and forward tapes. These are
+     * rebuilt from the packed arrays by the next evaluation, and the
+     * command array is unpacked when it is requested or modified. For
+     * AGraphs that are kept but rarely evaluated, e.g. a hall of fame.
+     * Invalidates references from GetCommandArrayModifiable.
+     *
+     * @return true if the AGraph is compact; false if its commands do not
+     * fit in packed commands.
+     */
+    bool Compact();
+    bool IsCompact() const;
+
+    /**
+     * @brief Set the number of evaluations after which an AGraph is
+     * compiled to native code.
+     *
+     * Applies to EvaluateEquationAt and EvaluateEquationWithLocalOptGradientAt
+     * with a single set of constants. Counts restart whenever the command
+     * array changes. Compilation needs a C++ compiler at runtime (see
+     * evaluation_backend::SetJitCompiler); if it fails the AGraph keeps
+     * using the interpreter.
+     *
+     * @param num_evaluations Number of evaluations; negative (default)
+     * disables compilation.
+     */
+    static void SetJitThreshold(int num_evaluations);
+    static int GetJitThreshold();
+
+    /**
+     * @brief Keep the values of every row of the last evaluation.
+     *
+     * Applies to EvaluateEquationAt with a single set of constants. Copies
+     * share the values of the AGraph they were copied from, so after a
+     * mutation only the rows that changed, and the rows downstream of them,
+     * are evaluated again on the same data. Each AGraph then holds one
+     * array per row of its stack.
+     *
+     * @param enabled Whether rows are cached; disabled by default.
+     */
+    static void SetRowCaching(bool enabled);
+    static bool GetRowCaching();
+
+    /**
+     * @brief Set the largest forward tape an AGraph keeps.
+     *
+     * With a budget, EvaluateEquationAt with a single set of constants
+     * keeps the forward buffers of its evaluation if they fit, and a
+     * following EvaluateEquationWithLocalOptGradientAt or
+     * EvaluateEquationWithXGradientAt on the same data with the same
+     * constants only runs the reverse sweep. Row caching takes precedence.
+     *
+     * @param bytes Largest tape in bytes; 0 (default) keeps no tapes.
+     */
+    static void SetForwardTapeBudget(std::size_t bytes);
+    static std::size_t GetForwardTapeBudget();
+
   private:
-    Eigen::ArrayX3i command_array_;
-    Eigen::ArrayX3i simplified_command_array_;
-    Eigen::ArrayXXd simplified_constants_;
+    // shared between copies until modified
+    CopyOnWrite<Eigen::ArrayX3i> command_array_;
+    // a modifiable reference to command_array_ may be in use; copies do not
+    // share it until the next update
+    bool command_array_handed_out_;
+    CopyOnWrite<Eigen::ArrayX3i> simplified_command_array_;
+    CopyOnWrite<Eigen::ArrayXXd> simplified_constants_;
+    CopyOnWrite<evaluation_backend::FoldedStack> folded_stack_;
+    // the command arrays of a compact AGraph; the copies above are emptied
+    std::shared_ptr<const PackedCommandArray> packed_command_array_;
+    std::shared_ptr<const PackedCommandArray> packed_simplified_command_array_;
+    // command array unpacked by GetCommandArray, shared by copies
+    mutable std::shared_ptr<const Eigen::ArrayX3i> unpacked_command_array_;
     bool needs_opt_;
     double fitness_;
     bool fit_set_;
     int genetic_age_;
     bool modified_;
     bool use_simplification_;
+    int num_evaluations_;
+    std::shared_ptr<const evaluation_backend::JitFunction> jit_function_;
+    bool jit_failed_;
+    std::shared_ptr<const evaluation_backend::RowCache> row_cache_;
+    std::shared_ptr<const evaluation_backend::ForwardTape> forward_tape_;
+    std::shared_ptr<evaluation_backend::SubexpressionCache>
+        subexpression_cache_;
 
     // To string operator when passed into stream
     friend std::ostream &operator<<(std::ostream &, AGraph &);
 
     // helper functions
     void notify_agraph_modification();
+    void expandCommandArray();
     void update();
     // extracted methods from update helper function
     void performDefaultConstantResize(int const_number_input);
@@ -264,6 +448,12 @@ namespace bingo
     int countAndUpdateConstants();
     void updateConstantsArray(); 
     void updateSimplifiedCommandArray(); 
+    void updateFoldedStack();
+    bool useJit(const Eigen::ArrayXXd &x);
+    const EvalAndDerivative &evaluateWithDerivative(
+        const Eigen::ArrayXXd &x, const Eigen::ArrayXXd &constants,
+        bool param_x_or_c,
+        evaluation_backend::EvaluationWorkspace &workspace);
   };
 } // namespace bingo
 #endif // BINGOCPP_INCLUDE_BINGOCPP_AGRAPH_H_
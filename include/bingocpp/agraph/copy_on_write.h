@@ -0,0 +1,117 @@
+/*
+ * Copyright 2018 United States Government as represented by the Administrator
+ * of the National Aeronautics and Space Administration. No copyright is claimed
+ * in the United States under Title 17, U.S. Code. All Other Rights Reserved.
+ *
+ * The Bingo Mini-app platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#ifndef BINGOCPP_INCLUDE_BINGOCPP_AGRAPH_COPY_ON_WRITE_H_
+#define BINGOCPP_INCLUDE_BINGOCPP_AGRAPH_COPY_ON_WRITE_H_
+
+#include <atomic>
+#include <memory>
+
+namespace bingo
+{
+  /**
+   * @brief A value whose copies share storage until one of them is
+   * modified.
+   *
+   * Copying is O(1); the value is copied by the first modification of a
+   * copy whose storage is shared. Modifiable references are only valid until
+   * the next copy of the object, which may share the storage again. Copies
+   * may be read and modified from different threads, but a single copy may
+   * not be modified from two threads at once.
+   */
+  template <typename T>
+  class CopyOnWrite
+  {
+  public:
+    CopyOnWrite() : data_(std::make_shared<T>()) {}
+
+    /**
+     * @brief Replace the value, without copying the current one.
+     */
+    template <typename Value>
+    CopyOnWrite &operator=(const Value &value)
+    {
+      if (isShared())
+      {
+        std::shared_ptr<T> data = std::make_shared<T>();
+        *data = value;
+        data_ = data;
+      }
+      else
+      {
+        *data_ = value;
+      }
+      return *this;
+    }
+
+    const T &Get() const
+    {
+      return *data_;
+    }
+
+    /**
+     * @brief The value, copied first if its storage is shared.
+     *
+     * The reference must not outlive the next copy of this object.
+     */
+    T &Modify()
+    {
+      if (isShared())
+      {
+        data_ = std::make_shared<T>(*data_);
+      }
+      return *data_;
+    }
+
+    /**
+     * @brief The value, for a modification that overwrites all of it.
+     *
+     * Storage shared with other copies is replaced by a default value
+     * instead of being copied.
+     */
+    T &Overwrite()
+    {
+      if (isShared())
+      {
+        data_ = std::make_shared<T>();
+      }
+      return *data_;
+    }
+
+    /**
+     * @brief Whether the storage is shared with another copy.
+     */
+    bool IsShared() const
+    {
+      return data_.use_count() > 1;
+    }
+
+  private:
+    bool isShared()
+    {
+      if (data_.use_count() > 1)
+      {
+        return true;
+      }
+      // see the writes of the copies that released the storage
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return false;
+    }
+
+    std::shared_ptr<T> data_;
+  };
+} // namespace bingo
+#endif // BINGOCPP_INCLUDE_BINGOCPP_AGRAPH_COPY_ON_WRITE_H_
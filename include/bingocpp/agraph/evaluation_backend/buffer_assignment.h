@@ -0,0 +1,70 @@
+/*
+ * Copyright 2018 United States Government as represented by the Administrator
+ * of the National Aeronautics and Space Administration. No copyright is claimed
+ * in the United States under Title 17, U.S. Code. All Other Rights Reserved.
+ *
+ * The Bingo Mini-app platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#ifndef INCLUDE_BINGOCPP_BUFFER_ASSIGNMENT_H_
+#define INCLUDE_BINGOCPP_BUFFER_ASSIGNMENT_H_
+
+#include <vector>
+
+#include <Eigen/Dense>
+
+namespace bingo
+{
+    namespace evaluation_backend
+    {
+        /**
+         * @brief Mapping of stack rows onto a small set of reusable buffers.
+         *
+         * Produced by AssignBuffers. Vectors are indexed by stack row and are
+         * only ever grown, so a BufferAssignment kept in a workspace can be
+         * refilled without allocating.
+         */
+        struct BufferAssignment
+        {
+            // Row that reads each row last; -1 if the row is never used
+            std::vector<int> last_use;
+            // Forward buffer holding the value of each row
+            std::vector<int> forward_buffer;
+            // Reverse buffer holding the adjoint of each row
+            std::vector<int> reverse_buffer;
+            int num_forward_buffers = 0;
+            int num_reverse_buffers = 0;
+            // Scratch space for the allocator
+            std::vector<int> free_buffers;
+            std::vector<bool> pinned;
+        };
+
+        /**
+         * @brief Compute row liveness and assign rows to buffers.
+         *
+         * Each row's value is kept only until its last use, after which its
+         * buffer is handed to a later row. Rows that do not contribute to the
+         * last row are marked unused and get no buffer.
+         *
+         * @param stack Nx3 array. The command stack associated with an equation.
+         *
+         * @param keep_for_reverse If true, values that are read again during
+         * reverse evaluation keep their buffer for the whole evaluation and
+         * reverse buffers are assigned as well.
+         *
+         * @param assignment Filled with the liveness and buffer mapping.
+         */
+        void AssignBuffers(const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+                           bool keep_for_reverse,
+                           BufferAssignment &assignment);
+    } // namespace evaluation_backend
+} // namespace bingo
+#endif
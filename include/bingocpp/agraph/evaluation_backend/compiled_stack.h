@@ -0,0 +1,284 @@
+/*
+ * Copyright 2018 United States Government as represented by the Administrator
+ * of the National Aeronautics and Space Administration. No copyright is claimed
+ * in the United States under Title 17, U.S. Code. All Other Rights Reserved.
+ *
+ * The Bingo Mini-app platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#ifndef INCLUDE_BINGOCPP_COMPILED_STACK_H_
+#define INCLUDE_BINGOCPP_COMPILED_STACK_H_
+
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <bingocpp/agraph/evaluation_backend/buffer_assignment.h>
+
+namespace bingo
+{
+    namespace evaluation_backend
+    {
+        class EvaluationWorkspace;
+
+        /**
+         * @brief Shape of the value of a stack row.
+         *
+         * A value depends on the samples (rows of x), on the constant sets
+         * (columns of the constants), on both or on neither. The bits
+         * combine the same way the shapes broadcast.
+         */
+        enum ShapeClass
+        {
+            kScalar = 0,   // 1 x 1
+            kColumn = 1,   // num_samples x 1
+            kRow = 2,      // 1 x num_constant_sets
+            kMatrix = 3    // num_samples x num_constant_sets
+        };
+
+        /**
+         * @brief Accuracy of the transcendental kernels.
+         *
+         * Strict kernels give the same results as the standard library.
+         * Fast kernels use vectorized approximations that are within a few
+         * ulp, which is plenty to rank individuals.
+         */
+        enum Accuracy
+        {
+            kStrict = 0,
+            kFast = 1
+        };
+
+        /**
+         * @brief Floating point type of an evaluation.
+         *
+         * Single precision halves the memory traffic of every buffer and
+         * doubles the number of values per SIMD register. It is meant for
+         * screening many individuals, not for final fitness values or
+         * constant optimization.
+         */
+        enum Precision
+        {
+            kDouble = 0,
+            kSingle = 1
+        };
+
+        /**
+         * @brief How derivatives are propagated.
+         *
+         * Forward mode carries the tangent of every derivative direction
+         * alongside the values in one pass. Reverse mode sweeps adjoints
+         * back through the stack after the forward pass. Forward mode is
+         * cheaper when there are fewer directions than operand reads per
+         * row; kAutomatic picks the cheaper one for every evaluation.
+         */
+        enum DerivativeMode
+        {
+            kAutomatic = 0,
+            kForwardMode = 1,
+            kReverseMode = 2
+        };
+
+        /**
+         * @brief Buffer indices used by one stack row.
+         *
+         * Where the result of the row is stored and where its two operands
+         * are stored.
+         */
+        struct RowBuffers
+        {
+            int result;
+            int param1;
+            int param2;
+        };
+
+        typedef void (*ForwardKernel)(
+            int result, int param1, int param2,
+            const Eigen::Ref<const Eigen::ArrayXXd> &x,
+            const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+            EvaluationWorkspace &workspace);
+
+        typedef void (*ReverseKernel)(const RowBuffers &forward,
+                                      const RowBuffers &reverse,
+                                      EvaluationWorkspace &workspace);
+
+        /**
+         * @brief Where a fused chain reads one of its operands from.
+         */
+        enum OperandSource
+        {
+            kFromBuffer = 0,     // forward buffer at index
+            kFromX = 1,          // column index of x
+            kFromConstants = 2,  // row index of the constants
+            kFromInteger = 3,    // the integer index itself
+            kFromSaved = 4       // the result buffer, read before writing
+        };
+
+        /**
+         * @brief An operand of a fused chain.
+         */
+        struct FusedOperand
+        {
+            OperandSource source;
+            ShapeClass shape;
+            int index;
+        };
+
+        /**
+         * @brief One operator applied to the running value of a fused chain.
+         */
+        struct FusedStep
+        {
+            int node;
+            bool arity_2;
+            // Whether the running value is the first operand of the node
+            bool chain_is_param1;
+            // The other operand of binary nodes
+            FusedOperand operand;
+        };
+
+        /**
+         * @brief A chain of element-wise rows evaluated in a single pass.
+         *
+         * Every row of the chain but the last is read only by the next
+         * row, so the running value never leaves a small block of samples.
+         * The chain starts from first and applies the steps in order.
+         */
+        struct FusedChain
+        {
+            FusedOperand first;
+            std::vector<FusedStep> steps;
+            // Shape of the kFromSaved operands
+            ShapeClass saved_shape;
+        };
+
+        /**
+         * @brief One row of a compiled command stack.
+         */
+        struct Instruction
+        {
+            int node;
+            ShapeClass shape;
+            // Index of the fused chain ending at this row, -1 if none
+            int chain;
+            // Forward buffers of the row; terminals keep their raw params
+            RowBuffers forward;
+            // Reverse buffers of the row
+            RowBuffers reverse;
+            // Positions in the stream of the row and of its operands, used
+            // by evaluations that keep every row; terminals keep their raw
+            // params
+            RowBuffers positions;
+            // Operand adjoints are cleared before this row's reverse step
+            bool clear_param1_adjoint;
+            bool clear_param2_adjoint;
+            // Kernels of the row, indexed by Accuracy
+            ForwardKernel forward_kernels[2];
+            ReverseKernel reverse_kernels[2];
+        };
+
+        /**
+         * @brief Instructions for the used rows of a stack, in stack order.
+         */
+        struct InstructionStream
+        {
+            std::vector<Instruction> instructions;
+            // Fused chains referenced by the instructions
+            std::vector<FusedChain> chains;
+            // Number of forward/reverse buffers needed to run the stream
+            int num_buffers = 0;
+            // Number of operator rows and of the operands they read
+            int num_operators = 0;
+            int num_operands = 0;
+        };
+
+        /**
+         * @brief A command stack compiled for repeated evaluation.
+         *
+         * Compiling resolves the shape of every row, assigns rows to
+         * buffers and picks a kernel for every row, so evaluation does no
+         * shape checks or operator dispatch.
+         *
+         * In the value stream, chains of element-wise rows whose
+         * intermediate values are read only once are fused into a single
+         * instruction, and terminals read only by fused chains are read
+         * directly from x or the constants. Only the value at the end of a
+         * chain is stored in a buffer.
+         */
+        class CompiledStack
+        {
+        public:
+            CompiledStack();
+
+            /**
+             * @brief Compile a command stack.
+             *
+             * @param stack Nx3 array. The command stack associated with an
+             * equation.
+             */
+            explicit CompiledStack(const Eigen::Ref<const Eigen::ArrayX3i> &stack);
+
+            /**
+             * @brief Replace the program with a newly compiled command stack.
+             *
+             * Storage of the previous program is reused.
+             *
+             * @param stack Nx3 array. The command stack associated with an
+             * equation.
+             */
+            void Compile(const Eigen::Ref<const Eigen::ArrayX3i> &stack);
+
+            /**
+             * @brief Whether there is anything to evaluate.
+             */
+            bool IsEmpty() const;
+
+            // Instructions for evaluation without derivatives
+            InstructionStream value;
+            // Instructions for evaluation followed by a reverse sweep
+            InstructionStream derivative;
+
+        private:
+            void schedule(const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+                          bool fuse);
+            bool is_inlined(const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+                            int row) const;
+            FusedOperand fused_operand(
+                const Eigen::Ref<const Eigen::ArrayX3i> &stack, int row,
+                int result_buffer, FusedChain &chain) const;
+            FusedChain fuse_chain(
+                const Eigen::Ref<const Eigen::ArrayX3i> &stack, int last,
+                int result_buffer) const;
+            void compile_stream(const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+                                bool keep_for_reverse,
+                                InstructionStream &stream);
+
+            BufferAssignment assignment_;
+            std::vector<ShapeClass> shapes_;
+            // Number of reads of each row by used rows
+            std::vector<int> uses_;
+            // Number of those reads made by fused chains
+            std::vector<int> chain_uses_;
+            // Operand fused into each row, -1 if none
+            std::vector<int> chain_prev_;
+            // Whether each row is fused into the row that reads it
+            std::vector<bool> fused_;
+            // Rows in evaluation order and the position of each row in it
+            std::vector<int> order_;
+            std::vector<int> position_;
+            // Position in the stream of each row in evaluation order
+            std::vector<int> stream_position_;
+            // The stack in evaluation order, used to assign buffers
+            Eigen::ArrayX3i scheduled_;
+        };
+    } // namespace evaluation_backend
+} // namespace bingo
+#endif
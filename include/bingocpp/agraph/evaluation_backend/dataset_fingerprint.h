@@ -0,0 +1,59 @@
+/*
+ * Copyright 2018 United States Government as represented by the Administrator
+ * of the National Aeronautics and Space Administration. No copyright is claimed
+ * in the United States under Title 17, U.S. Code. All Other Rights Reserved.
+ *
+ * The Bingo Mini-app platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#ifndef INCLUDE_BINGOCPP_DATASET_FINGERPRINT_H_
+#define INCLUDE_BINGOCPP_DATASET_FINGERPRINT_H_
+
+#include <cstdint>
+
+#include <Eigen/Dense>
+
+namespace bingo
+{
+    namespace evaluation_backend
+    {
+        /**
+         * @brief Identifies the data an evaluation was made on.
+         *
+         * Datasets are identified by their shape and a hash of every sample,
+         * so the data being replaced or any sample being rewritten in place
+         * between evaluations is caught. Hashing reads the data once, which
+         * is small next to evaluating a stack over it.
+         */
+        class DatasetFingerprint
+        {
+        public:
+            DatasetFingerprint();
+            explicit DatasetFingerprint(
+                const Eigen::Ref<const Eigen::ArrayXXd> &x);
+
+            /**
+             * @brief Whether x is the dataset the fingerprint was taken of.
+             */
+            bool Matches(const Eigen::Ref<const Eigen::ArrayXXd> &x) const;
+
+            bool operator==(const DatasetFingerprint &other) const;
+
+            std::uint64_t GetHash() const;
+
+        private:
+            Eigen::Index rows_;
+            Eigen::Index cols_;
+            std::uint64_t hash_;
+        };
+    } // namespace evaluation_backend
+} // namespace bingo
+#endif
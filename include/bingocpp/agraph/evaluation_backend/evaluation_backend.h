@@ -17,6 +17,7 @@
 #ifndef INCLUDE_BINGOCPP_EVALUATION_BACKEND_H_
 #define INCLUDE_BINGOCPP_EVALUATION_BACKEND_H_
 
+#include <memory>
 #include <set>
 #include <utility>
 #include <vector>
@@ -25,6 +26,9 @@
 #include <Eigen/Core>
 
 #include <bingocpp/agraph/agraph.h>
+#include <bingocpp/agraph/evaluation_backend/compiled_stack.h>
+#include <bingocpp/agraph/evaluation_backend/evaluation_workspace.h>
+#include <bingocpp/agraph/evaluation_backend/forward_tape.h>
 
 using RowArrayXXd = Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
 using Stack3i = Eigen::Array<int, Eigen::Dynamic, 3, Eigen::RowMajor>;
@@ -81,6 +85,398 @@ namespace bingo
             const Eigen::Ref<const Eigen::ArrayXXd> &constants,
             const bool param_x_or_c = true);
 
+        /**
+         * @brief Evauluate the equation using a reusable workspace.
+         *
+         * Same as Evaluate, but all intermediate buffers come from workspace.
+         * Repeated calls with a workspace that is already large enough do
+         * not allocate.
+         *
+         * @param stack Nx3 array. The command stack associated with an equation.
+         * N is the number of commands in the stack.
+         *
+         * @param x MxD Array. Values at which to evaluate the equations. D is the
+         * dimension in x and M is the number of data points in x.
+         *
+         * @param constants Vector of doubles. Constants that are used in the equation.
+         *
+         * @param workspace Buffers used for the evaluation.
+         *
+         * @return const Eigen::ArrayXXd& The evaluation of the graph, owned by
+         * workspace and valid until its next use.
+         */
+        const Eigen::ArrayXXd &Evaluate(
+            const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+            const Eigen::Ref<const Eigen::ArrayXXd> &x,
+            const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+            EvaluationWorkspace &workspace);
+
+        /**
+         * @brief Evaluate equation and take derivative using a reusable workspace.
+         *
+         * Same as EvaluateWithDerivative, but all intermediate buffers come
+         * from workspace.
+         *
+         * @param stack Nx3 array. The command stack associated with an equation.
+         * N is the number of commands in the stack.
+         *
+         * @param x MxD Array. Values at which to evaluate the equations. D is the
+         * dimension in x and M is the number of data points in x.
+         *
+         * @param constants Vector of doubles. Constants that are used in the equation.
+         *
+         * @param param_x_or_c true: x derivative, false: c derivative
+         *
+         * @param workspace Buffers used for the evaluation.
+         *
+         * @return const EvalAndDerivative& Evaluation and derivatives, owned by
+         * workspace and valid until its next use.
+         */
+        const EvalAndDerivative &EvaluateWithDerivative(
+            const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+            const Eigen::Ref<const Eigen::ArrayXXd> &x,
+            const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+            const bool param_x_or_c,
+            EvaluationWorkspace &workspace);
+
+        /**
+         * @brief Evauluate a compiled equation using a reusable workspace.
+         *
+         * Same as Evaluate, but runs a program compiled ahead of time so no
+         * per-row shape checks or operator dispatch are needed.
+         *
+         * @param program The compiled command stack of an equation.
+         *
+         * @param x MxD Array. Values at which to evaluate the equations. D is the
+         * dimension in x and M is the number of data points in x.
+         *
+         * @param constants Vector of doubles. Constants that are used in the equation.
+         *
+         * @param workspace Buffers used for the evaluation.
+         *
+         * @return const Eigen::ArrayXXd& The evaluation of the graph, owned by
+         * workspace and valid until its next use.
+         */
+        const Eigen::ArrayXXd &Evaluate(
+            const CompiledStack &program,
+            const Eigen::Ref<const Eigen::ArrayXXd> &x,
+            const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+            EvaluationWorkspace &workspace);
+
+        /**
+         * @brief Evaluate a compiled equation and take derivative using a
+         * reusable workspace.
+         *
+         * @param program The compiled command stack of an equation.
+         *
+         * @param x MxD Array. Values at which to evaluate the equations. D is the
+         * dimension in x and M is the number of data points in x.
+         *
+         * @param constants Vector of doubles. Constants that are used in the equation.
+         *
+         * @param param_x_or_c true: x derivative, false: c derivative
+         *
+         * @param workspace Buffers used for the evaluation.
+         *
+         * @return const EvalAndDerivative& Evaluation and derivatives, owned by
+         * workspace and valid until its next use.
+         */
+        const EvalAndDerivative &EvaluateWithDerivative(
+            const CompiledStack &program,
+            const Eigen::Ref<const Eigen::ArrayXXd> &x,
+            const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+            const bool param_x_or_c,
+            EvaluationWorkspace &workspace);
+
+        /**
+         * @brief Evaluate a compiled equation and record its forward tape.
+         *
+         * Runs the forward pass of the program's derivative stream and
+         * keeps its buffers, so EvaluateWithDerivative with the tape only
+         * runs the reverse sweep. Not multithreaded, and slower than
+         * Evaluate when the tape goes unused, since fused chains are not
+         * run.
+         *
+         * @param program The compiled command stack of an equation.
+         *
+         * @param x MxD Array. Values at which to evaluate the equations. D is the
+         * dimension in x and M is the number of data points in x.
+         *
+         * @param constants Cx1 Array. The constants of the equation.
+         *
+         * @param tape_budget Largest tape in bytes. Evaluations whose tape
+         * would be larger are made by Evaluate and record no tape.
+         *
+         * @param tape Set to the recorded tape, or to nullptr.
+         *
+         * @param workspace Buffers used for the evaluation.
+         *
+         * @return const Eigen::ArrayXXd& The evaluation of the graph, owned by
+         * workspace and valid until its next use.
+         */
+        const Eigen::ArrayXXd &EvaluateAndRecord(
+            const CompiledStack &program,
+            const Eigen::Ref<const Eigen::ArrayXXd> &x,
+            const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+            std::size_t tape_budget,
+            std::shared_ptr<const ForwardTape> &tape,
+            EvaluationWorkspace &workspace);
+
+        /**
+         * @brief Take the derivative of a recorded evaluation.
+         *
+         * Same as EvaluateWithDerivative over the data and constants of the
+         * tape, running only the reverse sweep.
+         *
+         * @param program The compiled command stack the tape was recorded
+         * with.
+         *
+         * @param tape The forward tape of an evaluation.
+         *
+         * @param param_x_or_c true: x derivative, false: c derivative
+         *
+         * @param workspace Buffers used for the evaluation.
+         *
+         * @return const EvalAndDerivative& Evaluation and derivatives, owned by
+         * workspace and valid until its next use.
+         */
+        const EvalAndDerivative &EvaluateWithDerivative(
+            const CompiledStack &program,
+            const ForwardTape &tape,
+            const bool param_x_or_c,
+            EvaluationWorkspace &workspace);
+
+        /**
+         * @brief Evauluate a compiled equation in single precision.
+         *
+         * Same as Evaluate, but x and all intermediate values are float.
+         * Meant for screening: values are only accurate to about 7 digits
+         * and are not multithreaded. Fused chains are not used, the
+         * program's derivative stream is run forward instead.
+         *
+         * @param program The compiled command stack of an equation.
+         *
+         * @param x MxD Array. Values at which to evaluate the equations. D is the
+         * dimension in x and M is the number of data points in x.
+         *
+         * @param constants Vector of doubles. Constants that are used in the
+         * equation, rounded to float for the evaluation.
+         *
+         * @param workspace Buffers used for the evaluation.
+         *
+         * @return const Eigen::ArrayXXf& The evaluation of the graph, owned by
+         * workspace and valid until its next single precision use.
+         */
+        const Eigen::ArrayXXf &EvaluateSingle(
+            const CompiledStack &program,
+            const Eigen::Ref<const Eigen::ArrayXXf> &x,
+            const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+            EvaluationWorkspace &workspace);
+
+        /**
+         * @brief Evauluate the equation in single precision.
+         *
+         * Same as EvaluateSingle with a compiled program, compiling stack
+         * into the program of workspace.
+         */
+        const Eigen::ArrayXXf &EvaluateSingle(
+            const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+            const Eigen::Ref<const Eigen::ArrayXXf> &x,
+            const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+            EvaluationWorkspace &workspace);
+
+        /**
+         * @brief Evaluate an equation and the product of its transposed
+         * constant Jacobian with per-sample weights.
+         *
+         * The reverse sweep of every tile is seeded with the weights seed
+         * gives the samples of the tile, and the adjoints of the constants
+         * are summed over the tile, so the MxC Jacobian is never formed.
+         * With the derivative of a metric with respect to the equation as
+         * weights, the product is the gradient of the metric. Parallel
+         * evaluations call seed from several threads at once, for disjoint
+         * samples.
+         *
+         * @param program The compiled command stack of an equation.
+         *
+         * @param x MxD Array. Values at which to evaluate the equations. D is the
+         * dimension in x and M is the number of data points in x.
+         *
+         * @param constants Cx1 Array. The constants of the equation.
+         *
+         * @param seed Fills the weights of samples given their values.
+         *
+         * @param workspace Buffers used for the evaluation.
+         *
+         * @return const EvalAndDerivative& Mx1 values and the Cx1 product.
+         * Owned by workspace and valid until its next use.
+         */
+        const EvalAndDerivative &EvaluateVectorJacobianProduct(
+            const CompiledStack &program,
+            const Eigen::Ref<const Eigen::ArrayXXd> &x,
+            const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+            const SeedFunction &seed,
+            EvaluationWorkspace &workspace);
+
+        /**
+         * @brief Evaluate an equation and the product of its transposed
+         * constant Jacobian with per-sample weights.
+         *
+         * Same as EvaluateVectorJacobianProduct with a compiled program,
+         * compiling stack into the program of workspace.
+         */
+        const EvalAndDerivative &EvaluateVectorJacobianProduct(
+            const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+            const Eigen::Ref<const Eigen::ArrayXXd> &x,
+            const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+            const SeedFunction &seed,
+            EvaluationWorkspace &workspace);
+
+        /**
+         * @brief Evaluate an equation and the Gauss-Newton normal equations
+         * of its residuals.
+         *
+         * The constant Jacobian is formed one tile at a time; residuals
+         * turns the values and Jacobian of the tile into residuals and
+         * their Jacobian, whose products are added up over the tiles. Only
+         * CxC and C-sized results leave the evaluation, which is all a
+         * Levenberg-Marquardt step needs. Parallel evaluations call
+         * residuals from several threads at once, for disjoint samples.
+         *
+         * @param program The compiled command stack of an equation.
+         *
+         * @param x MxD Array. Values at which to evaluate the equations. D is the
+         * dimension in x and M is the number of data points in x.
+         *
+         * @param constants Cx1 Array. The constants of the equation.
+         *
+         * @param residuals Fills the residuals of samples given their values
+         * and turns the Jacobian into theirs.
+         *
+         * @param workspace Buffers used for the evaluation.
+         *
+         * @return const EvalAndNormalEquations& Mx1 values, the CxC product
+         * of the transposed residual Jacobian with itself and the Cx1
+         * product with the residuals. Owned by workspace and valid until
+         * its next use.
+         */
+        const EvalAndNormalEquations &EvaluateNormalEquations(
+            const CompiledStack &program,
+            const Eigen::Ref<const Eigen::ArrayXXd> &x,
+            const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+            const ResidualFunction &residuals,
+            EvaluationWorkspace &workspace);
+
+        /**
+         * @brief Evaluate an equation and the Gauss-Newton normal equations
+         * of its residuals.
+         *
+         * Same as EvaluateNormalEquations with a compiled program, compiling
+         * stack into the program of workspace.
+         */
+        const EvalAndNormalEquations &EvaluateNormalEquations(
+            const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+            const Eigen::Ref<const Eigen::ArrayXXd> &x,
+            const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+            const ResidualFunction &residuals,
+            EvaluationWorkspace &workspace);
+
+        /**
+         * @brief Evaluate an equation and its constant Jacobian for several
+         * sets of constants in a single pass.
+         *
+         * Every row is dispatched once for all K sets. Rows that only
+         * depend on x are evaluated once and rows that only depend on the
+         * constants once per set, so only rows that depend on both are
+         * evaluated K times. The reverse sweep carries one adjoint per set,
+         * so all K Jacobians come out of a single sweep. Used to start
+         * several constant optimizations at once or to score an ensemble of
+         * perturbed constants.
+         *
+         * @param program The compiled command stack of an equation.
+         *
+         * @param x MxD Array. Values at which to evaluate the equations. D is the
+         * dimension in x and M is the number of data points in x.
+         *
+         * @param constant_sets CxK Array. One column of C constants per set.
+         *
+         * @param workspace Buffers used for the evaluation.
+         *
+         * @return const EvalAndDerivative& MxK values, column k for set k,
+         * and Mx(K*C) derivatives with respect to the constants, the
+         * Jacobian of set k in columns [k * C, (k + 1) * C). Owned by
+         * workspace and valid until its next use.
+         */
+        const EvalAndDerivative &EvaluateConstantSets(
+            const CompiledStack &program,
+            const Eigen::Ref<const Eigen::ArrayXXd> &x,
+            const Eigen::Ref<const Eigen::ArrayXXd> &constant_sets,
+            EvaluationWorkspace &workspace);
+
+        /**
+         * @brief Evaluate an equation and its constant Jacobian for several
+         * sets of constants in a single pass.
+         *
+         * Same as EvaluateConstantSets with a compiled program, compiling
+         * stack into the program of workspace.
+         */
+        const EvalAndDerivative &EvaluateConstantSets(
+            const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+            const Eigen::Ref<const Eigen::ArrayXXd> &x,
+            const Eigen::Ref<const Eigen::ArrayXXd> &constant_sets,
+            EvaluationWorkspace &workspace);
+
+        /**
+         * @brief Maximum number of equations evaluated in lock-step by
+         * EvaluateBatch.
+         */
+        constexpr int kBatchWidth = 8;
+
+        /**
+         * @brief Evaluate many equations at the same values x.
+         *
+         * Equations with identical stacks are evaluated in lock-step, up to
+         * kBatchWidth at a time: their constants are packed side by side as
+         * the constant sets of a single evaluation. Every row is then
+         * dispatched once for the whole group and its kernels run over the
+         * values of all of its equations, and rows that only depend on x
+         * are evaluated once for the group. This pays off for small
+         * datasets, where the cost of an evaluation is mostly per row
+         * rather than per sample.
+         *
+         * @param stacks Command stacks of the equations.
+         *
+         * @param x MxD Array. Values at which to evaluate the equations. D is the
+         * dimension in x and M is the number of data points in x.
+         *
+         * @param constants Constants of each equation, one column per
+         * constant set. Must hold one entry per stack.
+         *
+         * @param values Set to the evaluation of each equation, as returned
+         * by Evaluate.
+         *
+         * @param workspace Buffers used for the evaluation.
+         */
+        void EvaluateBatch(const std::vector<Eigen::ArrayX3i> &stacks,
+                           const Eigen::Ref<const Eigen::ArrayXXd> &x,
+                           const std::vector<Eigen::ArrayXXd> &constants,
+                           std::vector<Eigen::ArrayXXd> &values,
+                           EvaluationWorkspace &workspace);
+
+        /**
+         * @brief Evaluate many equations at the same values x.
+         *
+         * Same as EvaluateBatch with a workspace, using a temporary
+         * workspace.
+         *
+         * @return std::vector<Eigen::ArrayXXd> The evaluation of each
+         * equation.
+         */
+        std::vector<Eigen::ArrayXXd> EvaluateBatch(
+            const std::vector<Eigen::ArrayX3i> &stacks,
+            const Eigen::Ref<const Eigen::ArrayXXd> &x,
+            const std::vector<Eigen::ArrayXXd> &constants);
+
     } // namespace evaluation_backend
 } // namespace bingo
 #endif
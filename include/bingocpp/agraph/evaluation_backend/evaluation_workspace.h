@@ -0,0 +1,308 @@
+/*
+ * Copyright 2018 United States Government as represented by the Administrator
+ * of the National Aeronautics and Space Administration. No copyright is claimed
+ * in the United States under Title 17, U.S. Code. All Other Rights Reserved.
+ *
+ * The Bingo Mini-app platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#ifndef INCLUDE_BINGOCPP_EVALUATION_WORKSPACE_H_
+#define INCLUDE_BINGOCPP_EVALUATION_WORKSPACE_H_
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <Eigen/Dense>
+#include <Eigen/Core>
+
+#include <bingocpp/equation.h>
+#include <bingocpp/work_stealing_pool.h>
+#include <bingocpp/agraph/evaluation_backend/compiled_stack.h>
+
+namespace bingo
+{
+    namespace evaluation_backend
+    {
+        /**
+         * @brief A view of one buffer in an EvaluationWorkspace.
+         *
+         * The view can be reshaped to anything that fits in the capacity
+         * reserved by the workspace without touching the heap.
+         */
+        typedef Eigen::Map<Eigen::ArrayXXd> BufferView;
+
+        /**
+         * @brief A view of one single precision buffer in an
+         * EvaluationWorkspace.
+         */
+        typedef Eigen::Map<Eigen::ArrayXXf> SingleBufferView;
+
+        /**
+         * @brief Default number of samples evaluated at once.
+         *
+         * A tile of 512 samples keeps a handful of live buffers within L1.
+         */
+        constexpr int kDefaultTileSize = 512;
+
+        /**
+         * @brief Default number of samples below which evaluations stay on
+         * one thread.
+         */
+        constexpr int kDefaultParallelThreshold = 1 << 16;
+
+        /**
+         * @brief Reusable buffers for evaluating command stacks.
+         *
+         * Holds the forward and reverse buffers needed by Evaluate
+         * and EvaluateWithDerivative. Storage only grows, so once a workspace
+         * has seen the largest buffer count, sample count and number of
+         * constant sets it is used with, evaluation does not allocate.
+         *
+         * A workspace is not thread safe; use one per thread or per caller.
+         */
+        class EvaluationWorkspace
+        {
+        public:
+            EvaluationWorkspace();
+
+            EvaluationWorkspace(int num_buffers, int num_samples,
+                                int num_constant_sets = 1);
+
+            EvaluationWorkspace(const EvaluationWorkspace &) = delete;
+            EvaluationWorkspace &operator=(const EvaluationWorkspace &) = delete;
+            EvaluationWorkspace(EvaluationWorkspace &&) = default;
+            EvaluationWorkspace &operator=(EvaluationWorkspace &&) = default;
+
+            /**
+             * @brief Make sure the workspace can hold an evaluation.
+             *
+             * Grows the storage if needed and points every buffer at its
+             * slot. Existing buffer contents are not preserved.
+             *
+             * @param num_buffers Number of forward/reverse buffers needed.
+             *
+             * @param num_samples Number of rows in x.
+             *
+             * @param num_constant_sets Number of columns in the constants.
+             */
+            void Reserve(int num_buffers, int num_samples,
+                         int num_constant_sets = 1);
+
+            /**
+             * @brief Make sure the workspace can hold a single precision
+             * evaluation.
+             *
+             * Same as Reserve, for the single precision buffers. They are
+             * stored apart from the double buffers and only grow when
+             * single precision evaluations are made.
+             */
+            void ReserveSingle(int num_buffers, int num_samples,
+                               int num_constant_sets = 1);
+
+            /**
+             * @brief Set the number of samples evaluated at once.
+             *
+             * Datasets with more samples than the tile size are split into
+             * tiles, and the whole stack is evaluated over one tile before
+             * moving on to the next so that intermediate buffers stay in
+             * cache. A tile size of 0 evaluates all samples at once.
+             *
+             * @param tile_size Number of samples per tile.
+             */
+            void SetTileSize(int tile_size);
+
+            /**
+             * @brief Get the number of samples evaluated at once.
+             *
+             * @return int The tile size, 0 if tiling is disabled.
+             */
+            int GetTileSize() const;
+
+            /**
+             * @brief Bound the memory of the buffers an evaluation reserves.
+             *
+             * Derivative evaluations keep the value of every row a later
+             * reverse step reads, so their buffers grow with the depth of
+             * the stack. With a budget, tiles are shrunk until the buffers
+             * of one tile fit in it, so memory does not depend on the
+             * number of samples or on the tile size. The output arrays are
+             * not part of the budget. Setting a budget releases the
+             * buffers reserved before; parallel evaluations split it
+             * between their chunks.
+             *
+             * @param bytes Bytes of forward/reverse buffers. 0 (default)
+             * only bounds buffers by the tile size.
+             */
+            void SetMemoryBudget(std::size_t bytes);
+
+            /**
+             * @brief Get the memory budget of the buffers of an evaluation.
+             *
+             * @return std::size_t The budget in bytes, 0 if there is none.
+             */
+            std::size_t GetMemoryBudget() const;
+
+            /**
+             * @brief Set the number of threads an evaluation is split over.
+             *
+             * Evaluations of at least the parallel threshold samples are
+             * split into one contiguous chunk of whole tiles per thread.
+             * Every tile is evaluated as it would be on one thread, so the
+             * results do not depend on the number of threads.
+             *
+             * @param num_threads Number of threads, including the calling
+             * thread. 1 (default) disables parallel evaluation.
+             */
+            void SetNumThreads(int num_threads);
+
+            /**
+             * @brief Get the number of threads an evaluation is split over.
+             */
+            int GetNumThreads() const;
+
+            /**
+             * @brief Set the number of samples below which evaluations stay
+             * on the calling thread.
+             */
+            void SetParallelThreshold(int num_samples);
+
+            /**
+             * @brief Get the number of samples below which evaluations stay
+             * on the calling thread.
+             */
+            int GetParallelThreshold() const;
+
+            /**
+             * @brief Whether an evaluation of num_samples is split over
+             * threads.
+             */
+            bool IsParallel(int num_samples) const;
+
+            /**
+             * @brief Run task(chunk, chunk_workspace) for every chunk of a
+             * parallel evaluation and wait for all of them.
+             *
+             * Each chunk gets a workspace of its own with the tile size,
+             * accuracy and derivative mode of this one, and its share of
+             * the memory budget.
+             */
+            void RunChunks(
+                const std::function<void(int, EvaluationWorkspace &)> &task);
+
+            /**
+             * @brief Set the accuracy of the transcendental kernels used by
+             * evaluations with this workspace.
+             *
+             * @param accuracy kStrict (default) or kFast.
+             */
+            void SetAccuracy(Accuracy accuracy);
+
+            /**
+             * @brief Get the accuracy of evaluations with this workspace.
+             */
+            Accuracy GetAccuracy() const;
+
+            /**
+             * @brief Set how derivatives are propagated by evaluations with
+             * this workspace.
+             *
+             * @param mode kAutomatic (default), kForwardMode or kReverseMode.
+             * Forward mode is only used with a single set of constants.
+             */
+            void SetDerivativeMode(DerivativeMode mode);
+
+            /**
+             * @brief Get how derivatives are propagated by evaluations with
+             * this workspace.
+             */
+            DerivativeMode GetDerivativeMode() const;
+
+            /**
+             * @brief Reshape a forward buffer in place.
+             *
+             * @return BufferView& The forward buffer at index.
+             */
+            BufferView &ShapeForwardBuffer(int index, int rows, int cols);
+
+            /**
+             * @brief Reshape a reverse buffer in place.
+             *
+             * @return BufferView& The reverse buffer at index.
+             */
+            BufferView &ShapeReverseBuffer(int index, int rows, int cols);
+
+            /**
+             * @brief Reshape a single precision forward buffer in place.
+             *
+             * @return SingleBufferView& The single precision buffer at index.
+             */
+            SingleBufferView &ShapeSingleBuffer(int index, int rows, int cols);
+
+            // Program compiled from the last command stack evaluated directly
+            CompiledStack program;
+            // Values of stack rows during forward evaluation
+            std::vector<BufferView> forward_eval;
+            // Adjoints of stack rows during reverse evaluation
+            std::vector<BufferView> reverse_eval;
+            // Output of the last evaluation: value and derivative
+            EvalAndDerivative result;
+            // Output of the last normal equations evaluation
+            EvalAndNormalEquations normal_equations;
+            // Values of stack rows during single precision evaluation
+            std::vector<SingleBufferView> single_eval;
+            // Constants of the last single precision evaluation
+            Eigen::ArrayXXf single_constants;
+            // Output of the last single precision evaluation
+            Eigen::ArrayXXf single_result;
+
+        private:
+            int tile_size_;
+            std::size_t memory_budget_;
+            Accuracy accuracy_;
+            DerivativeMode derivative_mode_;
+            int parallel_threshold_;
+            std::unique_ptr<WorkStealingPool> pool_;
+            std::vector<std::unique_ptr<EvaluationWorkspace>> chunk_workspaces_;
+            int forward_size_;
+            int reverse_size_;
+            Eigen::ArrayXd forward_storage_;
+            Eigen::ArrayXd reverse_storage_;
+            int single_size_;
+            Eigen::ArrayXf single_storage_;
+        };
+
+        /**
+         * @brief The workspace used by AGraph evaluations on this thread.
+         */
+        EvaluationWorkspace &ThreadWorkspace();
+
+        /**
+         * @brief Sets the accuracy of a workspace for the lifetime of the
+         * scope and restores the previous accuracy afterwards.
+         */
+        class AccuracyScope
+        {
+        public:
+            AccuracyScope(EvaluationWorkspace &workspace, Accuracy accuracy);
+
+            ~AccuracyScope();
+
+            AccuracyScope(const AccuracyScope &) = delete;
+            AccuracyScope &operator=(const AccuracyScope &) = delete;
+
+        private:
+            EvaluationWorkspace &workspace_;
+            Accuracy previous_;
+        };
+    } // namespace evaluation_backend
+} // namespace bingo
+#endif
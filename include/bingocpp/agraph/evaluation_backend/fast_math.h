@@ -0,0 +1,311 @@
+/*
+ * Copyright 2018 United States Government as represented by the Administrator
+ * of the National Aeronautics and Space Administration. No copyright is claimed
+ * in the United States under Title 17, U.S. Code. All Other Rights Reserved.
+ *
+ * The Bingo Mini-app platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#ifndef INCLUDE_BINGOCPP_FAST_MATH_H_
+#define INCLUDE_BINGOCPP_FAST_MATH_H_
+
+#include <cmath>
+#include <limits>
+
+#include <Eigen/Dense>
+
+namespace bingo
+{
+    namespace evaluation_backend
+    {
+        /**
+         * @brief Vectorized approximations of the transcendental functions.
+         *
+         * Every function is written against Eigen's packet primitives, so
+         * the same code runs on SSE2, AVX2 or AVX-512 registers, whichever
+         * the library is compiled for, and on single doubles for the
+         * remainder of an array. Results are within a few ulp of the
+         * standard library for the arguments that show up in equations.
+         */
+        namespace fast_math
+        {
+            // pi / 2 split in three parts for Cody-Waite range reduction;
+            // the first part has 33 significant bits so j * part is exact
+            // for |x| < 2^20
+            constexpr double kPiOverTwo1 = 1.57079632673412561417e+00;
+            constexpr double kPiOverTwo2 = 6.07710050630396597660e-11;
+            constexpr double kPiOverTwo3 = 2.02226624879595063154e-21;
+            constexpr double kTwoOverPi = 6.36619772367581382433e-01;
+
+            // minimax coefficients on [-pi/4, pi/4] (Cephes)
+            constexpr double kSinCoefficients[] = {
+                1.58962301576546568060e-10, -2.50507477628578072866e-8,
+                2.75573136213857245213e-6, -1.98412698295895385996e-4,
+                8.33333333332211858878e-3, -1.66666666666666307295e-1};
+            constexpr double kCosCoefficients[] = {
+                -1.13585365213876817300e-11, 2.08757008419747316778e-9,
+                -2.75573141792967388112e-7, 2.48015872888517045348e-5,
+                -1.38888888888730564116e-3, 4.16666666666665929218e-2};
+
+            // Taylor series of sinh(x) / x - 1 in x^2, used for |x| < 1/2
+            constexpr double kSinhCoefficients[] = {
+                1.0 / 6227020800.0, 1.0 / 39916800.0, 1.0 / 362880.0,
+                1.0 / 5040.0, 1.0 / 120.0, 1.0 / 6.0};
+            constexpr double kSinhSeriesLimit = 0.5;
+
+            template <typename Packet, int N>
+            EIGEN_STRONG_INLINE Packet polynomial(
+                const Packet &z, const double (&coefficients)[N])
+            {
+                using namespace Eigen::internal;
+                Packet result = pset1<Packet>(coefficients[0]);
+                for (int i = 1; i < N; ++i)
+                {
+                    result = pmadd(result, z, pset1<Packet>(coefficients[i]));
+                }
+                return result;
+            }
+
+            // sin(x + quadrant_shift * pi / 2)
+            template <int kQuadrantShift, typename Packet>
+            EIGEN_STRONG_INLINE Packet sin_quadrant(const Packet &x)
+            {
+                using namespace Eigen::internal;
+                const Packet j = pfloor(pmadd(x, pset1<Packet>(kTwoOverPi),
+                                              pset1<Packet>(0.5)));
+                Packet r = psub(x, pmul(j, pset1<Packet>(kPiOverTwo1)));
+                r = psub(r, pmul(j, pset1<Packet>(kPiOverTwo2)));
+                r = psub(r, pmul(j, pset1<Packet>(kPiOverTwo3)));
+
+                // quadrant of x as 0, 1, 2 or 3
+                Packet quadrant = padd(j, pset1<Packet>(kQuadrantShift));
+                quadrant = psub(quadrant,
+                                pmul(pset1<Packet>(4.0),
+                                     pfloor(pmul(quadrant,
+                                                 pset1<Packet>(0.25)))));
+
+                const Packet z = pmul(r, r);
+                const Packet sin_r = pmadd(pmul(r, z),
+                                           polynomial(z, kSinCoefficients), r);
+                const Packet cos_r = pmadd(
+                    pmul(z, z), polynomial(z, kCosCoefficients),
+                    pmadd(pset1<Packet>(-0.5), z, pset1<Packet>(1.0)));
+
+                const Packet half_quadrant = pmul(quadrant, pset1<Packet>(0.5));
+                const Packet is_odd = pcmp_lt(pfloor(half_quadrant),
+                                              half_quadrant);
+                const Packet result = pselect(is_odd, cos_r, sin_r);
+                return pselect(pcmp_le(pset1<Packet>(2.0), quadrant),
+                               pnegate(result), result);
+            }
+
+            template <typename Packet>
+            EIGEN_STRONG_INLINE Packet sin(const Packet &x)
+            {
+                return sin_quadrant<0>(x);
+            }
+
+            template <typename Packet>
+            EIGEN_STRONG_INLINE Packet cos(const Packet &x)
+            {
+                return sin_quadrant<1>(x);
+            }
+
+            template <typename Packet>
+            EIGEN_STRONG_INLINE Packet sinh(const Packet &x)
+            {
+                using namespace Eigen::internal;
+                const Packet one = pset1<Packet>(1.0);
+                const Packet abs_x = pabs(x);
+                const Packet exp_x = pexp(abs_x);
+                Packet large = pmul(pset1<Packet>(0.5),
+                                    psub(exp_x, pdiv(one, exp_x)));
+                large = pselect(pcmp_lt(x, pzero(x)), pnegate(large), large);
+                // e^x - e^-x cancels near zero
+                const Packet z = pmul(x, x);
+                const Packet small = pmadd(pmul(x, z),
+                                           polynomial(z, kSinhCoefficients), x);
+                return pselect(pcmp_lt(abs_x, pset1<Packet>(kSinhSeriesLimit)),
+                               small, large);
+            }
+
+            template <typename Packet>
+            EIGEN_STRONG_INLINE Packet cosh(const Packet &x)
+            {
+                using namespace Eigen::internal;
+                const Packet exp_x = pexp(pabs(x));
+                return pmul(pset1<Packet>(0.5),
+                            padd(exp_x, pdiv(pset1<Packet>(1.0), exp_x)));
+            }
+
+            // exp(y log|x|) with the sign and domain rules of std::pow; the
+            // error grows with |y log x|
+            template <typename Packet>
+            EIGEN_STRONG_INLINE Packet pow(const Packet &x, const Packet &y)
+            {
+                using namespace Eigen::internal;
+                const Packet one = pset1<Packet>(1.0);
+                Packet result = pexp(pmul(y, plog(pabs(x))));
+
+                const Packet y_is_integer = pcmp_eq(pfloor(y), y);
+                const Packet half_y = pmul(y, pset1<Packet>(0.5));
+                const Packet y_is_odd = pandnot(y_is_integer,
+                                                pcmp_eq(pfloor(half_y), half_y));
+                const Packet x_is_negative = pcmp_lt(x, pzero(x));
+                result = pselect(pand(x_is_negative, y_is_odd),
+                                 pnegate(result), result);
+                result = pselect(
+                    pandnot(x_is_negative, y_is_integer),
+                    pset1<Packet>(std::numeric_limits<double>::quiet_NaN()),
+                    result);
+                return pselect(por(pcmp_eq(y, pzero(y)), pcmp_eq(x, one)),
+                               one, result);
+            }
+        } // namespace fast_math
+
+        // Eigen's exp and log on two-wide SSE2 registers lose to the scalar
+        // pow of the C library, so pow is only approximated on wider ones
+#ifdef EIGEN_VECTORIZE_AVX
+        constexpr bool kVectorizedPow = true;
+#else
+        constexpr bool kVectorizedPow = false;
+#endif
+
+        struct FastSinOp
+        {
+            EIGEN_STRONG_INLINE double operator()(const double &x) const
+            {
+                return fast_math::sin(x);
+            }
+            template <typename Packet>
+            EIGEN_STRONG_INLINE Packet packetOp(const Packet &x) const
+            {
+                return fast_math::sin(x);
+            }
+        };
+
+        struct FastCosOp
+        {
+            EIGEN_STRONG_INLINE double operator()(const double &x) const
+            {
+                return fast_math::cos(x);
+            }
+            template <typename Packet>
+            EIGEN_STRONG_INLINE Packet packetOp(const Packet &x) const
+            {
+                return fast_math::cos(x);
+            }
+        };
+
+        struct FastSinhOp
+        {
+            EIGEN_STRONG_INLINE double operator()(const double &x) const
+            {
+                return fast_math::sinh(x);
+            }
+            template <typename Packet>
+            EIGEN_STRONG_INLINE Packet packetOp(const Packet &x) const
+            {
+                return fast_math::sinh(x);
+            }
+        };
+
+        struct FastCoshOp
+        {
+            EIGEN_STRONG_INLINE double operator()(const double &x) const
+            {
+                return fast_math::cosh(x);
+            }
+            template <typename Packet>
+            EIGEN_STRONG_INLINE Packet packetOp(const Packet &x) const
+            {
+                return fast_math::cosh(x);
+            }
+        };
+
+        struct FastPowOp
+        {
+            EIGEN_STRONG_INLINE double operator()(const double &x,
+                                                  const double &y) const
+            {
+                return kVectorizedPow ? fast_math::pow(x, y) : std::pow(x, y);
+            }
+            template <typename Packet>
+            EIGEN_STRONG_INLINE Packet packetOp(const Packet &x,
+                                                const Packet &y) const
+            {
+                return fast_math::pow(x, y);
+            }
+        };
+    } // namespace evaluation_backend
+} // namespace bingo
+
+namespace Eigen
+{
+    namespace internal
+    {
+        template <>
+        struct functor_traits<bingo::evaluation_backend::FastSinOp>
+        {
+            enum
+            {
+                Cost = 20 * NumTraits<double>::MulCost,
+                PacketAccess = packet_traits<double>::HasFloor
+            };
+        };
+
+        template <>
+        struct functor_traits<bingo::evaluation_backend::FastCosOp>
+        {
+            enum
+            {
+                Cost = 20 * NumTraits<double>::MulCost,
+                PacketAccess = packet_traits<double>::HasFloor
+            };
+        };
+
+        template <>
+        struct functor_traits<bingo::evaluation_backend::FastSinhOp>
+        {
+            enum
+            {
+                Cost = 30 * NumTraits<double>::MulCost,
+                PacketAccess = packet_traits<double>::HasExp &&
+                               packet_traits<double>::HasDiv
+            };
+        };
+
+        template <>
+        struct functor_traits<bingo::evaluation_backend::FastCoshOp>
+        {
+            enum
+            {
+                Cost = 25 * NumTraits<double>::MulCost,
+                PacketAccess = packet_traits<double>::HasExp &&
+                               packet_traits<double>::HasDiv
+            };
+        };
+
+        template <>
+        struct functor_traits<bingo::evaluation_backend::FastPowOp>
+        {
+            enum
+            {
+                Cost = 40 * NumTraits<double>::MulCost,
+                PacketAccess = bingo::evaluation_backend::kVectorizedPow &&
+                               packet_traits<double>::HasExp &&
+                               packet_traits<double>::HasLog &&
+                               packet_traits<double>::HasFloor
+            };
+        };
+    } // namespace internal
+} // namespace Eigen
+#endif
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2018 United States Government as represented by the Administrator
+ * of the National Aeronautics and Space Administration. No copyright is claimed
+ * in the United States under Title 17, U.S. Code. All Other Rights Reserved.
+ *
+ * The Bingo Mini-app platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#ifndef INCLUDE_BINGOCPP_FOLDED_STACK_H_
+#define INCLUDE_BINGOCPP_FOLDED_STACK_H_
+
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <bingocpp/agraph/evaluation_backend/compiled_stack.h>
+#include <bingocpp/agraph/evaluation_backend/evaluation_workspace.h>
+
+namespace bingo
+{
+    namespace evaluation_backend
+    {
+        /**
+         * @brief A compiled command stack with x-independent subtrees folded.
+         *
+         * Subtrees that only depend on constants and integers are evaluated
+         * once per set of constants. In the compiled program each of them
+         * is replaced by a load of an extra constant, appended after the
+         * equation's own constants. Derivatives with respect to the extra
+         * constants are chained back to the equation's constants through the
+         * gradients of the folded subtrees.
+         */
+        class FoldedStack
+        {
+        public:
+            FoldedStack();
+
+            /**
+             * @brief Find the x-independent subtrees of stack and compile
+             * the remaining program.
+             *
+             * @param stack Nx3 array. The command stack associated with an
+             * equation.
+             *
+             * @param num_constants Number of constants used by the stack.
+             */
+            void Compile(const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+                         int num_constants);
+
+            /**
+             * @brief Evaluate the folded subtrees for constants.
+             *
+             * Nothing is evaluated if constants and the accuracy of
+             * workspace did not change since the last call.
+             *
+             * @param constants Constants that are used in the equation.
+             *
+             * @param workspace Buffers used to evaluate the subtrees.
+             *
+             * @return const Eigen::ArrayXXd& The constants to evaluate the
+             * program with: constants followed by the folded values.
+             */
+            const Eigen::ArrayXXd &Fold(const Eigen::ArrayXXd &constants,
+                                        EvaluationWorkspace &workspace);
+
+            /**
+             * @brief Derivative with respect to the equation's constants.
+             *
+             * Only valid after Fold with a single set of constants.
+             *
+             * @param program_derivative Derivative of the program with
+             * respect to the constants returned by Fold.
+             *
+             * @return Eigen::ArrayXXd Derivative with respect to the
+             * constants passed to Fold.
+             */
+            Eigen::ArrayXXd ConstantDerivative(
+                const Eigen::ArrayXXd &program_derivative) const;
+
+            /**
+             * @brief The compiled program with folded subtrees replaced.
+             */
+            const CompiledStack &GetProgram() const;
+
+            /**
+             * @brief Number of folded subtrees.
+             */
+            int GetNumFolded() const;
+
+        private:
+            int num_constants_;
+            Eigen::ArrayX3i stack_;
+            CompiledStack program_;
+            // One program per folded subtree, ending at its root
+            std::vector<CompiledStack> subtrees_;
+            Eigen::ArrayXXd folded_for_;
+            Accuracy folded_with_;
+            bool is_folded_;
+            Eigen::ArrayXXd extended_constants_;
+            // Gradient of each folded value wrt the equation's constants
+            Eigen::ArrayXXd jacobian_;
+        };
+    } // namespace evaluation_backend
+} // namespace bingo
+#endif
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2018 United States Government as represented by the Administrator
+ * of the National Aeronautics and Space Administration. No copyright is claimed
+ * in the United States under Title 17, U.S. Code. All Other Rights Reserved.
+ *
+ * The Bingo Mini-app platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#ifndef INCLUDE_BINGOCPP_FORWARD_TAPE_H_
+#define INCLUDE_BINGOCPP_FORWARD_TAPE_H_
+
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <bingocpp/agraph/evaluation_backend/dataset_fingerprint.h>
+#include <bingocpp/agraph/evaluation_backend/evaluation_workspace.h>
+
+namespace bingo
+{
+    namespace evaluation_backend
+    {
+        /**
+         * @brief The forward buffers of an evaluation, kept so that a later
+         * derivative evaluation only runs the reverse sweep.
+         *
+         * Recorded by EvaluateAndRecord for a single set of constants and
+         * only valid for the program it was recorded with.
+         */
+        struct ForwardTape
+        {
+            DatasetFingerprint dataset;
+            Eigen::ArrayXXd constants;
+            Accuracy accuracy;
+            int num_samples;
+            int num_dimensions;
+            int tile_size;
+            int num_buffers;
+            // the forward buffers of every tile, one tile after the other
+            Eigen::ArrayXd storage;
+            // rows of every forward buffer of every tile
+            std::vector<int> rows;
+            Eigen::ArrayXXd value;
+
+            /**
+             * @brief Whether the tape was recorded over x, with constants
+             * and accuracy.
+             */
+            bool IsTapeOf(const Eigen::Ref<const Eigen::ArrayXXd> &x,
+                          const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+                          Accuracy accuracy) const;
+        };
+    } // namespace evaluation_backend
+} // namespace bingo
+#endif
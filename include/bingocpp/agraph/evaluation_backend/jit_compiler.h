@@ -0,0 +1,146 @@
+/*
+ * Copyright 2018 United States Government as represented by the Administrator
+ * of the National Aeronautics and Space Administration. No copyright is claimed
+ * in the United States under Title 17, U.S. Code. All Other Rights Reserved.
+ *
+ * The Bingo Mini-app platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#ifndef INCLUDE_BINGOCPP_JIT_COMPILER_H_
+#define INCLUDE_BINGOCPP_JIT_COMPILER_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <Eigen/Dense>
+
+#include <bingocpp/equation.h>
+
+namespace bingo
+{
+    namespace evaluation_backend
+    {
+        const std::size_t kDefaultJitCacheCapacity = 256;
+
+        /**
+         * @brief A command stack compiled to native code.
+         *
+         * The stack is turned into straight-line C++ that evaluates one
+         * sample at a time, built into a shared object by the system
+         * compiler and loaded with dlopen. Only a single set of constants
+         * is supported.
+         */
+        class JitFunction
+        {
+        public:
+            typedef void (*ForwardFunction)(const double *x, long num_samples,
+                                            const double *constants,
+                                            double *value);
+            typedef void (*GradientFunction)(const double *x, long num_samples,
+                                             const double *constants,
+                                             double *value,
+                                             double *derivative);
+
+            JitFunction(void *handle, ForwardFunction forward,
+                        GradientFunction gradient);
+            ~JitFunction();
+
+            JitFunction(const JitFunction &) = delete;
+            JitFunction &operator=(const JitFunction &) = delete;
+
+            /**
+             * @brief Evaluate the equation.
+             *
+             * @param x MxD Array. Values at which to evaluate the equation.
+             *
+             * @param constants Kx1 Array. Constants used in the equation.
+             *
+             * @param value Mx1 output, resized as needed.
+             */
+            void Evaluate(const Eigen::ArrayXXd &x,
+                          const Eigen::ArrayXXd &constants,
+                          Eigen::ArrayXXd &value) const;
+
+            /**
+             * @brief Evaluate the equation and its derivative with respect
+             * to the constants.
+             *
+             * @param x MxD Array. Values at which to evaluate the equation.
+             *
+             * @param constants Kx1 Array. Constants used in the equation.
+             *
+             * @param result Mx1 value and MxK derivative, resized as needed.
+             */
+            void EvaluateWithConstantDerivative(
+                const Eigen::ArrayXXd &x, const Eigen::ArrayXXd &constants,
+                EvalAndDerivative &result) const;
+
+        private:
+            void *handle_;
+            ForwardFunction forward_;
+            GradientFunction gradient_;
+        };
+
+        /**
+         * @brief Generate the C++ source compiled for a command stack.
+         *
+         * @param stack Nx3 array. A simplified command stack.
+         *
+         * @return std::string Source defining the extern "C" functions
+         * bingo_jit_forward and bingo_jit_gradient.
+         */
+        std::string GenerateJitSource(
+            const Eigen::Ref<const Eigen::ArrayX3i> &stack);
+
+        /**
+         * @brief Compile a command stack to native code.
+         *
+         * Compiled functions are cached by the structure of the stack, so
+         * each structure is compiled once while it stays in the cache.
+         * Failures are cached as well. The cache holds a bounded number of
+         * stacks (see SetJitCacheCapacity) and evicts the least recently
+         * used one first. Stacks are compiled without blocking callers
+         * that want other stacks; callers wanting a stack that is being
+         * compiled wait for it.
+         *
+         * @param stack Nx3 array. A simplified command stack.
+         *
+         * @return std::shared_ptr<const JitFunction> The compiled function,
+         * or nullptr if the stack could not be compiled.
+         */
+        std::shared_ptr<const JitFunction> JitCompile(
+            const Eigen::Ref<const Eigen::ArrayX3i> &stack);
+
+        /**
+         * @brief Set the command used to build shared objects.
+         *
+         * The command is split at whitespace and run directly, without a
+         * shell; the source file and "-o <shared object>" are appended. The
+         * default is "c++ -O2 -fPIC -shared", or the BINGOCPP_JIT_CXX
+         * environment variable followed by "-fPIC -shared" if it is set.
+         *
+         * @param command Compiler and flags.
+         */
+        void SetJitCompiler(const std::string &command);
+
+        /**
+         * @brief Set the number of compiled stacks kept by JitCompile.
+         *
+         * Evicted functions stay loaded while AGraphs still use them.
+         *
+         * @param capacity Number of stacks (default kDefaultJitCacheCapacity).
+         */
+        void SetJitCacheCapacity(std::size_t capacity);
+        std::size_t GetJitCacheCapacity();
+    } // namespace evaluation_backend
+} // namespace bingo
+#endif
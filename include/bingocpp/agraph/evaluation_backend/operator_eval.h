@@ -17,30 +17,97 @@
 #ifndef INCLUDE_BINGOCPP_BACKEND_OPERATOR_EVAL_H_
 #define INCLUDE_BINGOCPP_BACKEND_OPERATOR_EVAL_H_
 
-#include <vector>
-
 #include <Eigen/Dense>
 
+#include <bingocpp/agraph/evaluation_backend/evaluation_workspace.h>
+
 namespace bingo
 {
     namespace evaluation_backend
     {
 
+        /*
+         * Kernel that evaluates operation node in the forward direction. If
+         * broadcast is false the kernel assumes both operands already have
+         * the shape of the result and skips all broadcasting. Accuracy
+         * picks between strict and fast transcendental functions.
+         */
+        ForwardKernel GetForwardKernel(int node, bool broadcast,
+                                       Accuracy accuracy = kStrict);
+
+        /*
+         * Kernel that evaluates operation node in the reverse direction. If
+         * broadcast is false the kernel assumes the forward values it reads
+         * already have the shape of the adjoint.
+         */
+        ReverseKernel GetReverseKernel(int node, bool broadcast,
+                                       Accuracy accuracy = kStrict);
+
+        /*
+         * Evaluates a fused chain into the forward buffer at result, which
+         * has the given shape. The chain is evaluated a small block of
+         * samples at a time so that intermediate values are never stored.
+         */
+        void FusedForwardEval(const FusedChain &chain, int result,
+                              ShapeClass shape,
+                              const Eigen::Ref<const Eigen::ArrayXXd> &x,
+                              const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+                              EvaluationWorkspace &workspace);
+
         /*
          * Maps param1, param2, x, constants, and forward eval to the correct
-         * forward eval function corresponding to the operation node.
+         * forward eval function corresponding to the operation node. The
+         * result is written to the forward buffer at result_index.
+         */
+        void ForwardEvalFunction(int node, int result_index,
+                                 int param1, int param2,
+                                 const Eigen::Ref<const Eigen::ArrayXXd> &x,
+                                 const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+                                 EvaluationWorkspace &workspace);
+        /*
+         * Evaluates the tangents of an operation node in forward mode. The
+         * values of the row and its operands are read from the forward
+         * buffers in forward. The tangent of direction d of the operands is
+         * read from the forward buffer at tangent.param1 + d and
+         * tangent.param2 + d, and written to tangent.result + d. Tangents
+         * have one value per sample; values are broadcast to them. Empty
+         * tangents are zero.
+         */
+        void TangentEvalFunction(int node, const RowBuffers &forward,
+                                 const RowBuffers &tangent,
+                                 int num_directions,
+                                 EvaluationWorkspace &workspace);
+
+        /*
+         * Single precision version of ForwardEvalFunction. The result is
+         * written to the single precision buffer at result_index. Operands
+         * are broadcast as needed; transcendental functions are always the
+         * Eigen ones, which are vectorized for float.
          */
-        Eigen::ArrayXXd ForwardEvalFunction(int node, int param1, int param2,
-                                            const Eigen::ArrayXXd &x,
-                                            const Eigen::ArrayXXd &constants,
-                                            std::vector<Eigen::ArrayXXd> &forward_eval);
+        void SingleForwardEvalFunction(
+            int node, int result_index, int param1, int param2,
+            const Eigen::Ref<const Eigen::ArrayXXf> &x,
+            const Eigen::Ref<const Eigen::ArrayXXf> &constants,
+            EvaluationWorkspace &workspace);
+
+        /*
+         * Maps the forward and reverse buffers of a stack row to the
+         * corresponding reverse eval function of the operation node. The
+         * adjoint of the row is read from reverse.result and propagated to
+         * reverse.param1 and reverse.param2.
+         */
+        void ReverseEvalFunction(int node, const RowBuffers &forward,
+                                 const RowBuffers &reverse,
+                                 EvaluationWorkspace &workspace);
+
         /*
-         * Maps reverse_index, param1, param2, forward evaluation stack and
-         * revese evaluation stack to the corresponding operation node.
+         * Whether the reverse eval function of node reads the forward value
+         * of its first operand, its second operand, or its own result. Those
+         * forward values must still be available during reverse evaluation.
          */
-        void ReverseEvalFunction(int node, int reverse_index, int param1, int param2,
-                                 const std::vector<Eigen::ArrayXXd> &forward_eval,
-                                 std::vector<Eigen::ArrayXXd> &reverse_eval);
+        bool ReverseUsesParam1(int node);
+        bool ReverseUsesParam2(int node);
+        bool ReverseUsesResult(int node);
     }
 } // namespace bingo
 
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2018 United States Government as represented by the Administrator
+ * of the National Aeronautics and Space Administration. No copyright is claimed
+ * in the United States under Title 17, U.S. Code. All Other Rights Reserved.
+ *
+ * The Bingo Mini-app platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#ifndef INCLUDE_BINGOCPP_ROW_CACHE_H_
+#define INCLUDE_BINGOCPP_ROW_CACHE_H_
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <bingocpp/agraph/evaluation_backend/dataset_fingerprint.h>
+#include <bingocpp/agraph/evaluation_backend/evaluation_workspace.h>
+
+namespace bingo
+{
+    namespace evaluation_backend
+    {
+        /**
+         * @brief The values of every row of a command stack over a dataset.
+         *
+         * A row is identified by its operation and the identities of its
+         * operands; constants by their value. The values of a row are
+         * immutable and shared by every cache that has an identical row for
+         * the same dataset, so a mutated copy of an equation only computes
+         * the rows downstream of the mutation and shares the rest with its
+         * parent.
+         */
+        class RowCache
+        {
+        public:
+            typedef std::array<std::int64_t, 3> RowKey;
+
+            /**
+             * @brief Whether the cache holds values over x, computed with
+             * accuracy.
+             */
+            bool IsCacheOf(const Eigen::Ref<const Eigen::ArrayXXd> &x,
+                           Accuracy accuracy) const;
+
+            /**
+             * @brief The value of the last row: Mx1, or 1x1 if the equation
+             * does not depend on x.
+             */
+            const Eigen::ArrayXXd &GetValue() const;
+
+            /**
+             * @brief Number of rows whose values were shared with the
+             * previous cache instead of being computed.
+             */
+            int GetNumReused() const;
+
+        private:
+            friend std::shared_ptr<const RowCache> EvaluateRows(
+                const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+                const Eigen::Ref<const Eigen::ArrayXXd> &x,
+                const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+                const std::shared_ptr<const RowCache> &previous,
+                EvaluationWorkspace &workspace);
+
+            DatasetFingerprint dataset_;
+            Accuracy accuracy_;
+            // Values of the rows of the stack
+            std::vector<std::shared_ptr<const Eigen::ArrayXXd>> values_;
+            // First row of every distinct row identity
+            std::map<RowKey, int> rows_;
+            int num_reused_;
+        };
+
+        /**
+         * @brief Evaluate every row of a command stack, sharing the values
+         * of rows that are identical to rows of a previous evaluation.
+         *
+         * A row is reused if the previous cache has a row with the same
+         * operation over reused operands (or the same terminal), so only
+         * the rows downstream of a change are evaluated, tile by tile.
+         * Keeps one array per row alive for as long as the cache or one of
+         * its successors holds it.
+         *
+         * @param stack Nx3 array. A simplified command stack.
+         *
+         * @param x MxD Array. Values at which to evaluate the equation.
+         *
+         * @param constants Cx1 Array. Constants used in the equation.
+         *
+         * @param previous Cache of an earlier evaluation, or nullptr. Only
+         * used if it holds values over x at the accuracy of workspace.
+         *
+         * @param workspace Buffers used for the evaluation.
+         *
+         * @return std::shared_ptr<const RowCache> The values of the rows.
+         */
+        std::shared_ptr<const RowCache> EvaluateRows(
+            const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+            const Eigen::Ref<const Eigen::ArrayXXd> &x,
+            const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+            const std::shared_ptr<const RowCache> &previous,
+            EvaluationWorkspace &workspace);
+    } // namespace evaluation_backend
+} // namespace bingo
+#endif
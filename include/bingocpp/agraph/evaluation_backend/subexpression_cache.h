@@ -0,0 +1,154 @@
+/*
+ * Copyright 2018 United States Government as represented by the Administrator
+ * of the National Aeronautics and Space Administration. No copyright is claimed
+ * in the United States under Title 17, U.S. Code. All Other Rights Reserved.
+ *
+ * The Bingo Mini-app platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#ifndef INCLUDE_BINGOCPP_SUBEXPRESSION_CACHE_H_
+#define INCLUDE_BINGOCPP_SUBEXPRESSION_CACHE_H_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include <Eigen/Dense>
+
+#include <bingocpp/agraph/evaluation_backend/dataset_fingerprint.h>
+#include <bingocpp/agraph/evaluation_backend/evaluation_workspace.h>
+
+namespace bingo
+{
+    namespace evaluation_backend
+    {
+        const std::size_t kDefaultSubexpressionBudget = std::size_t(1) << 28;
+
+        /**
+         * @brief Values of the subexpressions of a population of equations
+         * over one dataset.
+         *
+         * Subexpressions are hash-consed: each distinct operation over
+         * distinct operands gets an id, with the operands of commutative
+         * operations in a canonical order and constants identified by their
+         * value, so a subtree shared by several equations has the same id in
+         * all of them whatever rows it occupies. The values of the ids are
+         * kept while they fit in the memory budget. Values that were not
+         * used during a generation are dropped when the next one starts.
+         * Safe to share between threads.
+         */
+        class SubexpressionCache
+        {
+        public:
+            typedef std::array<std::int64_t, 3> NodeKey;
+
+            /**
+             * @param memory_budget Bytes of values and ids the cache may
+             * hold.
+             */
+            explicit SubexpressionCache(
+                std::size_t memory_budget = kDefaultSubexpressionBudget);
+
+            /**
+             * @brief Start a new generation, dropping the values that were
+             * not used since the last one started.
+             */
+            void NewGeneration();
+
+            /**
+             * @brief Drop every value and id.
+             */
+            void Clear();
+
+            std::size_t GetMemoryBudget() const;
+            std::size_t GetMemoryUsage() const;
+
+            /**
+             * @brief Number of subexpressions read from the cache, and
+             * evaluated because they were not in it.
+             */
+            long GetNumHits() const;
+            long GetNumMisses() const;
+
+        private:
+            friend Eigen::ArrayXXd EvaluateShared(
+                const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+                const Eigen::Ref<const Eigen::ArrayXXd> &x,
+                const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+                SubexpressionCache &cache,
+                EvaluationWorkspace &workspace);
+
+            struct NodeKeyHash
+            {
+                std::size_t operator()(const NodeKey &key) const;
+            };
+
+            struct Column
+            {
+                std::shared_ptr<const Eigen::ArrayXXd> value;
+                long last_used;
+            };
+
+            // All of the below are guarded by mutex_
+            // Drops everything if the values are not over x with accuracy
+            void use_dataset(const Eigen::Ref<const Eigen::ArrayXXd> &x,
+                             Accuracy accuracy);
+            std::int64_t intern(const NodeKey &key);
+            void clear();
+
+            std::size_t memory_budget_;
+            std::size_t column_bytes_;
+            bool has_dataset_;
+            DatasetFingerprint dataset_;
+            Accuracy accuracy_;
+            // Id of every distinct subexpression
+            std::unordered_map<NodeKey, std::int64_t, NodeKeyHash> ids_;
+            std::unordered_map<std::int64_t, Column> columns_;
+            std::int64_t next_id_;
+            long generation_;
+            long num_hits_;
+            long num_misses_;
+            mutable std::mutex mutex_;
+        };
+
+        /**
+         * @brief Evaluate a command stack, reading the subexpressions it
+         * shares with previously evaluated stacks from a cache.
+         *
+         * Only the rows needed by subexpressions that are not in the cache
+         * are evaluated, tile by tile, and their values are added to the
+         * cache while it has room. Identical rows of the stack are
+         * evaluated once.
+         *
+         * @param stack Nx3 array. A simplified command stack.
+         *
+         * @param x MxD Array. Values at which to evaluate the equation.
+         *
+         * @param constants Cx1 Array. Constants used in the equation.
+         *
+         * @param cache Values of the subexpressions. Dropped if they are not
+         * over x at the accuracy of workspace.
+         *
+         * @param workspace Buffers used for the evaluation.
+         *
+         * @return Eigen::ArrayXXd Mx1 array. The value of the equation.
+         */
+        Eigen::ArrayXXd EvaluateShared(
+            const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+            const Eigen::Ref<const Eigen::ArrayXXd> &x,
+            const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+            SubexpressionCache &cache,
+            EvaluationWorkspace &workspace);
+    } // namespace evaluation_backend
+} // namespace bingo
+#endif
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2018 United States Government as represented by the Administrator
+ * of the National Aeronautics and Space Administration. No copyright is claimed
+ * in the United States under Title 17, U.S. Code. All Other Rights Reserved.
+ *
+ * The Bingo Mini-app platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#ifndef BINGOCPP_INCLUDE_BINGOCPP_AGRAPH_PACKED_COMMAND_ARRAY_H_
+#define BINGOCPP_INCLUDE_BINGOCPP_AGRAPH_PACKED_COMMAND_ARRAY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Dense>
+
+namespace bingo
+{
+  /**
+   * @brief One command of a PackedCommandArray.
+   */
+  struct PackedCommand
+  {
+    std::int16_t param1;
+    std::int16_t param2;
+    std::int8_t node;
+  };
+
+  /**
+   * @brief A command array stored row by row, in 6 bytes per command
+   * instead of three columns of 32 bit ints.
+   *
+   * Nodes must fit in 8 bits and parameters in 16 signed bits, which holds
+   * for stacks of up to 32767 commands with integer terminals of the same
+   * magnitude.
+   */
+  class PackedCommandArray
+  {
+  public:
+    PackedCommandArray();
+
+    /**
+     * @brief Construct a packed command array of rows commands, to be
+     * filled in.
+     */
+    explicit PackedCommandArray(int rows);
+
+    /**
+     * @brief Pack a command array.
+     *
+     * @throws std::out_of_range if a command does not fit (see CanPack).
+     */
+    explicit PackedCommandArray(
+        const Eigen::Ref<const Eigen::ArrayX3i> &command_array);
+
+    /**
+     * @brief Whether every command of command_array fits in a packed
+     * command.
+     */
+    static bool CanPack(const Eigen::Ref<const Eigen::ArrayX3i> &command_array);
+
+    Eigen::ArrayX3i Unpack() const;
+
+    /**
+     * @brief Whether command_array holds the same commands, compared
+     * without unpacking.
+     */
+    bool Matches(const Eigen::Ref<const Eigen::ArrayX3i> &command_array) const;
+
+    int Rows() const
+    {
+      return commands_.size();
+    }
+
+    const PackedCommand &operator[](int row) const
+    {
+      return commands_[row];
+    }
+
+    PackedCommand &operator[](int row)
+    {
+      return commands_[row];
+    }
+
+    std::size_t GetMemoryUsage() const;
+
+  private:
+    std::vector<PackedCommand> commands_;
+  };
+} // namespace bingo
+#endif // BINGOCPP_INCLUDE_BINGOCPP_AGRAPH_PACKED_COMMAND_ARRAY_H_
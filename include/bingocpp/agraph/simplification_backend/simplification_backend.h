@@ -30,6 +30,7 @@
 #include <pybind11/eigen.h>
 
 #include <bingocpp/agraph/agraph.h>
+#include <bingocpp/agraph/packed_command_array.h>
 
 namespace bingo {
 /**
@@ -48,6 +49,7 @@ namespace simplification_backend {
  * @return Simplified stack.
  */
 Eigen::ArrayX3i SimplifyStack(const Eigen::ArrayX3i &stack);
+PackedCommandArray SimplifyStack(const PackedCommandArray &stack);
 
 // TODO documentation and change simplify_stack to reduce stack
 Eigen::ArrayX3i PythonSimplifyStack(const Eigen::ArrayX3i &stack);
@@ -63,6 +65,7 @@ Eigen::ArrayX3i PythonSimplifyStack(const Eigen::ArrayX3i &stack);
  * @return vector describing which commands in the stack are used.
  */
 std::vector<bool> GetUtilizedCommands(const Eigen::ArrayX3i &stack);
+std::vector<bool> GetUtilizedCommands(const PackedCommandArray &stack);
 } // namespace simplification_backend
 } // namespace bingo
 #endif
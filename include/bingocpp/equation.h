@@ -17,7 +17,9 @@
 #ifndef BINGOCPP_INCLUDE_BINGOCPP_EQUATION_H_
 #define BINGOCPP_INCLUDE_BINGOCPP_EQUATION_H_
 
+#include <functional>
 #include <string>
+#include <tuple>
 
 #include <Eigen/Dense>
 
@@ -25,6 +27,33 @@ namespace bingo {
  
 typedef std::pair<Eigen::ArrayXXd, Eigen::ArrayXXd> EvalAndDerivative;
 
+// values, transposed Jacobian times itself and times the residuals
+typedef std::tuple<Eigen::ArrayXXd, Eigen::MatrixXd, Eigen::VectorXd>
+    EvalAndNormalEquations;
+
+/**
+ * @brief Residuals of samples in Gauss-Newton normal equations.
+ *
+ * Called as residuals(start, values, residual, jacobian) with the values and
+ * constant Jacobian of the samples [start, start + values.rows()); fills
+ * residual with one residual per sample and turns jacobian in place into the
+ * Jacobian of the residuals.
+ */
+typedef std::function<void(int,
+                           const Eigen::Ref<const Eigen::ArrayXXd> &,
+                           Eigen::Ref<Eigen::ArrayXd>,
+                           Eigen::Ref<Eigen::ArrayXXd>)> ResidualFunction;
+
+/**
+ * @brief Weights of the samples in a vector-Jacobian product.
+ *
+ * Called as seed(start, values, weights) with the values of the samples
+ * [start, start + values.rows()); fills weights with one weight per sample.
+ */
+typedef std::function<void(int,
+                           const Eigen::Ref<const Eigen::ArrayXXd> &,
+                           Eigen::Ref<Eigen::ArrayXd>)> SeedFunction;
+
 class Equation {
  public:
    virtual ~Equation() = default;
@@ -73,6 +102,78 @@ class Equation {
   virtual EvalAndDerivative
   EvaluateEquationWithLocalOptGradientAt(const Eigen::ArrayXXd &x) = 0;
 
+  /**
+   * @brief Evaluate the Equation and the weighted sum of its derivatives.
+   * 
+   * Evaluation of the Equation along the points x and the sum over samples of
+   * seed weight times the gradient with respect to the constants, i.e. the
+   * transposed Jacobian times the seed weights. By default the Jacobian is
+   * computed by EvaluateEquationWithLocalOptGradientAt and reduced.
+   * 
+   * @param x Values at which to evaluate the equations. x is MxD where D is the 
+   * number of dimensions in x and M is the number of data points in x.
+   * 
+   * @param seed Weights of the samples, given their values.
+   * 
+   * @return EvalAndDerivative The evaluation of the function of this Equation 
+   * along the points x and the Cx1 product with respect to the C constants.
+   */
+  virtual EvalAndDerivative
+  EvaluateEquationWithLocalOptVectorJacobianProductAt(
+      const Eigen::ArrayXXd &x, const SeedFunction &seed) {
+    EvalAndDerivative df_dc = EvaluateEquationWithLocalOptGradientAt(x);
+    Eigen::ArrayXd weights(df_dc.first.rows());
+    seed(0, df_dc.first, weights);
+    Eigen::ArrayXXd product =
+        (df_dc.second.matrix().transpose() * weights.matrix()).array();
+    return std::make_pair(df_dc.first, product);
+  }
+
+  /**
+   * @brief Evaluate the Equation and the normal equations of its residuals.
+   * 
+   * Evaluation of the Equation along the points x and the Gauss-Newton normal
+   * equations of the residuals with respect to the constants: the transposed
+   * Jacobian of the residuals times itself and times the residuals. By
+   * default the Jacobian is computed by EvaluateEquationWithLocalOptGradientAt.
+   * 
+   * @param x Values at which to evaluate the equations. x is MxD where D is the 
+   * number of dimensions in x and M is the number of data points in x.
+   * 
+   * @param residuals Residuals of the samples, given their values.
+   * 
+   * @return EvalAndNormalEquations The evaluation of the function of this
+   * Equation along the points x, the CxC and the Cx1 products.
+   */
+  virtual EvalAndNormalEquations
+  EvaluateEquationWithLocalOptNormalEquationsAt(
+      const Eigen::ArrayXXd &x, const ResidualFunction &residuals) {
+    EvalAndDerivative df_dc = EvaluateEquationWithLocalOptGradientAt(x);
+    Eigen::ArrayXd residual(df_dc.first.rows());
+    residuals(0, df_dc.first, residual, df_dc.second);
+    auto jacobian = df_dc.second.matrix();
+    return EvalAndNormalEquations(df_dc.first,
+                                  jacobian.transpose() * jacobian,
+                                  jacobian.transpose() * residual.matrix());
+  }
+
+  /**
+   * @brief Evaluate the Equation in single precision
+   * 
+   * Evaluation of the Equation at points x, accurate enough to screen
+   * candidates. By default the Equation is evaluated in double precision and
+   * the result is rounded.
+   * 
+   * @param x Values at which to evaluate the equations. x is MxD where D is the 
+   * number of dimensions in x and M is the number of data points in x.
+   * 
+   * @return Eigen::ArrayXXf The evaluation of function at points x.
+   */
+  virtual Eigen::ArrayXXf
+  EvaluateEquationSingleAt(const Eigen::ArrayXXf &x) {
+    return EvaluateEquationAt(x.cast<double>()).cast<float>();
+  }
+
   /**
    * @brief Get the Complexity of this Equation.
    * 
@@ -17,12 +17,14 @@
 #ifndef BINGOCPP_INCLUDE_BINGOCPP_EXPLICIT_REGRESSION_H_
 #define BINGOCPP_INCLUDE_BINGOCPP_EXPLICIT_REGRESSION_H_
 
+#include <mutex>
 #include <string>
 #include <vector>
 #include <tuple>
 
 #include <Eigen/Core>
 
+#include "bingocpp/agraph/evaluation_backend/dataset_fingerprint.h"
 #include "bingocpp/equation.h"
 #include "bingocpp/fitness_function.h"
 #include "bingocpp/training_data.h"
@@ -55,8 +57,18 @@ struct ExplicitTrainingData : TrainingData {
     y = std::get<1>(state);
   }
 
+  ExplicitTrainingData &operator=(const ExplicitTrainingData &other) {
+    x = other.x;
+    y = other.y;
+    return *this;
+  }
+
   ~ExplicitTrainingData() { }
 
+  // x in single precision, for screening evaluations; made on first use and
+  // made again when x has changed since
+  const Eigen::ArrayXXf &GetXSingle();
+
   ExplicitTrainingData *GetItem(int item);
 
   ExplicitTrainingData *GetItem(const std::vector<int> &items);
@@ -68,6 +80,11 @@ struct ExplicitTrainingData : TrainingData {
   int Size() {
     return x.rows();
   }
+
+ private:
+  Eigen::ArrayXXf x_single_;
+  evaluation_backend::DatasetFingerprint x_single_of_;
+  std::mutex x_single_mutex_;
 };
 
 class ExplicitRegression : public VectorGradientMixin, public VectorBasedFunction {
@@ -83,6 +100,7 @@ class ExplicitRegression : public VectorGradientMixin, public VectorBasedFunctio
   ExplicitRegression(const ExplicitRegressionState &state):
       VectorBasedFunction(new ExplicitTrainingData(std::get<0>(state)),
                           std::get<1>(state)){
+    relative_ = false;
     eval_count_ = std::get<2>(state);
   }
 
@@ -97,8 +115,19 @@ class ExplicitRegression : public VectorGradientMixin, public VectorBasedFunctio
 
   Eigen::ArrayXd EvaluateFitnessVector(Equation &individual) const;
 
+  std::vector<evaluation_backend::DatasetFingerprint>
+  FingerprintTrainingData() const;
+
+  std::string GetConfiguration() const;
+
   FitnessVectorAndJacobian GetFitnessVectorAndJacobian(Equation &individual) const;
 
+  FitnessVectorAndGradient GetFitnessVectorAndGradient(
+      Equation &individual, const FitnessSeed &seed) const;
+
+  FitnessVectorAndNormalEquations GetFitnessVectorAndNormalEquations(
+      Equation &individual) const;
+
   private:
    bool relative_;
 };
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2018 United States Government as represented by the Administrator
+ * of the National Aeronautics and Space Administration. No copyright is claimed
+ * in the United States under Title 17, U.S. Code. All Other Rights Reserved.
+ *
+ * The Bingo Mini-app platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#ifndef BINGOCPP_INCLUDE_BINGOCPP_FITNESS_CACHE_H_
+#define BINGOCPP_INCLUDE_BINGOCPP_FITNESS_CACHE_H_
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <bingocpp/agraph/agraph.h>
+#include <bingocpp/agraph/evaluation_backend/dataset_fingerprint.h>
+#include <bingocpp/agraph/packed_command_array.h>
+
+namespace bingo {
+
+const std::size_t kDefaultFitnessCacheCapacity = 1 << 14;
+
+/**
+ * @brief Fitness values of AGraphs, keyed by their structure.
+ *
+ * Individuals with the same simplified command array and constants have the
+ * same fitness, so crossover and mutation offspring that recreate a known
+ * individual need not be evaluated again. Holds at most a fixed number of
+ * fitness values and evicts the least recently used one first. Command arrays
+ * are held packed (see PackedCommandArray); individuals whose commands do not
+ * fit are not stored. Thread safe.
+ */
+class FitnessCache {
+ public:
+  // What a fitness depends on besides the individual: fingerprints of the
+  // training data, the accuracy and the precision of the fitness function,
+  // and the rest of its configuration (see
+  // VectorBasedFunction::FingerprintTrainingData and GetConfiguration)
+  typedef std::tuple<std::vector<evaluation_backend::DatasetFingerprint>,
+                     int, int, std::string> Context;
+
+  /**
+   * @brief Construct a FitnessCache.
+   *
+   * @param capacity The largest number of fitness values held.
+   */
+  explicit FitnessCache(std::size_t capacity = kDefaultFitnessCacheCapacity);
+
+  /**
+   * @brief Look up the fitness of an individual.
+   *
+   * @param individual The individual to look up.
+   *
+   * @param context What the fitness was evaluated with.
+   *
+   * @param fitness Set to the fitness of the individual if it is known.
+   *
+   * @return true if the fitness is known.
+   */
+  bool Lookup(AGraph &individual, const Context &context, double &fitness);
+
+  /**
+   * @brief Store the fitness of an individual.
+   *
+   * @param individual The individual that was evaluated.
+   *
+   * @param context What the fitness was evaluated with.
+   *
+   * @param fitness The fitness of the individual.
+   */
+  void Insert(AGraph &individual, const Context &context, double fitness);
+
+  void Clear();
+
+  std::size_t GetCapacity() const;
+  std::size_t GetSize() const;
+
+  /**
+   * @brief Number of lookups that found a fitness.
+   */
+  long GetNumHits() const;
+
+  /**
+   * @brief Number of lookups that found no fitness.
+   */
+  long GetNumMisses() const;
+
+ private:
+  struct Entry {
+    std::size_t hash;
+    Context context;
+    PackedCommandArray command_array;
+    Eigen::ArrayXXd constants;
+    double fitness;
+  };
+  typedef std::list<Entry>::iterator EntryIterator;
+
+  // entry of individual in context, or entries_.end()
+  EntryIterator find(AGraph &individual, const Context &context,
+                     std::size_t hash);
+
+  // most recently used first
+  std::list<Entry> entries_;
+  std::unordered_multimap<std::size_t, EntryIterator> index_;
+  std::size_t capacity_;
+  long num_hits_;
+  long num_misses_;
+  mutable std::mutex mutex_;
+};
+} // namespace bingo
+#endif // BINGOCPP_INCLUDE_BINGOCPP_FITNESS_CACHE_H_
@@ -17,13 +17,20 @@
 #ifndef BINGOCPP_INCLUDE_BINGOCPP_FITNESS_FUNCTION_H_
 #define BINGOCPP_INCLUDE_BINGOCPP_FITNESS_FUNCTION_H_
 
+#include <atomic>
+#include <memory>
 #include <stdexcept>
 #include <string>
+#include <typeinfo>
 #include <unordered_set>
 #include <functional>
+#include <vector>
 
 #include <bingocpp/agraph/agraph.h>
+#include <bingocpp/agraph/evaluation_backend/dataset_fingerprint.h>
+#include <bingocpp/agraph/evaluation_backend/evaluation_workspace.h>
 #include <bingocpp/equation.h>
+#include <bingocpp/fitness_cache.h>
 #include <bingocpp/training_data.h>
 
 namespace metric_functions {
@@ -66,7 +73,22 @@ namespace bingo {
 class FitnessFunction {
  public:
   inline FitnessFunction(TrainingData *training_data = nullptr) :
-    eval_count_(0), training_data_(training_data) { }
+    eval_count_(0), training_data_(training_data),
+    accuracy_(evaluation_backend::kStrict),
+    precision_(evaluation_backend::kDouble) { }
+
+  FitnessFunction(const FitnessFunction &other) :
+    eval_count_(other.eval_count_.load()),
+    training_data_(other.training_data_), accuracy_(other.accuracy_),
+    precision_(other.precision_) { }
+
+  FitnessFunction &operator=(const FitnessFunction &other) {
+    eval_count_ = other.eval_count_.load();
+    training_data_ = other.training_data_;
+    accuracy_ = other.accuracy_;
+    precision_ = other.precision_;
+    return *this;
+  }
 
   virtual ~FitnessFunction() { }
 
@@ -88,9 +110,32 @@ class FitnessFunction {
     training_data_ = training_data;
   }
 
+  evaluation_backend::Accuracy GetAccuracy() const {
+    return accuracy_;
+  }
+
+  // Accuracy of the equation evaluations made by this fitness function
+  void SetAccuracy(evaluation_backend::Accuracy accuracy) {
+    accuracy_ = accuracy;
+  }
+
+  evaluation_backend::Precision GetPrecision() const {
+    return precision_;
+  }
+
+  // Precision of the fitness evaluations made by this fitness function;
+  // kSingle is for screening, recompute final fitness values in kDouble.
+  // Functions without a single precision evaluation reject kSingle.
+  virtual void SetPrecision(evaluation_backend::Precision precision) {
+    precision_ = precision;
+  }
+
  protected:
-  mutable int eval_count_;
+  // atomic so that a population can be evaluated from several threads
+  mutable std::atomic<int> eval_count_;
   TrainingData* training_data_;
+  evaluation_backend::Accuracy accuracy_;
+  evaluation_backend::Precision precision_;
 };
 
 class VectorBasedFunction : public FitnessFunction {
@@ -105,13 +150,61 @@ class VectorBasedFunction : public FitnessFunction {
   virtual ~VectorBasedFunction() { }
 
   double EvaluateIndividualFitness(Equation &individual) const {
+    AGraph *agraph = fitness_cache_ ? dynamic_cast<AGraph *>(&individual)
+                                    : nullptr;
+    FitnessCache::Context context;
+    if (agraph) {
+      std::vector<evaluation_backend::DatasetFingerprint> fingerprints =
+          FingerprintTrainingData();
+      if (fingerprints.empty()) {
+        agraph = nullptr;
+      } else {
+        context = FitnessCache::Context(fingerprints, accuracy_, precision_,
+                                        GetConfiguration());
+      }
+    }
+    double fitness;
+    if (agraph && fitness_cache_->Lookup(*agraph, context, fitness)) {
+      return fitness;
+    }
     Eigen::ArrayXd fitness_vector = EvaluateFitnessVector(individual);
-    return this->metric_function_(fitness_vector);
+    fitness = this->metric_function_(fitness_vector);
+    if (agraph) {
+      fitness_cache_->Insert(*agraph, context, fitness);
+    }
+    return fitness;
   }
 
   virtual Eigen::ArrayXd
   EvaluateFitnessVector(Equation &individual) const = 0;
 
+  std::shared_ptr<FitnessCache> GetFitnessCache() const {
+    return fitness_cache_;
+  }
+
+  // Cache consulted before evaluating AGraphs, or nullptr (default); a
+  // cache may be shared by any fitness functions, fitness values are only
+  // shared between functions with the same configuration
+  void SetFitnessCache(std::shared_ptr<FitnessCache> fitness_cache) {
+    fitness_cache_ = fitness_cache;
+  }
+
+  // Fingerprints of the training data the fitness depends on, taken anew for
+  // every evaluation so that replaced or rewritten data is not mistaken for
+  // the data a cached fitness was evaluated on. Fitness values are only
+  // cached for functions that give fingerprints; none by default.
+  virtual std::vector<evaluation_backend::DatasetFingerprint>
+  FingerprintTrainingData() const {
+    return {};
+  }
+
+  // Everything the fitness depends on besides the individual, the training
+  // data, the accuracy and the precision. Subclasses with settings that
+  // change the fitness add them.
+  virtual std::string GetConfiguration() const {
+    return std::string(typeid(*this).name()) + " " + metric_;
+  }
+
  protected:
   std::string metric_;
 
@@ -129,6 +222,7 @@ class VectorBasedFunction : public FitnessFunction {
 
  private:
   std::function<double(Eigen::ArrayXd)> metric_function_;
+  std::shared_ptr<FitnessCache> fitness_cache_;
 };
 } // namespace bingo
 
@@ -10,6 +10,13 @@
 
 typedef std::tuple<double, Eigen::ArrayXd> FitnessAndGradient;
 typedef std::tuple<Eigen::ArrayXd, Eigen::ArrayXXd> FitnessVectorAndJacobian;
+typedef std::tuple<Eigen::ArrayXd, Eigen::ArrayXd> FitnessVectorAndGradient;
+// fitness vector, transposed Jacobian times itself and times the fitness vector
+typedef std::tuple<Eigen::ArrayXd, Eigen::MatrixXd, Eigen::VectorXd>
+    FitnessVectorAndNormalEquations;
+// seed(fitness_vector, weights): weight of every entry of a fitness vector
+typedef std::function<void(const Eigen::Ref<const Eigen::ArrayXd> &,
+                           Eigen::Ref<Eigen::ArrayXd>)> FitnessSeed;
 
 namespace bingo {
 
@@ -26,26 +33,63 @@ class VectorGradientMixin : public GradientMixin {
 
   virtual FitnessVectorAndJacobian GetFitnessVectorAndJacobian(Equation &individual) const = 0;
 
+  /**
+   * @brief Get the fitness vector and the product of its transposed Jacobian
+   * with the weights seed gives its entries.
+   *
+   * By default the Jacobian of GetFitnessVectorAndJacobian is reduced. Fitness
+   * functions that can seed the evaluation of the individual override it so
+   * the Jacobian is never formed.
+   */
+  virtual FitnessVectorAndGradient GetFitnessVectorAndGradient(
+      Equation &individual, const FitnessSeed &seed) const;
+
+  /**
+   * @brief Get the fitness vector and the Gauss-Newton normal equations of
+   * the fitness vector with respect to the constants of the individual.
+   *
+   * Returns the transposed Jacobian of the fitness vector times itself (PxP)
+   * and times the fitness vector (P), as used by Levenberg-Marquardt. By
+   * default the Jacobian of GetFitnessVectorAndJacobian is multiplied out.
+   * Fitness functions that can have the evaluation accumulate the products
+   * override it so the Jacobian is never formed.
+   */
+  virtual FitnessVectorAndNormalEquations GetFitnessVectorAndNormalEquations(
+      Equation &individual) const;
+
  protected:
-  static Eigen::ArrayXd mean_absolute_error_derivative(
-      const Eigen::ArrayXd &fitness_vector, const Eigen::ArrayXXd &fitness_partials) {
-    return (fitness_partials.rowwise() * fitness_vector.transpose().sign()).rowwise().mean();
+  // the gradient of a metric is the sum of the fitness partials weighted by
+  // its seed, times its scale
+  static void mean_absolute_error_seed(
+      const Eigen::Ref<const Eigen::ArrayXd> &fitness_vector,
+      Eigen::Ref<Eigen::ArrayXd> weights) {
+    weights = fitness_vector.sign();
+  }
+
+  static void mean_squared_error_seed(
+      const Eigen::Ref<const Eigen::ArrayXd> &fitness_vector,
+      Eigen::Ref<Eigen::ArrayXd> weights) {
+    weights = 2.0 * fitness_vector;
+  }
+
+  static void root_mean_squared_error_seed(
+      const Eigen::Ref<const Eigen::ArrayXd> &fitness_vector,
+      Eigen::Ref<Eigen::ArrayXd> weights) {
+    weights = fitness_vector;
   }
 
-  static Eigen::ArrayXd mean_squared_error_derivative(
-      const Eigen::ArrayXd &fitness_vector, const Eigen::ArrayXXd &fitness_partials) {
-    return 2.0 * (fitness_partials.rowwise() * fitness_vector.transpose()).rowwise().mean();
+  static double mean_scale(int num_samples, double /* fitness */) {
+    return 1.0 / num_samples;
   }
 
-  static Eigen::ArrayXd root_mean_squared_error_derivative(
-      const Eigen::ArrayXd &fitness_vector, const Eigen::ArrayXXd &fitness_partials) {
-    return 1.0/sqrt(fitness_vector.square().mean()) *
-    (fitness_partials.rowwise() * fitness_vector.transpose()).rowwise().mean();
+  static double root_mean_squared_error_scale(int num_samples, double fitness) {
+    return 1.0 / (num_samples * fitness);
   }
 
  private:
   std::function<double(Eigen::ArrayXd)> metric_function_;
-  std::function<Eigen::ArrayXd(Eigen::ArrayXd, Eigen::ArrayXXd)> metric_derivative_;
+  FitnessSeed metric_seed_;
+  std::function<double(int, double)> metric_scale_;
 };
 
 } // namespace bingo
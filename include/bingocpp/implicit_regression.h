@@ -102,6 +102,15 @@ class ImplicitRegression : public VectorBasedFunction {
 
   Eigen::ArrayXd EvaluateFitnessVector(Equation &equation) const;
 
+  std::vector<evaluation_backend::DatasetFingerprint>
+  FingerprintTrainingData() const;
+
+  std::string GetConfiguration() const;
+
+  // throws std::invalid_argument for kSingle, implicit regression needs the
+  // x gradient, which is only evaluated in double precision
+  void SetPrecision(evaluation_backend::Precision precision);
+
  private:
   int required_params_;
   static const int kNoneRequired = -1;
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2018 United States Government as represented by the Administrator
+ * of the National Aeronautics and Space Administration. No copyright is claimed
+ * in the United States under Title 17, U.S. Code. All Other Rights Reserved.
+ *
+ * The Bingo Mini-app platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#ifndef BINGOCPP_INCLUDE_BINGOCPP_POPULATION_EVALUATOR_H_
+#define BINGOCPP_INCLUDE_BINGOCPP_POPULATION_EVALUATOR_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <bingocpp/agraph/agraph.h>
+#include <bingocpp/fitness_function.h>
+#include <bingocpp/gradient_mixin.h>
+#include <bingocpp/work_stealing_pool.h>
+
+namespace bingo {
+
+/**
+ * @brief Evaluates a whole population of AGraphs in one call.
+ *
+ * All individuals are evaluated with the same x. Individuals with identical
+ * command arrays and constants (clones are common after selection) are
+ * evaluated only once. With more than one thread, the individuals are spread
+ * over a work-stealing pool, most expensive first, and each thread keeps its
+ * own evaluation workspace. Individuals can also share the values of their
+ * common subexpressions through a SubexpressionCache. Calls from several
+ * threads are serialized, so one evaluator evaluates one population at a
+ * time.
+ */
+class PopulationEvaluator {
+ public:
+  /**
+   * @brief Construct a PopulationEvaluator.
+   *
+   * @param num_threads The number of threads evaluating individuals,
+   * including the calling thread. Values below 1 use the hardware
+   * concurrency.
+   */
+  explicit PopulationEvaluator(int num_threads = 1);
+
+  /**
+   * @brief Evaluate every individual of the population at x.
+   *
+   * @param population The individuals to evaluate.
+   *
+   * @param x Values at which to evaluate the equations. x is MxD where D is
+   * the number of dimensions in x and M is the number of data points in x.
+   *
+   * @return std::vector<Eigen::ArrayXXd> The evaluation of each individual,
+   * in population order.
+   */
+  std::vector<Eigen::ArrayXXd> EvaluatePopulationAt(
+      std::vector<AGraph> &population, const Eigen::ArrayXXd &x);
+  std::vector<Eigen::ArrayXXd> EvaluatePopulationAt(
+      const std::vector<AGraph *> &population, const Eigen::ArrayXXd &x);
+
+  /**
+   * @brief Evaluate the fitness of every individual of the population.
+   *
+   * Individuals whose fitness is already set are not reevaluated. The
+   * fitness of the others is stored in the individuals.
+   *
+   * @param population The individuals to evaluate.
+   *
+   * @param fitness_function The fitness function to evaluate them with.
+   *
+   * @return Eigen::ArrayXd The fitness of each individual, in population
+   * order.
+   */
+  Eigen::ArrayXd EvaluatePopulationFitness(
+      std::vector<AGraph> &population,
+      const FitnessFunction &fitness_function);
+  Eigen::ArrayXd EvaluatePopulationFitness(
+      const std::vector<AGraph *> &population,
+      const FitnessFunction &fitness_function);
+
+  /**
+   * @brief Evaluate the fitness and its gradient for every individual.
+   *
+   * The fitness stored in the individuals is neither used nor updated.
+   *
+   * @param population The individuals to evaluate.
+   *
+   * @param fitness_function The fitness function to evaluate them with.
+   *
+   * @return std::vector<FitnessAndGradient> The fitness of each individual
+   * and its gradient with respect to the constants, in population order.
+   */
+  std::vector<FitnessAndGradient> EvaluatePopulationFitnessAndGradient(
+      std::vector<AGraph> &population,
+      const GradientMixin &fitness_function);
+  std::vector<FitnessAndGradient> EvaluatePopulationFitnessAndGradient(
+      const std::vector<AGraph *> &population,
+      const GradientMixin &fitness_function);
+
+  int GetNumThreads() const;
+
+  /**
+   * @brief Share the values of subexpressions between the individuals.
+   *
+   * The cache is given to the individuals for the duration of each call,
+   * and each call starts a new generation of the cache, so subexpressions
+   * inherited from the previous call stay cached while unused ones are
+   * dropped.
+   *
+   * @param cache The cache, or nullptr (default) for none.
+   */
+  void SetSubexpressionCache(
+      std::shared_ptr<evaluation_backend::SubexpressionCache> cache);
+  std::shared_ptr<evaluation_backend::SubexpressionCache>
+  GetSubexpressionCache() const;
+
+  /**
+   * @brief Number of individuals that were evaluated by the last call.
+   *
+   * Duplicates and individuals with a known fitness are not counted.
+   */
+  int GetNumEvaluated() const;
+
+ private:
+  // Index of the first individual identical to each individual
+  void find_duplicates(const std::vector<AGraph *> &population);
+  // Runs task(i) for each listed individual, with the subexpression cache
+  void run(const std::vector<AGraph *> &population,
+           const std::vector<int> &individuals,
+           const std::function<void(int)> &task);
+  // Runs task(i) for each listed individual, most expensive first
+  void run_tasks(const std::vector<AGraph *> &population,
+                 const std::vector<int> &individuals,
+                 const std::function<void(int)> &task);
+
+  std::unique_ptr<WorkStealingPool> pool_;
+  std::shared_ptr<evaluation_backend::SubexpressionCache> subexpression_cache_;
+  std::vector<int> representative_;
+  std::atomic<int> num_evaluated_;
+  // held for the whole of each evaluation, which uses the pool and
+  // representative_
+  std::mutex mutex_;
+  // guards subexpression_cache_, which is read once per evaluation
+  mutable std::mutex cache_mutex_;
+};
+} // namespace bingo
+#endif // BINGOCPP_INCLUDE_BINGOCPP_POPULATION_EVALUATOR_H_
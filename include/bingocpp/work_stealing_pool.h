@@ -0,0 +1,94 @@
+/*
+ * Copyright 2018 United States Government as represented by the Administrator
+ * of the National Aeronautics and Space Administration. No copyright is claimed
+ * in the United States under Title 17, U.S. Code. All Other Rights Reserved.
+ *
+ * The Bingo Mini-app platform is licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with the
+ * License. You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0.
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#ifndef BINGOCPP_INCLUDE_BINGOCPP_WORK_STEALING_POOL_H_
+#define BINGOCPP_INCLUDE_BINGOCPP_WORK_STEALING_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bingo {
+
+/**
+ * @brief A fixed set of threads that run batches of indexed tasks.
+ *
+ * Each thread owns a queue of task indices. Tasks are dealt round-robin to
+ * the queues in the order given, owners take from the front of their queue
+ * and idle threads steal from the back of the others. The threads live as
+ * long as the pool, so thread local state (such as evaluation workspaces)
+ * is kept from one batch to the next.
+ */
+class WorkStealingPool {
+ public:
+  /**
+   * @brief Construct a pool.
+   *
+   * @param num_threads The number of threads running tasks, including the
+   * thread calling Run. Values below 1 use the hardware concurrency.
+   */
+  explicit WorkStealingPool(int num_threads);
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  /**
+   * @brief Run task(i) for every index in order and wait for all of them.
+   *
+   * Tasks should be ordered most expensive first so that the cheap ones are
+   * left to balance the end of the batch. If tasks throw, the remaining
+   * tasks are still run and the first exception is rethrown. A pool runs one
+   * batch at a time; Run must not be called from several threads at once.
+   *
+   * @param order The task indices, most expensive first.
+   *
+   * @param task The work to do for one index.
+   */
+  void Run(const std::vector<int> &order,
+           const std::function<void(int)> &task);
+
+  int GetNumThreads() const;
+
+ private:
+  struct TaskQueue {
+    std::mutex mutex;
+    std::deque<int> tasks;
+  };
+
+  void work_loop(int worker);
+  void run_tasks(int worker);
+  bool next_task(int worker, int &task);
+
+  std::vector<std::unique_ptr<TaskQueue>> queues_;
+  std::vector<std::thread> threads_;
+  const std::function<void(int)> *task_;
+  std::exception_ptr error_;
+
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  long generation_;
+  int num_running_;
+  bool stopping_;
+};
+} // namespace bingo
+#endif // BINGOCPP_INCLUDE_BINGOCPP_WORK_STEALING_POOL_H_
@@ -1,3 +1,5 @@
+#include <atomic>
+#include <functional>
 #include <limits>
 #include <sstream>
 #include <stdexcept>
@@ -25,6 +27,16 @@ namespace bingo
     const double kFitnessNotSet = 1e9;
 
     constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+    constexpr int kJitDisabled = -1;
+
+    std::atomic<int> jit_threshold(kJitDisabled);
+    std::atomic<bool> row_caching(false);
+    std::atomic<std::size_t> forward_tape_budget(0);
+
+    void hash_combine(std::size_t &seed, std::size_t value)
+    {
+      seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
 
   } // namespace
 
@@ -39,19 +51,49 @@ namespace bingo
     genetic_age_ = 0;
     modified_ = false;
     use_simplification_ = use_simplification;
+    num_evaluations_ = 0;
+    jit_failed_ = false;
+    command_array_handed_out_ = false;
   }
 
   AGraph::AGraph(const AGraph &agraph)
+      : command_array_(agraph.command_array_),
+        simplified_command_array_(agraph.simplified_command_array_),
+        simplified_constants_(agraph.simplified_constants_),
+        folded_stack_(agraph.folded_stack_),
+        packed_command_array_(agraph.packed_command_array_),
+        packed_simplified_command_array_(
+            agraph.packed_simplified_command_array_),
+        unpacked_command_array_(
+            std::atomic_load(&agraph.unpacked_command_array_))
   {
-    command_array_ = agraph.command_array_;
-    simplified_command_array_ = agraph.simplified_command_array_;
-    simplified_constants_ = agraph.simplified_constants_;
     needs_opt_ = agraph.needs_opt_;
     fitness_ = agraph.fitness_;
     fit_set_ = agraph.fit_set_;
     genetic_age_ = agraph.genetic_age_;
     modified_ = agraph.modified_;
     use_simplification_ = agraph.use_simplification_;
+    num_evaluations_ = agraph.num_evaluations_;
+    jit_function_ = agraph.jit_function_;
+    jit_failed_ = agraph.jit_failed_;
+    row_cache_ = agraph.row_cache_;
+    forward_tape_ = agraph.forward_tape_;
+    subexpression_cache_ = agraph.subexpression_cache_;
+    command_array_handed_out_ = false;
+    if (agraph.command_array_handed_out_)
+    {
+      // writes through the handed out reference must not reach this copy
+      command_array_ = agraph.command_array_.Get();
+    }
+  }
+
+  AGraph &AGraph::operator=(const AGraph &agraph)
+  {
+    if (this != &agraph)
+    {
+      *this = AGraph(agraph);
+    }
+    return *this;
   }
 
   AGraph::AGraph(const AGraphState &state)
@@ -65,6 +107,13 @@ namespace bingo
     genetic_age_ = std::get<6>(state);
     modified_ = std::get<7>(state);
     use_simplification_ = std::get<8>(state);
+    num_evaluations_ = 0;
+    jit_failed_ = false;
+    command_array_handed_out_ = false;
+    if (!modified_)
+    {
+      updateFoldedStack();
+    }
   }
 
   AGraph AGraph::Copy()
@@ -74,25 +123,94 @@ namespace bingo
 
   AGraphState AGraph::DumpState()
   {
-    return AGraphState(command_array_, simplified_command_array_,
-                       simplified_constants_, needs_opt_, fitness_, fit_set_,
-                       genetic_age_, modified_, use_simplification_);
+    // a compact AGraph is up to date once its packed arrays are unpacked
+    bool packed = static_cast<bool>(packed_simplified_command_array_);
+    return AGraphState(GetCommandArray(),
+                       packed ? packed_simplified_command_array_->Unpack()
+                              : simplified_command_array_.Get(),
+                       simplified_constants_.Get(), needs_opt_, fitness_,
+                       fit_set_, genetic_age_, modified_ && !packed,
+                       use_simplification_);
   }
 
   const Eigen::ArrayX3i &AGraph::GetCommandArray() const
   {
-    return command_array_;
+    if (!packed_command_array_)
+    {
+      return command_array_.Get();
+    }
+    std::shared_ptr<const Eigen::ArrayX3i> unpacked =
+        std::atomic_load(&unpacked_command_array_);
+    if (!unpacked)
+    {
+      std::shared_ptr<const Eigen::ArrayX3i> command_array =
+          std::make_shared<const Eigen::ArrayX3i>(
+              packed_command_array_->Unpack());
+      // another thread may have unpacked it first
+      if (std::atomic_compare_exchange_strong(&unpacked_command_array_,
+                                              &unpacked, command_array))
+      {
+        unpacked = command_array;
+      }
+    }
+    return *unpacked;
   }
 
   Eigen::ArrayX3i &AGraph::GetCommandArrayModifiable()
   {
     notify_agraph_modification();
-    return command_array_;
+    expandCommandArray();
+    command_array_handed_out_ = true;
+    return command_array_.Modify();
+  }
+
+  const Eigen::ArrayX3i &AGraph::GetSimplifiedCommandArray()
+  {
+    if (modified_)
+    {
+      update();
+    }
+    return simplified_command_array_.Get();
+  }
+
+  std::size_t AGraph::GetStructuralHash()
+  {
+    if (modified_)
+    {
+      update();
+    }
+    const Eigen::ArrayX3i &command_array = simplified_command_array_.Get();
+    const Eigen::ArrayXXd &constants = simplified_constants_.Get();
+    std::size_t seed = command_array.rows();
+    for (Eigen::Index i = 0; i < command_array.size(); ++i)
+    {
+      hash_combine(seed, std::hash<int>()(command_array.data()[i]));
+    }
+    for (Eigen::Index i = 0; i < constants.size(); ++i)
+    {
+      hash_combine(seed, std::hash<double>()(constants.data()[i]));
+    }
+    return seed;
+  }
+
+  void AGraph::SetSubexpressionCache(
+      std::shared_ptr<evaluation_backend::SubexpressionCache> cache)
+  {
+    subexpression_cache_ = cache;
+  }
+
+  std::shared_ptr<evaluation_backend::SubexpressionCache>
+  AGraph::GetSubexpressionCache() const
+  {
+    return subexpression_cache_;
   }
 
   void AGraph::SetCommandArray(const Eigen::ArrayX3i &command_array)
   {
+    packed_command_array_.reset();
+    unpacked_command_array_.reset();
     command_array_ = command_array;
+    command_array_handed_out_ = false;
     notify_agraph_modification();
   }
 
@@ -101,6 +219,18 @@ namespace bingo
     fitness_ = kFitnessNotSet;
     fit_set_ = false;
     modified_ = true;
+    packed_simplified_command_array_.reset();
+  }
+
+  void AGraph::expandCommandArray()
+  {
+    if (!packed_command_array_)
+    {
+      return;
+    }
+    command_array_ = GetCommandArray();
+    packed_command_array_.reset();
+    unpacked_command_array_.reset();
   }
 
   double AGraph::GetFitness() const
@@ -136,7 +266,12 @@ namespace bingo
 
   std::vector<bool> AGraph::GetUtilizedCommands() const
   {
-    return simplification_backend::GetUtilizedCommands(command_array_);
+    if (packed_command_array_)
+    {
+      return simplification_backend::GetUtilizedCommands(
+          *packed_command_array_);
+    }
+    return simplification_backend::GetUtilizedCommands(command_array_.Get());
   }
 
   bool AGraph::NeedsLocalOptimization()
@@ -154,7 +289,7 @@ namespace bingo
     {
       update();
     }
-    return simplified_constants_.rows();
+    return simplified_constants_.Get().rows();
   }
 
   void AGraph::SetLocalOptimizationParams(Eigen::Ref<Eigen::ArrayXXd> params)
@@ -177,7 +312,7 @@ namespace bingo
 
   const Eigen::ArrayXXd &AGraph::GetLocalOptimizationParams() const
   {
-    return simplified_constants_;
+    return simplified_constants_.Get();
   }
 
   Eigen::ArrayXXd
@@ -188,11 +323,50 @@ namespace bingo
       update();
     }
     Eigen::ArrayXXd f_of_x;
+    if (useJit(x))
+    {
+      jit_function_->Evaluate(x, simplified_constants_.Get(), f_of_x);
+      return f_of_x;
+    }
     try
     {
-      f_of_x = evaluation_backend::Evaluate(this->simplified_command_array_,
+      evaluation_backend::EvaluationWorkspace &workspace =
+          evaluation_backend::ThreadWorkspace();
+      if (subexpression_cache_ && simplified_constants_.Get().cols() == 1 &&
+          simplified_command_array_.Get().rows() > 0 && x.rows() > 0)
+      {
+        return evaluation_backend::EvaluateShared(
+            simplified_command_array_.Get(), x, simplified_constants_.Get(),
+            *subexpression_cache_, workspace);
+      }
+      if (row_caching && simplified_constants_.Get().cols() == 1 &&
+          simplified_command_array_.Get().rows() > 0 && x.rows() > 0)
+      {
+        row_cache_ = evaluation_backend::EvaluateRows(
+            simplified_command_array_.Get(), x, simplified_constants_.Get(),
+            row_cache_, workspace);
+        const Eigen::ArrayXXd &value = row_cache_->GetValue();
+        if (value.rows() == x.rows())
+        {
+          return value;
+        }
+        return Eigen::ArrayXXd::Constant(x.rows(), 1, value(0, 0));
+      }
+      const Eigen::ArrayXXd &constants =
+          folded_stack_.Modify().Fold(simplified_constants_.Get(), workspace);
+      std::size_t tape_budget = forward_tape_budget;
+      if (tape_budget > 0 && constants.cols() == 1 &&
+          !workspace.IsParallel(x.rows()))
+      {
+        f_of_x = evaluation_backend::EvaluateAndRecord(
+            folded_stack_.Get().GetProgram(), x, constants, tape_budget,
+            forward_tape_, workspace);
+        return f_of_x;
+      }
+      f_of_x = evaluation_backend::Evaluate(folded_stack_.Get().GetProgram(),
                                             x,
-                                            this->simplified_constants_);
+                                            constants,
+                                            workspace);
       return f_of_x;
     }
     catch (const std::underflow_error &ue)
@@ -205,6 +379,32 @@ namespace bingo
     }
   }
 
+  Eigen::ArrayXXf
+  AGraph::EvaluateEquationSingleAt(const Eigen::ArrayXXf &x)
+  {
+    if (modified_)
+    {
+      update();
+    }
+    try
+    {
+      evaluation_backend::EvaluationWorkspace &workspace =
+          evaluation_backend::ThreadWorkspace();
+      const Eigen::ArrayXXd &constants =
+          folded_stack_.Modify().Fold(simplified_constants_.Get(), workspace);
+      return evaluation_backend::EvaluateSingle(
+          folded_stack_.Get().GetProgram(), x, constants, workspace);
+    }
+    catch (const std::underflow_error &ue)
+    {
+      return Eigen::ArrayXXf::Constant(x.rows(), x.cols(), kNaN);
+    }
+    catch (const std::overflow_error &oe)
+    {
+      return Eigen::ArrayXXf::Constant(x.rows(), x.cols(), kNaN);
+    }
+  }
+
   EvalAndDerivative
   AGraph::EvaluateEquationWithXGradientAt(const Eigen::ArrayXXd &x)
   {
@@ -215,10 +415,11 @@ namespace bingo
     EvalAndDerivative df_dx;
     try
     {
-      df_dx = evaluation_backend::EvaluateWithDerivative(this->simplified_command_array_,
-                                                         x,
-                                                         this->simplified_constants_,
-                                                         true);
+      evaluation_backend::EvaluationWorkspace &workspace =
+          evaluation_backend::ThreadWorkspace();
+      const Eigen::ArrayXXd &constants =
+          folded_stack_.Modify().Fold(simplified_constants_.Get(), workspace);
+      df_dx = evaluateWithDerivative(x, constants, true, workspace);
       return df_dx;
     }
     catch (const std::underflow_error &ue)
@@ -243,12 +444,22 @@ namespace bingo
       update();
     }
     EvalAndDerivative df_dc;
+    if (useJit(x))
+    {
+      jit_function_->EvaluateWithConstantDerivative(
+          x, simplified_constants_.Get(), df_dc);
+      return df_dc;
+    }
     try
     {
-      df_dc = evaluation_backend::EvaluateWithDerivative(this->simplified_command_array_,
-                                                         x,
-                                                         this->simplified_constants_,
-                                                         false);
+      evaluation_backend::EvaluationWorkspace &workspace =
+          evaluation_backend::ThreadWorkspace();
+      const Eigen::ArrayXXd &constants =
+          folded_stack_.Modify().Fold(simplified_constants_.Get(), workspace);
+      const EvalAndDerivative &result =
+          evaluateWithDerivative(x, constants, false, workspace);
+      df_dc.first = result.first;
+      df_dc.second = folded_stack_.Get().ConstantDerivative(result.second);
       return df_dc;
     }
     catch (const std::underflow_error &ue)
@@ -265,6 +476,102 @@ namespace bingo
     }
   }
 
+  EvalAndDerivative
+  AGraph::EvaluateEquationWithLocalOptVectorJacobianProductAt(
+      const Eigen::ArrayXXd &x, const SeedFunction &seed)
+  {
+    if (modified_)
+    {
+      update();
+    }
+    if (simplified_constants_.Get().cols() > 1 || useJit(x))
+    {
+      return Equation::EvaluateEquationWithLocalOptVectorJacobianProductAt(
+          x, seed);
+    }
+    try
+    {
+      evaluation_backend::EvaluationWorkspace &workspace =
+          evaluation_backend::ThreadWorkspace();
+      const Eigen::ArrayXXd &constants =
+          folded_stack_.Modify().Fold(simplified_constants_.Get(), workspace);
+      const EvalAndDerivative &result =
+          evaluation_backend::EvaluateVectorJacobianProduct(
+              folded_stack_.Get().GetProgram(), x, constants, seed, workspace);
+      return std::make_pair(
+          result.first,
+          folded_stack_.Get().ConstantDerivative(result.second.transpose())
+              .transpose()
+              .eval());
+    }
+    catch (const std::underflow_error &ue)
+    {
+      Eigen::ArrayXXd nan_array =
+          Eigen::ArrayXXd::Constant(x.rows(), x.cols(), kNaN);
+      return std::make_pair(nan_array, nan_array);
+    }
+    catch (const std::overflow_error &oe)
+    {
+      Eigen::ArrayXXd nan_array =
+          Eigen::ArrayXXd::Constant(x.rows(), x.cols(), kNaN);
+      return std::make_pair(nan_array, nan_array);
+    }
+  }
+
+  EvalAndNormalEquations
+  AGraph::EvaluateEquationWithLocalOptNormalEquationsAt(
+      const Eigen::ArrayXXd &x, const ResidualFunction &residuals)
+  {
+    if (modified_)
+    {
+      update();
+    }
+    if (simplified_constants_.Get().cols() > 1 || useJit(x))
+    {
+      return Equation::EvaluateEquationWithLocalOptNormalEquationsAt(
+          x, residuals);
+    }
+    try
+    {
+      evaluation_backend::EvaluationWorkspace &workspace =
+          evaluation_backend::ThreadWorkspace();
+      const Eigen::ArrayXXd &constants =
+          folded_stack_.Modify().Fold(simplified_constants_.Get(), workspace);
+      const EvalAndNormalEquations &result =
+          evaluation_backend::EvaluateNormalEquations(
+              folded_stack_.Get().GetProgram(), x, constants, residuals,
+              workspace);
+      // the Jacobian of the folded program times the derivative of the
+      // folded constants is the Jacobian of the AGraph, on both sides
+      Eigen::ArrayXXd jacobian_product =
+          folded_stack_.Get().ConstantDerivative(std::get<1>(result).array());
+      jacobian_product =
+          folded_stack_.Get().ConstantDerivative(jacobian_product.transpose());
+      Eigen::ArrayXXd residual_product =
+          folded_stack_.Get().ConstantDerivative(
+              std::get<2>(result).array().transpose());
+      return EvalAndNormalEquations(std::get<0>(result),
+                                    jacobian_product.matrix(),
+                                    residual_product.matrix().transpose());
+    }
+    catch (const std::underflow_error &ue)
+    {
+      int num_constants = simplified_constants_.Get().rows();
+      return EvalAndNormalEquations(
+          Eigen::ArrayXXd::Constant(x.rows(), x.cols(), kNaN),
+          Eigen::MatrixXd::Constant(num_constants, num_constants, kNaN),
+          Eigen::VectorXd::Constant(num_constants, kNaN));
+    }
+    catch (const std::overflow_error &oe)
+    {
+      int num_constants = simplified_constants_.Get().rows();
+      return EvalAndNormalEquations(
+          Eigen::ArrayXXd::Constant(x.rows(), x.cols(), kNaN),
+          Eigen::MatrixXd::Constant(num_constants, num_constants, kNaN),
+          Eigen::VectorXd::Constant(num_constants, kNaN));
+    }
+  }
+
   std::ostream &operator<<(std::ostream &strm, AGraph &graph)
   {
     return strm << graph.GetConsoleString();
@@ -279,13 +586,13 @@ namespace bingo
   {
     if (raw)
     {
-      return string_generation::GetFormattedString(format, this->command_array_, Eigen::VectorXd(0));
+      return string_generation::GetFormattedString(format, GetCommandArray(), Eigen::VectorXd(0));
     }
     if (modified_)
     {
       update();
     }
-    return string_generation::GetFormattedString(format, this->simplified_command_array_, this->simplified_constants_);
+    return string_generation::GetFormattedString(format, simplified_command_array_.Get(), simplified_constants_.Get());
   }
 
   int AGraph::GetComplexity()
@@ -294,28 +601,153 @@ namespace bingo
     {
       update();
     }
-    return simplified_command_array_.rows();
+    return simplified_command_array_.Get().rows();
   }
 
   int AGraph::Distance(const AGraph &agraph)
   {
-    return (command_array_ != agraph.GetCommandArray()).count();
+    return (GetCommandArray() != agraph.GetCommandArray()).count();
+  }
+
+  bool AGraph::Compact()
+  {
+    if (IsCompact())
+    {
+      return true;
+    }
+    if (modified_)
+    {
+      update();
+    }
+    const Eigen::ArrayX3i &command_array = GetCommandArray();
+    const Eigen::ArrayX3i &simplified_command_array =
+        simplified_command_array_.Get();
+    if (!PackedCommandArray::CanPack(command_array) ||
+        !PackedCommandArray::CanPack(simplified_command_array))
+    {
+      return false;
+    }
+    if (!packed_command_array_)
+    {
+      packed_command_array_ =
+          std::make_shared<const PackedCommandArray>(command_array);
+    }
+    packed_simplified_command_array_ =
+        std::make_shared<const PackedCommandArray>(simplified_command_array);
+    unpacked_command_array_.reset();
+    command_array_ = Eigen::ArrayX3i(kInitialCommandRows, kInitialCommandCols);
+    simplified_command_array_ =
+        Eigen::ArrayX3i(kInitialCommandRows, kInitialCommandCols);
+    folded_stack_ = evaluation_backend::FoldedStack();
+    jit_function_.reset();
+    row_cache_.reset();
+    forward_tape_.reset();
+    // the next update unpacks the simplified command array
+    modified_ = true;
+    return true;
+  }
+
+  bool AGraph::IsCompact() const
+  {
+    return packed_command_array_ && packed_simplified_command_array_;
+  }
+
+  void AGraph::SetJitThreshold(int num_evaluations)
+  {
+    jit_threshold = num_evaluations;
+  }
+
+  int AGraph::GetJitThreshold()
+  {
+    return jit_threshold;
+  }
+
+  void AGraph::SetRowCaching(bool enabled)
+  {
+    row_caching = enabled;
+  }
+
+  bool AGraph::GetRowCaching()
+  {
+    return row_caching;
+  }
+
+  void AGraph::SetForwardTapeBudget(std::size_t bytes)
+  {
+    forward_tape_budget = bytes;
+  }
+
+  std::size_t AGraph::GetForwardTapeBudget()
+  {
+    return forward_tape_budget;
+  }
+
+  bool AGraph::useJit(const Eigen::ArrayXXd &x)
+  {
+    int threshold = jit_threshold;
+    if (threshold < 0 || jit_failed_ ||
+        simplified_constants_.Get().cols() != 1 || x.rows() == 0 ||
+        evaluation_backend::ThreadWorkspace().IsParallel(x.rows()))
+    {
+      return false;
+    }
+    if (!jit_function_)
+    {
+      if (++num_evaluations_ <= threshold)
+      {
+        return false;
+      }
+      jit_function_ =
+          evaluation_backend::JitCompile(simplified_command_array_.Get());
+      jit_failed_ = !jit_function_;
+    }
+    return static_cast<bool>(jit_function_);
+  }
+
+  const EvalAndDerivative &AGraph::evaluateWithDerivative(
+      const Eigen::ArrayXXd &x, const Eigen::ArrayXXd &constants,
+      bool param_x_or_c, evaluation_backend::EvaluationWorkspace &workspace)
+  {
+    if (forward_tape_ &&
+        forward_tape_->IsTapeOf(x, constants, workspace.GetAccuracy()))
+    {
+      return evaluation_backend::EvaluateWithDerivative(
+          folded_stack_.Get().GetProgram(), *forward_tape_, param_x_or_c,
+          workspace);
+    }
+    return evaluation_backend::EvaluateWithDerivative(
+        folded_stack_.Get().GetProgram(), x, constants, param_x_or_c,
+        workspace);
   }
 
   void AGraph::update() {
     updateSimplifiedCommandArray();
     updateConstantsArray();
+    updateFoldedStack();
+    forward_tape_.reset();
     modified_ = false;
+    command_array_handed_out_ = false;
 }
 
 void AGraph::updateSimplifiedCommandArray() {
-    if (use_simplification_) {
-        simplified_command_array_ = simplification_backend::PythonSimplifyStack(command_array_);
+    if (packed_simplified_command_array_) {
+        simplified_command_array_ = packed_simplified_command_array_->Unpack();
+        packed_simplified_command_array_.reset();
+    } else if (use_simplification_) {
+        simplified_command_array_ = simplification_backend::PythonSimplifyStack(GetCommandArray());
     } else {
-        simplified_command_array_ = simplification_backend::SimplifyStack(command_array_);
+        simplified_command_array_ = simplification_backend::SimplifyStack(GetCommandArray());
     }
 }
 
+void AGraph::updateFoldedStack() {
+    folded_stack_.Overwrite().Compile(simplified_command_array_.Get(),
+                                      simplified_constants_.Get().rows());
+    num_evaluations_ = 0;
+    jit_function_.reset();
+    jit_failed_ = false;
+}
+
 void AGraph::updateConstantsArray() {
     int new_const_number = countAndUpdateConstants();
     resizeConstantsArrayIfNeeded(new_const_number);
@@ -323,9 +755,10 @@ void AGraph::updateConstantsArray() {
 
 int AGraph::countAndUpdateConstants() {
     int new_const_number = 0;
-    for (int i = 0; i < simplified_command_array_.rows(); i++) {
-        if (simplified_command_array_(i, kOpIdx) == Op::kConstant) {
-            simplified_command_array_.row(i) << Op::kConstant, new_const_number, new_const_number;
+    Eigen::ArrayX3i &simplified_command_array = simplified_command_array_.Modify();
+    for (int i = 0; i < simplified_command_array.rows(); i++) {
+        if (simplified_command_array(i, kOpIdx) == Op::kConstant) {
+            simplified_command_array.row(i) << Op::kConstant, new_const_number, new_const_number;
             new_const_number++;
         }
     }
@@ -335,12 +768,14 @@ int AGraph::countAndUpdateConstants() {
 void AGraph::resizeConstantsArrayIfNeeded(int const_number_input){
   int optimization_aggression = 0; 
   
-  if (optimization_aggression == 0 && const_number_input <= simplified_constants_.rows()){
-    simplified_constants_.conservativeResize(const_number_input, Eigen::NoChange);
+  if (optimization_aggression == 0 && const_number_input <= simplified_constants_.Get().rows()){
+    if (const_number_input < simplified_constants_.Get().rows()){
+      simplified_constants_.Modify().conservativeResize(const_number_input, Eigen::NoChange);
+    }
     return; 
   }
 
-  if (optimization_aggression == 1 && const_number_input == simplified_constants_.rows()){
+  if (optimization_aggression == 1 && const_number_input == simplified_constants_.Get().rows()){
     // reuse old constants
     return; 
   }
@@ -349,8 +784,7 @@ void AGraph::resizeConstantsArrayIfNeeded(int const_number_input){
 }
 
 void AGraph::performDefaultConstantResize(int const_number_input){
-  simplified_constants_.resize(const_number_input, 1);
-  simplified_constants_.setOnes(const_number_input, 1);
+  simplified_constants_ = Eigen::ArrayXXd::Ones(const_number_input, 1);
   if (const_number_input > 0){
     needs_opt_ = true;
   }
@@ -0,0 +1,140 @@
+#include <bingocpp/agraph/evaluation_backend/buffer_assignment.h>
+#include <bingocpp/agraph/evaluation_backend/operator_eval.h>
+#include <bingocpp/agraph/constants.h>
+#include <bingocpp/agraph/operator_definitions.h>
+
+namespace bingo
+{
+  namespace evaluation_backend
+  {
+    namespace
+    {
+      void mark_used(int operand, int row, BufferAssignment &assignment)
+      {
+        // rows are visited last to first so the first use seen is the last
+        if (assignment.last_use[operand] < 0)
+        {
+          assignment.last_use[operand] = row;
+        }
+      }
+
+      void release_operands(const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+                            int row, const std::vector<int> &buffers,
+                            BufferAssignment &assignment)
+      {
+        int node = stack(row, kOpIdx);
+        if (node <= Op::kConstant)
+        {
+          return;
+        }
+        int param1 = stack(row, kParam1Idx);
+        int param2 = stack(row, kParam2Idx);
+        if (assignment.last_use[param1] == row && !assignment.pinned[param1])
+        {
+          assignment.free_buffers.push_back(buffers[param1]);
+        }
+        if (kIsArity2Map.at(node) && param2 != param1 &&
+            assignment.last_use[param2] == row && !assignment.pinned[param2])
+        {
+          assignment.free_buffers.push_back(buffers[param2]);
+        }
+      }
+
+      // Linear scan over the rows. With in_place set, a row may take the
+      // buffer of an operand that it reads for the last time.
+      int allocate(const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+                   bool in_place, std::vector<int> &buffers,
+                   BufferAssignment &assignment)
+      {
+        int num_buffers = 0;
+        assignment.free_buffers.clear();
+        for (int row = 0; row < stack.rows(); ++row)
+        {
+          if (assignment.last_use[row] < 0)
+          {
+            continue;
+          }
+          if (in_place)
+          {
+            release_operands(stack, row, buffers, assignment);
+          }
+          if (assignment.free_buffers.empty())
+          {
+            buffers[row] = num_buffers++;
+          }
+          else
+          {
+            buffers[row] = assignment.free_buffers.back();
+            assignment.free_buffers.pop_back();
+          }
+          if (!in_place)
+          {
+            release_operands(stack, row, buffers, assignment);
+          }
+        }
+        return num_buffers;
+      }
+    } // namespace
+
+    void AssignBuffers(const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+                       bool keep_for_reverse,
+                       BufferAssignment &assignment)
+    {
+      int stack_depth = stack.rows();
+      assignment.last_use.assign(stack_depth, -1);
+      assignment.forward_buffer.assign(stack_depth, -1);
+      assignment.reverse_buffer.assign(stack_depth, -1);
+      assignment.pinned.assign(stack_depth, false);
+      assignment.num_forward_buffers = 0;
+      assignment.num_reverse_buffers = 0;
+      if (stack_depth == 0)
+      {
+        return;
+      }
+
+      assignment.last_use[stack_depth - 1] = stack_depth;
+      for (int row = stack_depth - 1; row >= 0; --row)
+      {
+        int node = stack(row, kOpIdx);
+        if (assignment.last_use[row] < 0 || node <= Op::kConstant)
+        {
+          continue;
+        }
+        int param1 = stack(row, kParam1Idx);
+        int param2 = stack(row, kParam2Idx);
+        bool arity_2 = kIsArity2Map.at(node);
+        mark_used(param1, row, assignment);
+        if (arity_2)
+        {
+          mark_used(param2, row, assignment);
+        }
+        if (keep_for_reverse)
+        {
+          if (ReverseUsesParam1(node))
+          {
+            assignment.pinned[param1] = true;
+          }
+          if (arity_2 && ReverseUsesParam2(node))
+          {
+            assignment.pinned[param2] = true;
+          }
+          if (ReverseUsesResult(node))
+          {
+            assignment.pinned[row] = true;
+          }
+        }
+      }
+
+      assignment.num_forward_buffers =
+          allocate(stack, true, assignment.forward_buffer, assignment);
+      if (keep_for_reverse)
+      {
+        // adjoints accumulate into operands while the row's own adjoint is
+        // read, so reverse buffers are never shared within a row
+        assignment.pinned.assign(stack_depth, false);
+        assignment.num_reverse_buffers =
+            allocate(stack, false, assignment.reverse_buffer, assignment);
+      }
+    }
+  } // namespace evaluation_backend
+} // namespace bingo
@@ -0,0 +1,329 @@
+#include <algorithm>
+
+#include <bingocpp/agraph/evaluation_backend/compiled_stack.h>
+#include <bingocpp/agraph/evaluation_backend/operator_eval.h>
+#include <bingocpp/agraph/constants.h>
+#include <bingocpp/agraph/operator_definitions.h>
+
+namespace bingo
+{
+  namespace evaluation_backend
+  {
+    namespace
+    {
+      ShapeClass terminal_shape(int node)
+      {
+        switch (node)
+        {
+        case Op::kVariable:
+          return kColumn;
+        case Op::kConstant:
+          return kRow;
+        }
+        return kScalar;
+      }
+    } // namespace
+
+    CompiledStack::CompiledStack() {}
+
+    CompiledStack::CompiledStack(const Eigen::Ref<const Eigen::ArrayX3i> &stack)
+    {
+      Compile(stack);
+    }
+
+    void CompiledStack::Compile(const Eigen::Ref<const Eigen::ArrayX3i> &stack)
+    {
+      shapes_.assign(stack.rows(), kScalar);
+      for (int i = 0; i < stack.rows(); ++i)
+      {
+        int node = stack(i, kOpIdx);
+        if (node <= Op::kConstant)
+        {
+          shapes_[i] = terminal_shape(node);
+          continue;
+        }
+        int param1 = stack(i, kParam1Idx);
+        int param2 = stack(i, kParam2Idx);
+        shapes_[i] = shapes_[param1];
+        if (kIsArity2Map.at(node))
+        {
+          shapes_[i] = static_cast<ShapeClass>(shapes_[i] | shapes_[param2]);
+        }
+      }
+
+      compile_stream(stack, false, value);
+      compile_stream(stack, true, derivative);
+    }
+
+    bool CompiledStack::IsEmpty() const
+    {
+      return value.instructions.empty();
+    }
+
+    void CompiledStack::schedule(const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+                                 bool fuse)
+    {
+      int stack_depth = stack.rows();
+      uses_.assign(stack_depth, 0);
+      chain_uses_.assign(stack_depth, 0);
+      chain_prev_.assign(stack_depth, -1);
+      fused_.assign(stack_depth, false);
+      position_.assign(stack_depth, -1);
+      order_.clear();
+      scheduled_.resize(stack_depth, 3);
+      if (stack_depth == 0)
+      {
+        return;
+      }
+
+      for (int row = stack_depth - 1; row >= 0; --row)
+      {
+        int node = stack(row, kOpIdx);
+        if ((uses_[row] == 0 && row != stack_depth - 1) ||
+            node <= Op::kConstant)
+        {
+          continue;
+        }
+        ++uses_[stack(row, kParam1Idx)];
+        if (kIsArity2Map.at(node))
+        {
+          ++uses_[stack(row, kParam2Idx)];
+        }
+      }
+
+      // a row is fused into the row that reads it if that is its only read
+      // and both have the same shape, so the chain is one pass per column
+      for (int row = 0; fuse && row < stack_depth; ++row)
+      {
+        int node = stack(row, kOpIdx);
+        if ((uses_[row] == 0 && row != stack_depth - 1) ||
+            node <= Op::kConstant || !(shapes_[row] & kColumn))
+        {
+          continue;
+        }
+        int num_params = kIsArity2Map.at(node) ? 2 : 1;
+        for (int i = 0; i < num_params; ++i)
+        {
+          int param = stack(row, kParam1Idx + i);
+          if (stack(param, kOpIdx) > Op::kConstant && uses_[param] == 1 &&
+              shapes_[param] == shapes_[row])
+          {
+            chain_prev_[row] = param;
+            fused_[param] = true;
+            break;
+          }
+        }
+      }
+      for (int row = 0; row < stack_depth; ++row)
+      {
+        if (chain_prev_[row] < 0 && !fused_[row])
+        {
+          continue;
+        }
+        ++chain_uses_[stack(row, kParam1Idx)];
+        if (kIsArity2Map.at(stack(row, kOpIdx)))
+        {
+          ++chain_uses_[stack(row, kParam2Idx)];
+        }
+      }
+
+      // fused rows are moved down to the end of their chain, so the chain
+      // is evaluated where its last row was and its operands stay live
+      for (int row = 0; row < stack_depth; ++row)
+      {
+        if (fused_[row])
+        {
+          continue;
+        }
+        int chain_start = order_.size();
+        for (int member = row; member >= 0; member = chain_prev_[member])
+        {
+          order_.push_back(member);
+        }
+        std::reverse(order_.begin() + chain_start, order_.end());
+      }
+      for (int i = 0; i < stack_depth; ++i)
+      {
+        position_[order_[i]] = i;
+      }
+      for (int i = 0; i < stack_depth; ++i)
+      {
+        int row = order_[i];
+        int node = stack(row, kOpIdx);
+        scheduled_.row(i) = stack.row(row);
+        if (node > Op::kConstant)
+        {
+          scheduled_(i, kParam1Idx) = position_[stack(row, kParam1Idx)];
+          scheduled_(i, kParam2Idx) = kIsArity2Map.at(node)
+                                          ? position_[stack(row, kParam2Idx)]
+                                          : scheduled_(i, kParam1Idx);
+        }
+      }
+    }
+
+    bool CompiledStack::is_inlined(const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+                                   int row) const
+    {
+      return stack(row, kOpIdx) <= Op::kConstant && uses_[row] > 0 &&
+             chain_uses_[row] == uses_[row];
+    }
+
+    FusedOperand CompiledStack::fused_operand(
+        const Eigen::Ref<const Eigen::ArrayX3i> &stack, int row,
+        int result_buffer, FusedChain &chain) const
+    {
+      if (is_inlined(stack, row))
+      {
+        int param1 = stack(row, kParam1Idx);
+        switch (stack(row, kOpIdx))
+        {
+        case Op::kVariable:
+          return FusedOperand{kFromX, kColumn, param1};
+        case Op::kConstant:
+          return FusedOperand{kFromConstants, kRow, param1};
+        }
+        return FusedOperand{kFromInteger, kScalar, param1};
+      }
+      int buffer = assignment_.forward_buffer[position_[row]];
+      // the result may take the buffer of an operand it reads for the last
+      // time; columns are read as they are overwritten, but broadcast
+      // values must be read before the first write
+      if (buffer == result_buffer && !(shapes_[row] & kColumn))
+      {
+        chain.saved_shape = shapes_[row];
+        return FusedOperand{kFromSaved, shapes_[row], buffer};
+      }
+      return FusedOperand{kFromBuffer, shapes_[row], buffer};
+    }
+
+    void CompiledStack::compile_stream(
+        const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+        bool keep_for_reverse,
+        InstructionStream &stream)
+    {
+      // only evaluations without derivatives fuse rows, since the reverse
+      // sweep reads the intermediate values
+      schedule(stack, !keep_for_reverse);
+      AssignBuffers(scheduled_, keep_for_reverse, assignment_);
+      stream.num_buffers = std::max(assignment_.num_forward_buffers,
+                                    assignment_.num_reverse_buffers);
+      stream.instructions.clear();
+      stream.chains.clear();
+      stream.num_operators = 0;
+      stream.num_operands = 0;
+      stream_position_.assign(scheduled_.rows(), -1);
+      for (int j = 0; j < scheduled_.rows(); ++j)
+      {
+        int i = order_[j];
+        if (assignment_.last_use[j] < 0 || fused_[i] || is_inlined(stack, i))
+        {
+          continue;
+        }
+        Instruction instruction;
+        instruction.node = scheduled_(j, kOpIdx);
+        instruction.shape = shapes_[i];
+        instruction.chain = -1;
+        int param1 = scheduled_(j, kParam1Idx);
+        int param2 = scheduled_(j, kParam2Idx);
+        int position = stream.instructions.size();
+        stream_position_[j] = position;
+        bool broadcast_forward = false;
+        bool broadcast_reverse = false;
+        if (chain_prev_[i] >= 0)
+        {
+          int result = assignment_.forward_buffer[j];
+          instruction.forward = RowBuffers{result, result, result};
+          instruction.reverse = instruction.forward;
+          instruction.positions = RowBuffers{position, -1, -1};
+          instruction.clear_param1_adjoint = false;
+          instruction.clear_param2_adjoint = false;
+          instruction.chain = stream.chains.size();
+          stream.chains.push_back(fuse_chain(stack, i, result));
+          for (Accuracy accuracy : {kStrict, kFast})
+          {
+            instruction.forward_kernels[accuracy] = nullptr;
+            instruction.reverse_kernels[accuracy] = nullptr;
+          }
+          stream.instructions.push_back(instruction);
+          continue;
+        }
+        if (instruction.node <= Op::kConstant)
+        {
+          instruction.forward = RowBuffers{assignment_.forward_buffer[j],
+                                           param1, param2};
+          instruction.reverse = RowBuffers{assignment_.reverse_buffer[j],
+                                           param1, param2};
+          instruction.positions = RowBuffers{position, param1, param2};
+          instruction.clear_param1_adjoint = false;
+          instruction.clear_param2_adjoint = false;
+        }
+        else
+        {
+          instruction.forward = RowBuffers{assignment_.forward_buffer[j],
+                                           assignment_.forward_buffer[param1],
+                                           assignment_.forward_buffer[param2]};
+          instruction.reverse = RowBuffers{assignment_.reverse_buffer[j],
+                                           assignment_.reverse_buffer[param1],
+                                           assignment_.reverse_buffer[param2]};
+          instruction.positions = RowBuffers{position,
+                                             stream_position_[param1],
+                                             stream_position_[param2]};
+          stream.num_operators += 1;
+          stream.num_operands += kIsArity2Map.at(instruction.node) ? 2 : 1;
+          instruction.clear_param1_adjoint = assignment_.last_use[param1] == j;
+          instruction.clear_param2_adjoint = assignment_.last_use[param2] == j;
+          ShapeClass shape1 = shapes_[order_[param1]];
+          ShapeClass shape2 = shapes_[order_[param2]];
+          broadcast_forward = shape1 != shapes_[i] || shape2 != shapes_[i];
+          // adjoints always have one value per sample
+          broadcast_reverse = shape1 != kColumn || shape2 != kColumn ||
+                              shapes_[i] != kColumn;
+        }
+        for (Accuracy accuracy : {kStrict, kFast})
+        {
+          instruction.forward_kernels[accuracy] = GetForwardKernel(
+              instruction.node, broadcast_forward, accuracy);
+          instruction.reverse_kernels[accuracy] = GetReverseKernel(
+              instruction.node, broadcast_reverse, accuracy);
+        }
+        stream.instructions.push_back(instruction);
+      }
+    }
+
+    FusedChain CompiledStack::fuse_chain(
+        const Eigen::Ref<const Eigen::ArrayX3i> &stack, int last,
+        int result_buffer) const
+    {
+      std::vector<int> members;
+      for (int member = last; member >= 0; member = chain_prev_[member])
+      {
+        members.push_back(member);
+      }
+      std::reverse(members.begin(), members.end());
+
+      FusedChain chain;
+      chain.saved_shape = kScalar;
+      chain.first = fused_operand(stack, stack(members[0], kParam1Idx),
+                                  result_buffer, chain);
+      for (std::size_t k = 0; k < members.size(); ++k)
+      {
+        int row = members[k];
+        int param1 = stack(row, kParam1Idx);
+        int param2 = stack(row, kParam2Idx);
+        FusedStep step;
+        step.node = stack(row, kOpIdx);
+        step.arity_2 = kIsArity2Map.at(step.node);
+        step.chain_is_param1 = k == 0 || param1 == members[k - 1];
+        step.operand = FusedOperand{kFromInteger, kScalar, 0};
+        if (step.arity_2)
+        {
+          step.operand = fused_operand(
+              stack, step.chain_is_param1 ? param2 : param1, result_buffer,
+              chain);
+        }
+        chain.steps.push_back(step);
+      }
+      return chain;
+    }
+  } // namespace evaluation_backend
+} // namespace bingo
@@ -0,0 +1,84 @@
+#include <cstring>
+
+#include <bingocpp/agraph/evaluation_backend/dataset_fingerprint.h>
+
+namespace bingo
+{
+  namespace evaluation_backend
+  {
+    namespace
+    {
+      constexpr int kLanes = 4;
+      constexpr std::uint64_t kMultiplier = 0x9e3779b97f4a7c15ULL;
+
+      std::uint64_t mix(std::uint64_t value)
+      {
+        value ^= value >> 33;
+        value *= 0xff51afd7ed558ccdULL;
+        value ^= value >> 33;
+        value *= 0xc4ceb9fe1a85ec53ULL;
+        value ^= value >> 33;
+        return value;
+      }
+
+      // hash the bit patterns of every sample; independent lanes keep the
+      // multiplies from serializing on one accumulator
+      std::uint64_t hash_samples(const Eigen::Ref<const Eigen::ArrayXXd> &x)
+      {
+        std::uint64_t lanes[kLanes] = {1, 2, 3, 4};
+        for (Eigen::Index col = 0; col < x.cols(); ++col)
+        {
+          const double *data = x.col(col).data();
+          Eigen::Index row = 0;
+          for (; row + kLanes <= x.rows(); row += kLanes)
+          {
+            for (int lane = 0; lane < kLanes; ++lane)
+            {
+              std::uint64_t bits;
+              std::memcpy(&bits, data + row + lane, sizeof(bits));
+              lanes[lane] = (lanes[lane] ^ bits) * kMultiplier;
+            }
+          }
+          for (; row < x.rows(); ++row)
+          {
+            std::uint64_t bits;
+            std::memcpy(&bits, data + row, sizeof(bits));
+            lanes[0] = (lanes[0] ^ bits) * kMultiplier;
+          }
+          lanes[1] = (lanes[1] ^ static_cast<std::uint64_t>(col)) * kMultiplier;
+        }
+        std::uint64_t hash = 0;
+        for (int lane = 0; lane < kLanes; ++lane)
+        {
+          hash = mix(hash ^ lanes[lane]);
+        }
+        return hash;
+      }
+    } // namespace
+
+    DatasetFingerprint::DatasetFingerprint()
+        : rows_(0), cols_(0), hash_(0) {}
+
+    DatasetFingerprint::DatasetFingerprint(
+        const Eigen::Ref<const Eigen::ArrayXXd> &x)
+        : rows_(x.rows()), cols_(x.cols()), hash_(hash_samples(x)) {}
+
+    bool DatasetFingerprint::Matches(
+        const Eigen::Ref<const Eigen::ArrayXXd> &x) const
+    {
+      return x.rows() == rows_ && x.cols() == cols_ &&
+             hash_samples(x) == hash_;
+    }
+
+    bool DatasetFingerprint::operator==(const DatasetFingerprint &other) const
+    {
+      return rows_ == other.rows_ && cols_ == other.cols_ &&
+             hash_ == other.hash_;
+    }
+
+    std::uint64_t DatasetFingerprint::GetHash() const
+    {
+      return hash_;
+    }
+  } // namespace evaluation_backend
+} // namespace bingo
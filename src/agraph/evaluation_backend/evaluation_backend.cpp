@@ -1,10 +1,14 @@
+#include <algorithm>
 #include <map>
+#include <new>
 #include <numeric>
 #include <iostream>
+#include <stdexcept>
 
 #include <Eigen/Dense>
 
 #include <bingocpp/agraph/evaluation_backend/evaluation_backend.h>
+#include <bingocpp/agraph/evaluation_backend/compiled_stack.h>
 #include <bingocpp/agraph/evaluation_backend/operator_eval.h>
 #include <bingocpp/agraph/constants.h>
 #include <bingocpp/agraph/operator_definitions.h>
@@ -15,31 +19,69 @@ namespace bingo
   {
     namespace
     {
+      void evaluate(const InstructionStream &stream,
+                    const Eigen::Ref<const Eigen::ArrayXXd> &x,
+                    const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+                    EvaluationWorkspace &workspace);
 
-      Eigen::ArrayXXd reverse_eval(const std::pair<int, int> &deriv_shape,
-                                   const int deriv_wrt_node,
-                                   const std::vector<Eigen::ArrayXXd> &forward_eval,
-                                   const Eigen::ArrayX3i &stack);
+      void evaluate_with_derivative(
+          const InstructionStream &stream,
+          const Eigen::Ref<const Eigen::ArrayXXd> &x,
+          const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+          const bool param_x_or_c,
+          EvaluationWorkspace &workspace);
 
-      std::vector<Eigen::ArrayXXd> forward_eval(
-          const Eigen::ArrayX3i &stack,
-          const Eigen::ArrayXXd &x,
-          const Eigen::ArrayXXd &constants);
+      void record_tiles(const InstructionStream &stream,
+                        const Eigen::Ref<const Eigen::ArrayXXd> &x,
+                        const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+                        ForwardTape &tape,
+                        EvaluationWorkspace &workspace);
 
-      EvalAndDerivative evaluate_with_derivative(
-          const Eigen::ArrayX3i &stack,
-          const Eigen::ArrayXXd &x,
-          const Eigen::ArrayXXd &constants,
-          const bool param_x_or_c);
+      void replay_tiles(const InstructionStream &stream,
+                        const ForwardTape &tape,
+                        int deriv_wrt_node,
+                        EvaluationWorkspace &workspace);
+
+      void evaluate_vector_jacobian_product(
+          const InstructionStream &stream,
+          const Eigen::Ref<const Eigen::ArrayXXd> &x,
+          const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+          const SeedFunction &seed,
+          EvaluationWorkspace &workspace);
+
+      void evaluate_normal_equations(
+          const InstructionStream &stream,
+          const Eigen::Ref<const Eigen::ArrayXXd> &x,
+          const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+          const ResidualFunction &residuals,
+          EvaluationWorkspace &workspace);
+
+      void evaluate_single(const InstructionStream &stream,
+                           const Eigen::Ref<const Eigen::ArrayXXf> &x,
+                           const Eigen::Ref<const Eigen::ArrayXXf> &constants,
+                           EvaluationWorkspace &workspace);
+
+      // a strict order on stacks, used to group identical stacks
+      bool stack_less(const Eigen::ArrayX3i &first,
+                      const Eigen::ArrayX3i &second)
+      {
+        if (first.rows() != second.rows())
+        {
+          return first.rows() < second.rows();
+        }
+        return std::lexicographical_compare(
+            first.data(), first.data() + first.size(),
+            second.data(), second.data() + second.size());
+      }
     } // namespace
 
     Eigen::ArrayXXd Evaluate(const Eigen::Ref<const Eigen::ArrayX3i> &stack,
                              const Eigen::Ref<const Eigen::ArrayXXd> &x,
                              const Eigen::Ref<const Eigen::ArrayXXd> &constants)
     {
-      std::vector<Eigen::ArrayXXd> _forward_eval = forward_eval(
-          stack, x, constants);
-      return _forward_eval.back();
+      EvaluationWorkspace workspace;
+      Evaluate(stack, x, constants, workspace);
+      return std::move(workspace.result.first);
     }
 
     std::pair<Eigen::ArrayXXd, Eigen::ArrayXXd> EvaluateWithDerivative(
@@ -48,106 +90,978 @@ namespace bingo
         const Eigen::Ref<const Eigen::ArrayXXd> &constants,
         const bool param_x_or_c)
     {
-      return evaluate_with_derivative(
-          stack, x, constants, param_x_or_c);
+      EvaluationWorkspace workspace;
+      EvaluateWithDerivative(stack, x, constants, param_x_or_c, workspace);
+      return std::move(workspace.result);
+    }
+
+    const Eigen::ArrayXXd &Evaluate(
+        const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+        const Eigen::Ref<const Eigen::ArrayXXd> &x,
+        const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+        EvaluationWorkspace &workspace)
+    {
+      workspace.program.Compile(stack);
+      return Evaluate(workspace.program, x, constants, workspace);
+    }
+
+    const EvalAndDerivative &EvaluateWithDerivative(
+        const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+        const Eigen::Ref<const Eigen::ArrayXXd> &x,
+        const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+        const bool param_x_or_c,
+        EvaluationWorkspace &workspace)
+    {
+      workspace.program.Compile(stack);
+      return EvaluateWithDerivative(workspace.program, x, constants,
+                                    param_x_or_c, workspace);
+    }
+
+    const Eigen::ArrayXXd &Evaluate(
+        const CompiledStack &program,
+        const Eigen::Ref<const Eigen::ArrayXXd> &x,
+        const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+        EvaluationWorkspace &workspace)
+    {
+      evaluate(program.value, x, constants, workspace);
+      return workspace.result.first;
+    }
+
+    const EvalAndDerivative &EvaluateWithDerivative(
+        const CompiledStack &program,
+        const Eigen::Ref<const Eigen::ArrayXXd> &x,
+        const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+        const bool param_x_or_c,
+        EvaluationWorkspace &workspace)
+    {
+      evaluate_with_derivative(
+          program.derivative, x, constants, param_x_or_c, workspace);
+      return workspace.result;
+    }
+
+    const Eigen::ArrayXXd &EvaluateAndRecord(
+        const CompiledStack &program,
+        const Eigen::Ref<const Eigen::ArrayXXd> &x,
+        const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+        std::size_t tape_budget,
+        std::shared_ptr<const ForwardTape> &tape,
+        EvaluationWorkspace &workspace)
+    {
+      if (constants.cols() > 1)
+      {
+        throw std::invalid_argument(
+            "Forward tapes take a single set of constants");
+      }
+      std::size_t tape_size =
+          static_cast<std::size_t>(program.derivative.num_buffers) *
+          x.rows() * sizeof(double);
+      if (x.rows() == 0 || tape_size > tape_budget)
+      {
+        tape.reset();
+        return Evaluate(program, x, constants, workspace);
+      }
+      std::shared_ptr<ForwardTape> recorded = std::make_shared<ForwardTape>();
+      record_tiles(program.derivative, x, constants, *recorded, workspace);
+      tape = recorded;
+      return workspace.result.first;
+    }
+
+    const EvalAndDerivative &EvaluateWithDerivative(
+        const CompiledStack &program,
+        const ForwardTape &tape,
+        const bool param_x_or_c,
+        EvaluationWorkspace &workspace)
+    {
+      replay_tiles(program.derivative, tape,
+                   param_x_or_c ? Op::kVariable : Op::kConstant, workspace);
+      return workspace.result;
+    }
+
+    const Eigen::ArrayXXf &EvaluateSingle(
+        const CompiledStack &program,
+        const Eigen::Ref<const Eigen::ArrayXXf> &x,
+        const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+        EvaluationWorkspace &workspace)
+    {
+      workspace.single_constants = constants.cast<float>();
+      // the value stream has fused chains, which only run in double
+      evaluate_single(program.derivative, x, workspace.single_constants,
+                      workspace);
+      return workspace.single_result;
+    }
+
+    const Eigen::ArrayXXf &EvaluateSingle(
+        const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+        const Eigen::Ref<const Eigen::ArrayXXf> &x,
+        const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+        EvaluationWorkspace &workspace)
+    {
+      workspace.program.Compile(stack);
+      return EvaluateSingle(workspace.program, x, constants, workspace);
+    }
+
+    const EvalAndDerivative &EvaluateVectorJacobianProduct(
+        const CompiledStack &program,
+        const Eigen::Ref<const Eigen::ArrayXXd> &x,
+        const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+        const SeedFunction &seed,
+        EvaluationWorkspace &workspace)
+    {
+      if (constants.cols() > 1)
+      {
+        throw std::invalid_argument(
+            "Vector-Jacobian products take a single set of constants");
+      }
+      evaluate_vector_jacobian_product(program.derivative, x, constants,
+                                       seed, workspace);
+      return workspace.result;
+    }
+
+    const EvalAndDerivative &EvaluateVectorJacobianProduct(
+        const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+        const Eigen::Ref<const Eigen::ArrayXXd> &x,
+        const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+        const SeedFunction &seed,
+        EvaluationWorkspace &workspace)
+    {
+      workspace.program.Compile(stack);
+      return EvaluateVectorJacobianProduct(workspace.program, x, constants,
+                                           seed, workspace);
+    }
+
+    const EvalAndNormalEquations &EvaluateNormalEquations(
+        const CompiledStack &program,
+        const Eigen::Ref<const Eigen::ArrayXXd> &x,
+        const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+        const ResidualFunction &residuals,
+        EvaluationWorkspace &workspace)
+    {
+      if (constants.cols() > 1)
+      {
+        throw std::invalid_argument(
+            "Normal equations take a single set of constants");
+      }
+      evaluate_normal_equations(program.derivative, x, constants, residuals,
+                                workspace);
+      return workspace.normal_equations;
+    }
+
+    const EvalAndNormalEquations &EvaluateNormalEquations(
+        const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+        const Eigen::Ref<const Eigen::ArrayXXd> &x,
+        const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+        const ResidualFunction &residuals,
+        EvaluationWorkspace &workspace)
+    {
+      workspace.program.Compile(stack);
+      return EvaluateNormalEquations(workspace.program, x, constants,
+                                     residuals, workspace);
+    }
+
+    const EvalAndDerivative &EvaluateConstantSets(
+        const CompiledStack &program,
+        const Eigen::Ref<const Eigen::ArrayXXd> &x,
+        const Eigen::Ref<const Eigen::ArrayXXd> &constant_sets,
+        EvaluationWorkspace &workspace)
+    {
+      evaluate_with_derivative(program.derivative, x, constant_sets, false,
+                               workspace);
+      return workspace.result;
+    }
+
+    const EvalAndDerivative &EvaluateConstantSets(
+        const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+        const Eigen::Ref<const Eigen::ArrayXXd> &x,
+        const Eigen::Ref<const Eigen::ArrayXXd> &constant_sets,
+        EvaluationWorkspace &workspace)
+    {
+      workspace.program.Compile(stack);
+      return EvaluateConstantSets(workspace.program, x, constant_sets,
+                                  workspace);
+    }
+
+    void EvaluateBatch(const std::vector<Eigen::ArrayX3i> &stacks,
+                       const Eigen::Ref<const Eigen::ArrayXXd> &x,
+                       const std::vector<Eigen::ArrayXXd> &constants,
+                       std::vector<Eigen::ArrayXXd> &values,
+                       EvaluationWorkspace &workspace)
+    {
+      if (constants.size() != stacks.size())
+      {
+        throw std::invalid_argument(
+            "EvaluateBatch needs one set of constants per stack");
+      }
+      values.resize(stacks.size());
+      std::vector<int> order(stacks.size());
+      std::iota(order.begin(), order.end(), 0);
+      std::sort(order.begin(), order.end(), [&](int a, int b) {
+        if (stack_less(stacks[a], stacks[b]) ||
+            stack_less(stacks[b], stacks[a]))
+        {
+          return stack_less(stacks[a], stacks[b]);
+        }
+        return constants[a].rows() < constants[b].rows();
+      });
+
+      Eigen::ArrayXXd packed;
+      const Eigen::ArrayX3i *compiled = nullptr;
+      std::size_t group_start = 0;
+      while (group_start < order.size())
+      {
+        const Eigen::ArrayX3i &stack = stacks[order[group_start]];
+        int num_constants = constants[order[group_start]].rows();
+        std::size_t group_end = group_start + 1;
+        int num_sets = constants[order[group_start]].cols();
+        while (group_end < order.size() &&
+               group_end - group_start < static_cast<std::size_t>(kBatchWidth) &&
+               !stack_less(stack, stacks[order[group_end]]) &&
+               constants[order[group_end]].rows() == num_constants)
+        {
+          num_sets += constants[order[group_end]].cols();
+          ++group_end;
+        }
+
+        // groups wider than kBatchWidth are split but compiled once
+        if (compiled == nullptr || stack_less(*compiled, stack))
+        {
+          workspace.program.Compile(stack);
+          compiled = &stack;
+        }
+        if (group_end - group_start == 1)
+        {
+          values[order[group_start]] = Evaluate(
+              workspace.program, x, constants[order[group_start]], workspace);
+          group_start = group_end;
+          continue;
+        }
+
+        packed.resize(num_constants, num_sets);
+        int col = 0;
+        for (std::size_t i = group_start; i < group_end; ++i)
+        {
+          const Eigen::ArrayXXd &c = constants[order[i]];
+          packed.middleCols(col, c.cols()) = c;
+          col += c.cols();
+        }
+        const Eigen::ArrayXXd &packed_values =
+            Evaluate(workspace.program, x, packed, workspace);
+        col = 0;
+        for (std::size_t i = group_start; i < group_end; ++i)
+        {
+          int cols = constants[order[i]].cols();
+          values[order[i]] = packed_values.middleCols(col, cols);
+          col += cols;
+        }
+        group_start = group_end;
+      }
+    }
+
+    std::vector<Eigen::ArrayXXd> EvaluateBatch(
+        const std::vector<Eigen::ArrayX3i> &stacks,
+        const Eigen::Ref<const Eigen::ArrayXXd> &x,
+        const std::vector<Eigen::ArrayXXd> &constants)
+    {
+      EvaluationWorkspace workspace;
+      std::vector<Eigen::ArrayXXd> values;
+      EvaluateBatch(stacks, x, constants, values, workspace);
+      return values;
     }
 
     namespace
     {
+      // deriv_wrt_node of evaluations that take no derivative
+      constexpr int kValueOnly = -2;
 
-      Eigen::ArrayXXd reverse_eval(const std::pair<int, int> &deriv_shape,
-                                   const int deriv_wrt_node,
-                                   const std::vector<Eigen::ArrayXXd> &forward_eval,
-                                   const Eigen::ArrayX3i &stack)
+      int tile_rows(int num_samples, int tile_size)
       {
-        int num_samples = deriv_shape.first;
-        int num_features = deriv_shape.second;
-        int stack_depth = stack.rows();
+        if (tile_size <= 0 || tile_size > num_samples)
+        {
+          return num_samples;
+        }
+        return tile_size;
+      }
 
-        Eigen::ArrayXXd derivative = Eigen::ArrayXXd::Zero(num_samples, num_features);
-        std::vector<Eigen::ArrayXXd> reverse_eval(stack_depth);
-        for (int row = 0; row < stack_depth; row++)
+      // tile_rows capped so that num_buffers forward and reverse buffers
+      // (or single precision buffers) of one tile fit the memory budget
+      // of workspace; at least one sample is evaluated at a time
+      int budget_tile_rows(int num_samples, int num_buffers,
+                           int num_constant_sets, bool single,
+                           const EvaluationWorkspace &workspace)
+      {
+        int tile_size = tile_rows(num_samples, workspace.GetTileSize());
+        std::size_t budget = workspace.GetMemoryBudget();
+        if (budget == 0)
         {
-          reverse_eval[row] = Eigen::ArrayXd::Zero(num_samples);
+          return tile_size;
         }
+        std::size_t bytes_per_sample =
+            static_cast<std::size_t>(std::max(num_buffers, 1)) *
+            std::max(num_constant_sets, 1) *
+            (single ? sizeof(float) : 2 * sizeof(double));
+        std::size_t max_rows = std::max<std::size_t>(
+            budget / bytes_per_sample, 1);
+        return static_cast<int>(
+            std::min<std::size_t>(tile_size, max_rows));
+      }
 
-        reverse_eval[stack_depth - 1] = Eigen::ArrayXd::Ones(num_samples);
-        for (int i = stack_depth - 1; i >= 0; i--)
+      // sweep the adjoint seeded in the reverse buffer of the last row back
+      // through the stack, calling store(param1, adjoint) at every terminal
+      // the derivative is taken with respect to; with K constant sets
+      // every adjoint has K columns
+      template <typename Store>
+      void reverse_eval(const int deriv_wrt_node,
+                        const InstructionStream &stream,
+                        int num_samples, int num_constant_sets,
+                        const Store &store,
+                        EvaluationWorkspace &workspace)
+      {
+        const std::vector<Instruction> &instructions = stream.instructions;
+        const Accuracy accuracy = workspace.GetAccuracy();
+        for (auto it = instructions.rbegin(); it != instructions.rend(); ++it)
         {
-          int node = stack(i, kOpIdx);
-          int param1 = stack(i, kParam1Idx);
-          int param2 = stack(i, kParam2Idx);
-          if (node == deriv_wrt_node)
+          const Instruction &instruction = *it;
+          if (instruction.node == deriv_wrt_node)
           {
-            derivative.col(param1) += reverse_eval[i];
+            store(instruction.forward.param1,
+                  workspace.reverse_eval[instruction.reverse.result]);
           }
-          else
+          else if (instruction.node > Op::kConstant)
+          {
+            // operand adjoints start accumulating at their last use
+            if (instruction.clear_param1_adjoint)
+            {
+              workspace.ShapeReverseBuffer(instruction.reverse.param1,
+                                           num_samples, num_constant_sets)
+                  .setZero();
+            }
+            if (instruction.clear_param2_adjoint)
+            {
+              workspace.ShapeReverseBuffer(instruction.reverse.param2,
+                                           num_samples, num_constant_sets)
+                  .setZero();
+            }
+            // the compiled kernels assume single column adjoints
+            if (num_constant_sets == 1)
+            {
+              instruction.reverse_kernels[accuracy](instruction.forward,
+                                                    instruction.reverse,
+                                                    workspace);
+            }
+            else
+            {
+              ReverseEvalFunction(instruction.node, instruction.forward,
+                                  instruction.reverse, workspace);
+            }
+          }
+        }
+      }
+
+      void forward_eval(const InstructionStream &stream,
+                        const Eigen::Ref<const Eigen::ArrayXXd> &x,
+                        const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+                        EvaluationWorkspace &workspace)
+      {
+        const Accuracy accuracy = workspace.GetAccuracy();
+        for (const Instruction &instruction : stream.instructions)
+        {
+          if (instruction.chain >= 0)
+          {
+            FusedForwardEval(stream.chains[instruction.chain],
+                             instruction.forward.result, instruction.shape,
+                             x, constants, workspace);
+            continue;
+          }
+          instruction.forward_kernels[accuracy](instruction.forward.result,
+                                                instruction.forward.param1,
+                                                instruction.forward.param2,
+                                                x, constants, workspace);
+        }
+      }
+
+      // forward mode keeps every row in a buffer of its own, at its
+      // position in the stream, followed by the tangents of every row
+      int num_tangent_buffers(const InstructionStream &stream,
+                              int num_directions)
+      {
+        return stream.instructions.size() * (1 + num_directions);
+      }
+
+      // forward mode computes a tangent per direction at every operator
+      // row, reverse mode an adjoint per operand, so forward mode wins
+      // when there are no more directions than operands per row
+      bool use_forward_mode(const InstructionStream &stream,
+                            int num_directions, int num_constant_sets,
+                            const EvaluationWorkspace &workspace)
+      {
+        switch (workspace.GetDerivativeMode())
+        {
+        case kForwardMode:
+          return num_constant_sets <= 1;
+        case kReverseMode:
+          return false;
+        case kAutomatic:
+          break;
+        }
+        return num_constant_sets <= 1 &&
+               num_directions * stream.num_operators <= stream.num_operands;
+      }
+
+      // evaluate the values and the tangents of one tile in a single pass
+      void tangent_eval(const int deriv_wrt_node,
+                        const InstructionStream &stream,
+                        const Eigen::Ref<const Eigen::ArrayXXd> &x,
+                        const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+                        int num_directions,
+                        EvaluationWorkspace &workspace)
+      {
+        const int first_tangent = stream.instructions.size();
+        for (const Instruction &instruction : stream.instructions)
+        {
+          const RowBuffers &positions = instruction.positions;
+          ForwardEvalFunction(instruction.node, positions.result,
+                              positions.param1, positions.param2, x,
+                              constants, workspace);
+          RowBuffers tangent{
+              first_tangent + positions.result * num_directions,
+              first_tangent + positions.param1 * num_directions,
+              first_tangent + positions.param2 * num_directions};
+          if (instruction.node > Op::kConstant)
+          {
+            TangentEvalFunction(instruction.node, positions, tangent,
+                                num_directions, workspace);
+            continue;
+          }
+          // the tangents of terminals are empty (zero) but for the seed
+          for (int direction = 0; direction < num_directions; ++direction)
           {
-            ReverseEvalFunction(node, i, param1, param2, forward_eval, reverse_eval);
+            workspace.ShapeForwardBuffer(tangent.result + direction, 0, 0);
+          }
+          if (instruction.node == deriv_wrt_node)
+          {
+            workspace.ShapeForwardBuffer(tangent.result + positions.param1,
+                                         x.rows(), 1).setOnes();
           }
         }
-        return derivative;
       }
 
-      std::vector<Eigen::ArrayXXd> forward_eval(
-          const Eigen::ArrayX3i &stack,
-          const Eigen::ArrayXXd &x,
-          const Eigen::ArrayXXd &constants)
+      // copy the value in buffer result into rows [start, start + num_rows)
+      // of value, broadcast to the full output shape; value is sized by
+      // the first tile unless it was sized ahead of time
+      void store_value(int result,
+                       int start, int num_rows, int num_samples,
+                       int num_constant_sets, bool presized,
+                       const EvaluationWorkspace &workspace,
+                       Eigen::ArrayXXd &value)
       {
-        // std::cout << "---Evaluating Equation--\n";
-        // std::cout << "x (" << x.rows() << ", " << x.cols() << ")\n";
-        // std::cout << "consts (" << constants.rows() << ", " << constants.cols() << ")\n";
-        std::vector<Eigen::ArrayXXd> _forward_eval(stack.rows());
+        const BufferView &last = workspace.forward_eval[result];
+        int rows = std::max(num_rows, static_cast<int>(last.rows()));
+        int cols = last.cols();
+        if (cols == 1 && num_constant_sets > 1) {
+          cols = num_constant_sets;
+        }
+        if (start == 0 && !presized) {
+          value.resize(std::max(num_samples, rows), cols);
+        }
+        for (int col = 0; col < cols; ++col)
+        {
+          int source_col = last.cols() == 1 ? 0 : col;
+          auto column = value.col(col).segment(start, rows);
+          if (last.rows() == rows)
+          {
+            column = last.col(source_col);
+          }
+          else
+          {
+            column.setConstant(last(0, source_col));
+          }
+        }
+      }
 
-        for (int i = 0; i < stack.rows(); ++i)
+      // number of columns of the value of a stream, as found by store_value
+      int value_cols(const InstructionStream &stream, int num_constant_sets)
+      {
+        if (num_constant_sets > 1 ||
+            (stream.instructions.back().shape & kRow))
         {
-          int node = stack(i, kOpIdx);
-          int op1 = stack(i, kParam1Idx);
-          int op2 = stack(i, kParam2Idx);
-          // std::cout<< i << ": ["<<node << " " <<op1 << " " <<op2 <<"]";
-          _forward_eval[i] = ForwardEvalFunction(
-              node, op1, op2, x, constants, _forward_eval);
-            // std::cout<<"  (" << _forward_eval[i].rows() << ", " << _forward_eval[i].cols() << "): " << _forward_eval[i] << "\n";
+          return num_constant_sets;
         }
+        return 1;
+      }
+
+      // evaluate samples [begin, end) tile by tile with the buffers of
+      // workspace, storing the value (and derivative) in output
+      void evaluate_tiles(const InstructionStream &stream,
+                          const Eigen::Ref<const Eigen::ArrayXXd> &x,
+                          const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+                          int begin, int end, int deriv_wrt_node,
+                          bool presized,
+                          EvaluationWorkspace &workspace,
+                          EvaluationWorkspace &output)
+      {
+        int num_samples = x.rows();
+        int num_constant_sets = std::max<int>(constants.cols(), 1);
+        int num_directions =
+            output.result.second.cols() / num_constant_sets;
+        bool forward_mode =
+            deriv_wrt_node != kValueOnly &&
+            use_forward_mode(stream, num_directions, constants.cols(),
+                             workspace);
+        int num_buffers = forward_mode
+                              ? num_tangent_buffers(stream, num_directions)
+                              : stream.num_buffers;
+        int tile_size = budget_tile_rows(end - begin, num_buffers,
+                                         constants.cols(), false, workspace);
+        workspace.Reserve(num_buffers, tile_size, constants.cols());
+        int start = begin;
+        do
+        {
+          int num_rows = std::min(tile_size, end - start);
+          if (forward_mode)
+          {
+            int last = stream.instructions.size() - 1;
+            int first_tangent = stream.instructions.size();
+            tangent_eval(deriv_wrt_node, stream,
+                         x.middleRows(start, num_rows), constants,
+                         num_directions, workspace);
+            store_value(last, start, num_rows, num_samples,
+                        constants.cols(), presized, workspace,
+                        output.result.first);
+            for (int direction = 0; direction < num_directions; ++direction)
+            {
+              const BufferView &tangent =
+                  workspace.forward_eval[first_tangent +
+                                         last * num_directions + direction];
+              if (tangent.size() > 0)
+              {
+                output.result.second.col(direction).segment(start,
+                                                            num_rows) =
+                    tangent;
+              }
+            }
+            start += num_rows;
+            continue;
+          }
+          forward_eval(stream, x.middleRows(start, num_rows), constants,
+                       workspace);
+          store_value(stream.instructions.back().forward.result, start,
+                      num_rows, num_samples, constants.cols(), presized,
+                      workspace, output.result.first);
+          if (deriv_wrt_node != kValueOnly)
+          {
+            // set k of the derivative is in columns [k * F, (k + 1) * F)
+            // for F features
+            auto derivative =
+                output.result.second.middleRows(start, num_rows);
+            workspace.ShapeReverseBuffer(
+                stream.instructions.back().reverse.result, num_rows,
+                num_constant_sets).setOnes();
+            reverse_eval(
+                deriv_wrt_node, stream, num_rows, num_constant_sets,
+                [&](int feature, const BufferView &adjoint) {
+                  for (int set = 0; set < num_constant_sets; ++set)
+                  {
+                    derivative.col(set * num_directions + feature) +=
+                        adjoint.col(set);
+                  }
+                },
+                workspace);
+          }
+          start += num_rows;
+        } while (start < end);
+      }
+
+      // evaluate samples [begin, end) tile by tile with the buffers of
+      // workspace, storing the value in value and adding the gradient with
+      // respect to the constants weighted by seed to gradient
+      void vector_jacobian_tiles(
+          const InstructionStream &stream,
+          const Eigen::Ref<const Eigen::ArrayXXd> &x,
+          const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+          int begin, int end, const SeedFunction &seed,
+          EvaluationWorkspace &workspace, Eigen::ArrayXXd &value,
+          Eigen::Ref<Eigen::ArrayXd> gradient)
+      {
+        const Instruction &last = stream.instructions.back();
+        int tile_size = budget_tile_rows(end - begin, stream.num_buffers, 1,
+                                         false, workspace);
+        workspace.Reserve(stream.num_buffers, tile_size, 1);
+        int start = begin;
+        do
+        {
+          int num_rows = std::min(tile_size, end - start);
+          forward_eval(stream, x.middleRows(start, num_rows), constants,
+                       workspace);
+          store_value(last.forward.result, start, num_rows, x.rows(), 1,
+                      true, workspace, value);
+          Eigen::Map<Eigen::ArrayXd> weights(
+              workspace.ShapeReverseBuffer(last.reverse.result, num_rows, 1)
+                  .data(),
+              num_rows);
+          seed(start, value.middleRows(start, num_rows), weights);
+          reverse_eval(
+              Op::kConstant, stream, num_rows, 1,
+              [&](int constant, const BufferView &adjoint) {
+                gradient(constant) += adjoint.sum();
+              },
+              workspace);
+          start += num_rows;
+        } while (start < end);
+      }
+
+      // evaluate samples [begin, end) tile by tile with the buffers of
+      // workspace, storing the value in value and adding the products of
+      // the transposed residual Jacobian of every tile to the lower
+      // triangle of jacobian_product and to residual_product
+      void normal_equation_tiles(
+          const InstructionStream &stream,
+          const Eigen::Ref<const Eigen::ArrayXXd> &x,
+          const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+          int begin, int end, const ResidualFunction &residuals,
+          EvaluationWorkspace &workspace, Eigen::ArrayXXd &value,
+          Eigen::MatrixXd &jacobian_product,
+          Eigen::Ref<Eigen::VectorXd> residual_product)
+      {
+        const Instruction &last = stream.instructions.back();
+        int tile_size = budget_tile_rows(end - begin, stream.num_buffers, 1,
+                                         false, workspace);
+        workspace.Reserve(stream.num_buffers, tile_size, 1);
+        // only one tile of the Jacobian is ever formed
+        Eigen::ArrayXXd jacobian(tile_size, constants.rows());
+        Eigen::ArrayXd residual(tile_size);
+        int start = begin;
+        do
+        {
+          int num_rows = std::min(tile_size, end - start);
+          forward_eval(stream, x.middleRows(start, num_rows), constants,
+                       workspace);
+          store_value(last.forward.result, start, num_rows, x.rows(), 1,
+                      true, workspace, value);
+          auto tile_jacobian = jacobian.topRows(num_rows);
+          auto tile_residual = residual.head(num_rows);
+          tile_jacobian.setZero();
+          workspace.ShapeReverseBuffer(last.reverse.result, num_rows, 1)
+              .setOnes();
+          reverse_eval(
+              Op::kConstant, stream, num_rows, 1,
+              [&](int constant, const BufferView &adjoint) {
+                tile_jacobian.col(constant) += adjoint.col(0);
+              },
+              workspace);
+          residuals(start, value.middleRows(start, num_rows), tile_residual,
+                    tile_jacobian);
+          jacobian_product.selfadjointView<Eigen::Lower>().rankUpdate(
+              tile_jacobian.matrix().transpose());
+          residual_product.noalias() +=
+              tile_jacobian.matrix().transpose() * tile_residual.matrix();
+          start += num_rows;
+        } while (start < end);
+      }
 
-        Eigen::ArrayXXd tmp;
-        if (_forward_eval.back().rows() == 1 && x.rows() > 1) {
-          tmp = _forward_eval.back().replicate(x.rows(), 1);
-          _forward_eval.back() = tmp;
+      // evaluate tile by tile like evaluate_tiles, copying the forward
+      // buffers of every tile to tape
+      void record_tiles(const InstructionStream &stream,
+                        const Eigen::Ref<const Eigen::ArrayXXd> &x,
+                        const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+                        ForwardTape &tape,
+                        EvaluationWorkspace &workspace)
+      {
+        int num_samples = x.rows();
+        int num_buffers = stream.num_buffers;
+        int tile_size = budget_tile_rows(num_samples, num_buffers, 1, false,
+                                         workspace);
+        workspace.Reserve(num_buffers, tile_size, 1);
+        tape.dataset = DatasetFingerprint(x);
+        tape.constants = constants;
+        tape.accuracy = workspace.GetAccuracy();
+        tape.num_samples = num_samples;
+        tape.num_dimensions = x.cols();
+        tape.tile_size = tile_size;
+        tape.num_buffers = num_buffers;
+        tape.storage.resize(static_cast<Eigen::Index>(num_buffers) *
+                            num_samples);
+        tape.rows.clear();
+        for (int start = 0; start < num_samples; start += tile_size)
+        {
+          int num_rows = std::min(tile_size, num_samples - start);
+          forward_eval(stream, x.middleRows(start, num_rows), constants,
+                       workspace);
+          store_value(stream.instructions.back().forward.result, start,
+                      num_rows, num_samples, 1, false, workspace,
+                      workspace.result.first);
+          double *tile = tape.storage.data() +
+                         static_cast<Eigen::Index>(start) * num_buffers;
+          for (int buffer = 0; buffer < num_buffers; ++buffer)
+          {
+            // buffers the stream never writes keep their reserved shape
+            const BufferView &forward = workspace.forward_eval[buffer];
+            int rows = std::min<int>(forward.rows(), num_rows);
+            Eigen::Map<Eigen::ArrayXd>(tile + buffer * num_rows, rows) =
+                forward.col(0).head(rows);
+            tape.rows.push_back(rows);
+          }
         }
-        if (_forward_eval.back().cols() == 1 && constants.cols() > 1) {
-          tmp = _forward_eval.back().replicate(1, constants.cols());
-          _forward_eval.back() = tmp;
+        tape.value = workspace.result.first;
+      }
+
+      // run the reverse sweep of every tile of tape, reading the forward
+      // buffers in place
+      void replay_tiles(const InstructionStream &stream,
+                        const ForwardTape &tape,
+                        int deriv_wrt_node,
+                        EvaluationWorkspace &workspace)
+      {
+        const Instruction &last = stream.instructions.back();
+        int num_buffers = tape.num_buffers;
+        int num_features = deriv_wrt_node == Op::kVariable
+                               ? tape.num_dimensions
+                               : tape.constants.rows();
+        workspace.result.first = tape.value;
+        workspace.result.second.setZero(tape.num_samples, num_features);
+        workspace.Reserve(num_buffers, tape.tile_size, 1);
+        // the reverse kernels only read the forward buffers
+        double *storage = const_cast<double *>(tape.storage.data());
+        int tile = 0;
+        for (int start = 0; start < tape.num_samples;
+             start += tape.tile_size, ++tile)
+        {
+          int num_rows = std::min(tape.tile_size, tape.num_samples - start);
+          double *tile_storage =
+              storage + static_cast<Eigen::Index>(start) * num_buffers;
+          for (int buffer = 0; buffer < num_buffers; ++buffer)
+          {
+            new (&workspace.forward_eval[buffer]) BufferView(
+                tile_storage + buffer * num_rows,
+                tape.rows[tile * num_buffers + buffer], 1);
+          }
+          auto derivative = workspace.result.second.middleRows(start,
+                                                               num_rows);
+          workspace.ShapeReverseBuffer(last.reverse.result, num_rows, 1)
+              .setOnes();
+          reverse_eval(
+              deriv_wrt_node, stream, num_rows, 1,
+              [&](int feature, const BufferView &adjoint) {
+                derivative.col(feature) += adjoint.col(0);
+              },
+              workspace);
         }
+      }
 
-        return _forward_eval;
+      // number of samples in each chunk of a parallel evaluation, a whole
+      // number of tiles
+      int chunk_samples(int num_samples, const EvaluationWorkspace &workspace)
+      {
+        int num_chunks = workspace.GetNumThreads();
+        int tile_size = std::max(workspace.GetTileSize(), 1);
+        int num_tiles = (num_samples + tile_size - 1) / tile_size;
+        return (num_tiles + num_chunks - 1) / num_chunks * tile_size;
+      }
+
+      // split the samples over the threads of workspace in contiguous runs
+      // of whole tiles, so every tile is the same as on a single thread
+      void evaluate_chunks(const InstructionStream &stream,
+                           const Eigen::Ref<const Eigen::ArrayXXd> &x,
+                           const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+                           int deriv_wrt_node,
+                           EvaluationWorkspace &workspace)
+      {
+        int num_samples = x.rows();
+        int chunk_size = chunk_samples(num_samples, workspace);
+        workspace.result.first.resize(
+            num_samples, value_cols(stream, constants.cols()));
+        workspace.RunChunks(
+            [&](int chunk, EvaluationWorkspace &chunk_workspace) {
+              int begin = chunk * chunk_size;
+              int end = std::min(begin + chunk_size, num_samples);
+              if (begin < end)
+              {
+                evaluate_tiles(stream, x, constants, begin, end,
+                               deriv_wrt_node, true, chunk_workspace,
+                               workspace);
+              }
+            });
       }
 
-      EvalAndDerivative evaluate_with_derivative(
-          const Eigen::ArrayX3i &stack,
-          const Eigen::ArrayXXd &x,
-          const Eigen::ArrayXXd &constants,
-          const bool param_x_or_c)
+      void evaluate(const InstructionStream &stream,
+                    const Eigen::Ref<const Eigen::ArrayXXd> &x,
+                    const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+                    EvaluationWorkspace &workspace)
       {
-        std::vector<Eigen::ArrayXXd> _forward_eval = forward_eval(
-            stack, x, constants);
+        if (workspace.IsParallel(x.rows()))
+        {
+          evaluate_chunks(stream, x, constants, kValueOnly, workspace);
+          return;
+        }
+        evaluate_tiles(stream, x, constants, 0, x.rows(), kValueOnly,
+                       false, workspace, workspace);
+      }
 
-        std::pair<int, int> deriv_shape;
+      void evaluate_with_derivative(
+          const InstructionStream &stream,
+          const Eigen::Ref<const Eigen::ArrayXXd> &x,
+          const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+          const bool param_x_or_c,
+          EvaluationWorkspace &workspace)
+      {
+        int num_samples = x.rows();
+        int num_features;
         int deriv_wrt_node;
         if (param_x_or_c)
         { // true = x
-          deriv_shape = std::make_pair(x.rows(), x.cols());
+          num_features = x.cols();
           deriv_wrt_node = Op::kVariable;
         }
         else
         { // false = c
-          deriv_shape = std::make_pair(x.rows(), constants.size());
+          num_features = constants.rows();
           deriv_wrt_node = Op::kConstant;
         }
+        // each tile fills its own rows of the derivative
+        workspace.result.second.setZero(
+            num_samples, num_features * std::max<int>(constants.cols(), 1));
+
+        if (workspace.IsParallel(num_samples))
+        {
+          evaluate_chunks(stream, x, constants, deriv_wrt_node, workspace);
+          return;
+        }
+        evaluate_tiles(stream, x, constants, 0, num_samples, deriv_wrt_node,
+                       false, workspace, workspace);
+      }
+
+      void evaluate_vector_jacobian_product(
+          const InstructionStream &stream,
+          const Eigen::Ref<const Eigen::ArrayXXd> &x,
+          const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+          const SeedFunction &seed,
+          EvaluationWorkspace &workspace)
+      {
+        int num_samples = x.rows();
+        workspace.result.first.resize(num_samples, 1);
+        workspace.result.second.setZero(constants.rows(), 1);
+        if (!workspace.IsParallel(num_samples))
+        {
+          vector_jacobian_tiles(stream, x, constants, 0, num_samples, seed,
+                                workspace, workspace.result.first,
+                                workspace.result.second.col(0));
+          return;
+        }
+        // every chunk sums its own samples, then the chunks are summed
+        int chunk_size = chunk_samples(num_samples, workspace);
+        Eigen::ArrayXXd gradients = Eigen::ArrayXXd::Zero(
+            constants.rows(), workspace.GetNumThreads());
+        workspace.RunChunks(
+            [&](int chunk, EvaluationWorkspace &chunk_workspace) {
+              int begin = chunk * chunk_size;
+              int end = std::min(begin + chunk_size, num_samples);
+              if (begin < end)
+              {
+                vector_jacobian_tiles(stream, x, constants, begin, end,
+                                      seed, chunk_workspace,
+                                      workspace.result.first,
+                                      gradients.col(chunk));
+              }
+            });
+        workspace.result.second = gradients.rowwise().sum();
+      }
 
-        Eigen::ArrayXXd derivative = reverse_eval(
-            deriv_shape, deriv_wrt_node, _forward_eval, stack);
-        return std::make_pair(_forward_eval.back(), derivative);
+      void evaluate_normal_equations(
+          const InstructionStream &stream,
+          const Eigen::Ref<const Eigen::ArrayXXd> &x,
+          const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+          const ResidualFunction &residuals,
+          EvaluationWorkspace &workspace)
+      {
+        int num_samples = x.rows();
+        int num_constants = constants.rows();
+        Eigen::ArrayXXd &value = std::get<0>(workspace.normal_equations);
+        Eigen::MatrixXd &jacobian_product =
+            std::get<1>(workspace.normal_equations);
+        Eigen::VectorXd &residual_product =
+            std::get<2>(workspace.normal_equations);
+        value.resize(num_samples, 1);
+        jacobian_product.setZero(num_constants, num_constants);
+        residual_product.setZero(num_constants);
+        if (!workspace.IsParallel(num_samples))
+        {
+          normal_equation_tiles(stream, x, constants, 0, num_samples,
+                                residuals, workspace, value,
+                                jacobian_product, residual_product);
+        }
+        else
+        {
+          // every chunk sums its own samples, then the chunks are summed
+          int num_chunks = workspace.GetNumThreads();
+          int chunk_size = chunk_samples(num_samples, workspace);
+          std::vector<Eigen::MatrixXd> jacobian_products(
+              num_chunks, Eigen::MatrixXd::Zero(num_constants, num_constants));
+          Eigen::MatrixXd residual_products =
+              Eigen::MatrixXd::Zero(num_constants, num_chunks);
+          workspace.RunChunks(
+              [&](int chunk, EvaluationWorkspace &chunk_workspace) {
+                int begin = chunk * chunk_size;
+                int end = std::min(begin + chunk_size, num_samples);
+                if (begin < end)
+                {
+                  normal_equation_tiles(stream, x, constants, begin, end,
+                                        residuals, chunk_workspace, value,
+                                        jacobian_products[chunk],
+                                        residual_products.col(chunk));
+                }
+              });
+          for (int chunk = 0; chunk < num_chunks; ++chunk)
+          {
+            jacobian_product += jacobian_products[chunk];
+          }
+          residual_product = residual_products.rowwise().sum();
+        }
+        jacobian_product.triangularView<Eigen::StrictlyUpper>() =
+            jacobian_product.transpose();
+      }
+
+      // evaluate tile by tile like evaluate_tiles, in single precision
+      void evaluate_single(const InstructionStream &stream,
+                           const Eigen::Ref<const Eigen::ArrayXXf> &x,
+                           const Eigen::Ref<const Eigen::ArrayXXf> &constants,
+                           EvaluationWorkspace &workspace)
+      {
+        int num_samples = x.rows();
+        int num_constant_sets = constants.cols();
+        int tile_size = budget_tile_rows(num_samples, stream.num_buffers,
+                                         num_constant_sets, true, workspace);
+        workspace.ReserveSingle(stream.num_buffers, tile_size,
+                                num_constant_sets);
+        workspace.single_result.resize(
+            num_samples, value_cols(stream, num_constant_sets));
+        Eigen::ArrayXXf &value = workspace.single_result;
+        int start = 0;
+        do
+        {
+          int num_rows = std::min(tile_size, num_samples - start);
+          auto x_tile = x.middleRows(start, num_rows);
+          for (const Instruction &instruction : stream.instructions)
+          {
+            SingleForwardEvalFunction(
+                instruction.node, instruction.forward.result,
+                instruction.forward.param1, instruction.forward.param2,
+                x_tile, constants, workspace);
+          }
+          const SingleBufferView &last =
+              workspace.single_eval[stream.instructions.back().forward.result];
+          for (int col = 0; col < value.cols(); ++col)
+          {
+            int source_col = last.cols() == 1 ? 0 : col;
+            auto column = value.col(col).segment(start, num_rows);
+            if (last.rows() == num_rows)
+            {
+              column = last.col(source_col);
+            }
+            else
+            {
+              column.setConstant(last(0, source_col));
+            }
+          }
+          start += num_rows;
+        } while (start < num_samples);
       }
 
     } // namespace (anonymous)
@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <new>
+
+#include <bingocpp/agraph/evaluation_backend/evaluation_workspace.h>
+
+namespace bingo
+{
+  namespace evaluation_backend
+  {
+    namespace
+    {
+      template <typename View, typename Storage>
+      void point_views_at_storage(std::vector<View> &views,
+                                  Storage &storage,
+                                  int buffer_size)
+      {
+        for (std::size_t i = 0; i < views.size(); ++i)
+        {
+          new (&views[i]) View(storage.data() + i * buffer_size,
+                               buffer_size, 1);
+        }
+      }
+
+      template <typename View, typename Storage>
+      void grow(std::vector<View> &views, Storage &storage,
+                int num_buffers, int buffer_size)
+      {
+        // only the buffers asked for get storage, so a smaller stack after
+        // a deeper one does not hold on to slots it never uses
+        views.resize(num_buffers, View(nullptr, 0, 0));
+        Eigen::Index required_size =
+            static_cast<Eigen::Index>(views.size()) * buffer_size;
+        if (storage.size() < required_size)
+        {
+          storage.resize(required_size);
+        }
+        point_views_at_storage(views, storage, buffer_size);
+      }
+    } // namespace
+
+    EvaluationWorkspace::EvaluationWorkspace()
+        : tile_size_(kDefaultTileSize), memory_budget_(0),
+          accuracy_(kStrict), derivative_mode_(kAutomatic),
+          parallel_threshold_(kDefaultParallelThreshold), forward_size_(0),
+          reverse_size_(0), single_size_(0) {}
+
+    EvaluationWorkspace::EvaluationWorkspace(int num_buffers, int num_samples,
+                                             int num_constant_sets)
+        : EvaluationWorkspace()
+    {
+      Reserve(num_buffers, num_samples, num_constant_sets);
+    }
+
+    void EvaluationWorkspace::Reserve(int num_buffers, int num_samples,
+                                      int num_constant_sets)
+    {
+      forward_size_ = num_samples * std::max(num_constant_sets, 1);
+      reverse_size_ = forward_size_;
+      grow(forward_eval, forward_storage_, num_buffers, forward_size_);
+      grow(reverse_eval, reverse_storage_, num_buffers, reverse_size_);
+    }
+
+    void EvaluationWorkspace::ReserveSingle(int num_buffers, int num_samples,
+                                            int num_constant_sets)
+    {
+      single_size_ = num_samples * std::max(num_constant_sets, 1);
+      grow(single_eval, single_storage_, num_buffers, single_size_);
+    }
+
+    void EvaluationWorkspace::SetTileSize(int tile_size)
+    {
+      tile_size_ = std::max(tile_size, 0);
+    }
+
+    int EvaluationWorkspace::GetTileSize() const
+    {
+      return tile_size_;
+    }
+
+    void EvaluationWorkspace::SetMemoryBudget(std::size_t bytes)
+    {
+      memory_budget_ = bytes;
+      if (bytes == 0)
+      {
+        return;
+      }
+      forward_eval.clear();
+      reverse_eval.clear();
+      single_eval.clear();
+      forward_storage_ = Eigen::ArrayXd();
+      reverse_storage_ = Eigen::ArrayXd();
+      single_storage_ = Eigen::ArrayXf();
+      forward_size_ = 0;
+      reverse_size_ = 0;
+      single_size_ = 0;
+    }
+
+    std::size_t EvaluationWorkspace::GetMemoryBudget() const
+    {
+      return memory_budget_;
+    }
+
+    void EvaluationWorkspace::SetNumThreads(int num_threads)
+    {
+      num_threads = std::max(num_threads, 1);
+      if (num_threads == GetNumThreads())
+      {
+        return;
+      }
+      pool_.reset();
+      chunk_workspaces_.clear();
+      if (num_threads > 1)
+      {
+        pool_.reset(new WorkStealingPool(num_threads));
+        for (int i = 0; i < num_threads; ++i)
+        {
+          chunk_workspaces_.emplace_back(new EvaluationWorkspace());
+        }
+      }
+    }
+
+    int EvaluationWorkspace::GetNumThreads() const
+    {
+      return pool_ ? pool_->GetNumThreads() : 1;
+    }
+
+    void EvaluationWorkspace::SetParallelThreshold(int num_samples)
+    {
+      parallel_threshold_ = std::max(num_samples, 1);
+    }
+
+    int EvaluationWorkspace::GetParallelThreshold() const
+    {
+      return parallel_threshold_;
+    }
+
+    bool EvaluationWorkspace::IsParallel(int num_samples) const
+    {
+      return pool_ && num_samples >= parallel_threshold_;
+    }
+
+    void EvaluationWorkspace::RunChunks(
+        const std::function<void(int, EvaluationWorkspace &)> &task)
+    {
+      std::vector<int> chunks(chunk_workspaces_.size());
+      for (std::size_t i = 0; i < chunks.size(); ++i)
+      {
+        chunks[i] = i;
+        chunk_workspaces_[i]->SetTileSize(tile_size_);
+        if (chunk_workspaces_[i]->GetMemoryBudget() !=
+            memory_budget_ / chunks.size())
+        {
+          chunk_workspaces_[i]->SetMemoryBudget(memory_budget_ /
+                                                chunks.size());
+        }
+        chunk_workspaces_[i]->SetAccuracy(accuracy_);
+        chunk_workspaces_[i]->SetDerivativeMode(derivative_mode_);
+      }
+      pool_->Run(chunks, [this, &task](int chunk) {
+        task(chunk, *chunk_workspaces_[chunk]);
+      });
+    }
+
+    void EvaluationWorkspace::SetAccuracy(Accuracy accuracy)
+    {
+      accuracy_ = accuracy;
+    }
+
+    Accuracy EvaluationWorkspace::GetAccuracy() const
+    {
+      return accuracy_;
+    }
+
+    void EvaluationWorkspace::SetDerivativeMode(DerivativeMode mode)
+    {
+      derivative_mode_ = mode;
+    }
+
+    DerivativeMode EvaluationWorkspace::GetDerivativeMode() const
+    {
+      return derivative_mode_;
+    }
+
+    BufferView &EvaluationWorkspace::ShapeForwardBuffer(int index, int rows,
+                                                        int cols)
+    {
+      new (&forward_eval[index]) BufferView(
+          forward_storage_.data() + index * forward_size_, rows, cols);
+      return forward_eval[index];
+    }
+
+    BufferView &EvaluationWorkspace::ShapeReverseBuffer(int index, int rows,
+                                                        int cols)
+    {
+      new (&reverse_eval[index]) BufferView(
+          reverse_storage_.data() + index * reverse_size_, rows, cols);
+      return reverse_eval[index];
+    }
+
+    SingleBufferView &EvaluationWorkspace::ShapeSingleBuffer(int index,
+                                                             int rows,
+                                                             int cols)
+    {
+      new (&single_eval[index]) SingleBufferView(
+          single_storage_.data() + index * single_size_, rows, cols);
+      return single_eval[index];
+    }
+
+    EvaluationWorkspace &ThreadWorkspace()
+    {
+      thread_local EvaluationWorkspace workspace;
+      return workspace;
+    }
+
+    AccuracyScope::AccuracyScope(EvaluationWorkspace &workspace,
+                                 Accuracy accuracy)
+        : workspace_(workspace), previous_(workspace.GetAccuracy())
+    {
+      workspace_.SetAccuracy(accuracy);
+    }
+
+    AccuracyScope::~AccuracyScope()
+    {
+      workspace_.SetAccuracy(previous_);
+    }
+  } // namespace evaluation_backend
+} // namespace bingo
@@ -0,0 +1,167 @@
+#include <bingocpp/agraph/evaluation_backend/folded_stack.h>
+#include <bingocpp/agraph/evaluation_backend/evaluation_backend.h>
+#include <bingocpp/agraph/constants.h>
+#include <bingocpp/agraph/operator_definitions.h>
+
+namespace bingo
+{
+  namespace evaluation_backend
+  {
+    namespace
+    {
+      bool is_operator(const Eigen::Ref<const Eigen::ArrayX3i> &stack, int row)
+      {
+        return stack(row, kOpIdx) > Op::kConstant;
+      }
+
+      // rows that are not x-independent operators feeding x-dependent rows
+      // (or the output) are left in the program
+      std::vector<bool> find_folded_roots(
+          const Eigen::Ref<const Eigen::ArrayX3i> &stack)
+      {
+        int stack_depth = stack.rows();
+        std::vector<bool> uses_x(stack_depth, false);
+        for (int i = 0; i < stack_depth; ++i)
+        {
+          int node = stack(i, kOpIdx);
+          if (node == Op::kVariable)
+          {
+            uses_x[i] = true;
+          }
+          else if (node > Op::kConstant)
+          {
+            uses_x[i] = uses_x[stack(i, kParam1Idx)] ||
+                        (kIsArity2Map.at(node) && uses_x[stack(i, kParam2Idx)]);
+          }
+        }
+
+        std::vector<bool> used(stack_depth, false);
+        std::vector<bool> folded(stack_depth, false);
+        if (stack_depth == 0)
+        {
+          return folded;
+        }
+        used.back() = true;
+        folded.back() = !uses_x.back() && is_operator(stack, stack_depth - 1);
+        for (int i = stack_depth - 1; i >= 0; --i)
+        {
+          if (!used[i] || !uses_x[i] || !is_operator(stack, i))
+          {
+            continue;
+          }
+          int node = stack(i, kOpIdx);
+          int param1 = stack(i, kParam1Idx);
+          int param2 = kIsArity2Map.at(node) ? stack(i, kParam2Idx) : param1;
+          for (int param : {param1, param2})
+          {
+            used[param] = true;
+            if (!uses_x[param] && is_operator(stack, param))
+            {
+              folded[param] = true;
+            }
+          }
+        }
+        return folded;
+      }
+    } // namespace
+
+    FoldedStack::FoldedStack()
+        : num_constants_(0), folded_with_(kStrict), is_folded_(false) {}
+
+    void FoldedStack::Compile(const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+                              int num_constants)
+    {
+      num_constants_ = num_constants;
+      is_folded_ = false;
+      stack_ = stack;
+      subtrees_.clear();
+
+      std::vector<bool> folded = find_folded_roots(stack);
+      Eigen::ArrayX3i program_stack = stack;
+      for (int i = 0; i < stack.rows(); ++i)
+      {
+        if (!folded[i])
+        {
+          continue;
+        }
+        int constant_index = num_constants + subtrees_.size();
+        subtrees_.emplace_back(stack.topRows(i + 1));
+        program_stack.row(i) << Op::kConstant, constant_index, constant_index;
+      }
+      program_.Compile(program_stack);
+    }
+
+    const Eigen::ArrayXXd &FoldedStack::Fold(const Eigen::ArrayXXd &constants,
+                                             EvaluationWorkspace &workspace)
+    {
+      if (subtrees_.empty())
+      {
+        return constants;
+      }
+      if (constants.rows() != num_constants_)
+      {
+        Compile(stack_, constants.rows());
+      }
+      if (is_folded_ && folded_with_ == workspace.GetAccuracy() &&
+          folded_for_.cols() == constants.cols() &&
+          (folded_for_ == constants).all())
+      {
+        return extended_constants_;
+      }
+
+      int num_folded = GetNumFolded();
+      extended_constants_.resize(num_constants_ + num_folded, constants.cols());
+      extended_constants_.topRows(num_constants_) = constants;
+      // gradients are only defined for a single set of constants
+      bool with_gradient = constants.cols() == 1;
+      if (with_gradient)
+      {
+        jacobian_.resize(num_folded, num_constants_);
+      }
+      Eigen::ArrayXXd no_samples(1, 0);
+      for (int i = 0; i < num_folded; ++i)
+      {
+        if (with_gradient)
+        {
+          const EvalAndDerivative &folded = EvaluateWithDerivative(
+              subtrees_[i], no_samples, constants, false, workspace);
+          extended_constants_.row(num_constants_ + i) = folded.first;
+          jacobian_.row(i) = folded.second;
+        }
+        else
+        {
+          extended_constants_.row(num_constants_ + i) =
+              Evaluate(subtrees_[i], no_samples, constants, workspace);
+        }
+      }
+      folded_for_ = constants;
+      folded_with_ = workspace.GetAccuracy();
+      is_folded_ = true;
+      return extended_constants_;
+    }
+
+    Eigen::ArrayXXd FoldedStack::ConstantDerivative(
+        const Eigen::ArrayXXd &program_derivative) const
+    {
+      if (subtrees_.empty())
+      {
+        return program_derivative;
+      }
+      Eigen::ArrayXXd derivative = program_derivative.leftCols(num_constants_);
+      derivative.matrix() +=
+          program_derivative.rightCols(GetNumFolded()).matrix() *
+          jacobian_.matrix();
+      return derivative;
+    }
+
+    const CompiledStack &FoldedStack::GetProgram() const
+    {
+      return program_;
+    }
+
+    int FoldedStack::GetNumFolded() const
+    {
+      return subtrees_.size();
+    }
+  } // namespace evaluation_backend
+} // namespace bingo
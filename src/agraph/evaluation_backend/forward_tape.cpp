@@ -0,0 +1,18 @@
+#include <bingocpp/agraph/evaluation_backend/forward_tape.h>
+
+namespace bingo
+{
+  namespace evaluation_backend
+  {
+    bool ForwardTape::IsTapeOf(
+        const Eigen::Ref<const Eigen::ArrayXXd> &x,
+        const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+        Accuracy accuracy) const
+    {
+      return accuracy == this->accuracy &&
+             constants.rows() == this->constants.rows() &&
+             constants.cols() == this->constants.cols() &&
+             (constants == this->constants).all() && dataset.Matches(x);
+    }
+  } // namespace evaluation_backend
+} // namespace bingo
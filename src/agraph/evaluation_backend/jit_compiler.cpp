@@ -0,0 +1,550 @@
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <bingocpp/agraph/evaluation_backend/jit_compiler.h>
+#include <bingocpp/agraph/operator_definitions.h>
+
+extern char **environ;
+
+namespace bingo
+{
+  namespace evaluation_backend
+  {
+    namespace
+    {
+      const char *kDefaultJitCompiler = "c++ -O2 -fPIC -shared";
+      const char *kSharedFlags = " -fPIC -shared";
+
+      typedef std::shared_future<std::shared_ptr<const JitFunction>>
+          FutureFunction;
+
+      struct CacheEntry
+      {
+        std::size_t hash;
+        long id;
+        Eigen::ArrayX3i stack;
+        // ready once the stack is compiled; nullptr if that failed
+        FutureFunction function;
+      };
+      typedef std::list<CacheEntry>::iterator EntryIterator;
+
+      std::vector<std::string> split_arguments(const std::string &command)
+      {
+        std::istringstream words(command);
+        std::vector<std::string> arguments;
+        std::string word;
+        while (words >> word)
+        {
+          arguments.push_back(word);
+        }
+        return arguments;
+      }
+
+      // Compiled stacks, most recently used first. Stacks are compiled
+      // without holding the mutex, so only callers wanting the stack being
+      // compiled wait for it.
+      struct JitCache
+      {
+        std::mutex mutex;
+        std::list<CacheEntry> entries;
+        std::unordered_multimap<std::size_t, EntryIterator> index;
+        std::size_t capacity = kDefaultJitCacheCapacity;
+        long next_id = 0;
+        std::vector<std::string> compiler = []() {
+          const char *cxx = getenv("BINGOCPP_JIT_CXX");
+          if (cxx == nullptr)
+          {
+            return split_arguments(kDefaultJitCompiler);
+          }
+          return split_arguments(std::string(cxx) + kSharedFlags);
+        }();
+
+        EntryIterator find(const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+                           std::size_t hash)
+        {
+          auto range = index.equal_range(hash);
+          for (auto it = range.first; it != range.second; ++it)
+          {
+            const Eigen::ArrayX3i &cached = it->second->stack;
+            if (cached.rows() == stack.rows() && (cached == stack).all())
+            {
+              return it->second;
+            }
+          }
+          return entries.end();
+        }
+
+        void erase(EntryIterator entry)
+        {
+          auto range = index.equal_range(entry->hash);
+          for (auto it = range.first; it != range.second; ++it)
+          {
+            if (it->second == entry)
+            {
+              index.erase(it);
+              break;
+            }
+          }
+          entries.erase(entry);
+        }
+
+        // the compiled functions of evicted entries are released once the
+        // last AGraph using them lets go, which unloads their libraries
+        void evict()
+        {
+          while (entries.size() > capacity)
+          {
+            erase(std::prev(entries.end()));
+          }
+        }
+      };
+
+      JitCache &cache()
+      {
+        static JitCache jit_cache;
+        return jit_cache;
+      }
+
+      std::size_t hash_stack(const Eigen::Ref<const Eigen::ArrayX3i> &stack)
+      {
+        std::size_t seed = stack.rows();
+        for (int i = 0; i < stack.rows(); ++i)
+        {
+          for (int j = 0; j < 3; ++j)
+          {
+            seed ^= std::hash<int>()(stack(i, j)) + 0x9e3779b9 +
+                    (seed << 6) + (seed >> 2);
+          }
+        }
+        return seed;
+      }
+
+      bool is_terminal(int node)
+      {
+        return node <= Op::kConstant;
+      }
+
+      std::vector<bool> used_rows(const Eigen::Ref<const Eigen::ArrayX3i> &stack)
+      {
+        std::vector<bool> used(stack.rows(), false);
+        used.back() = true;
+        for (int i = stack.rows() - 1; i >= 0; --i)
+        {
+          int node = stack(i, 0);
+          if (!used[i] || is_terminal(node))
+          {
+            continue;
+          }
+          used[stack(i, 1)] = true;
+          if (kIsArity2Map.at(node))
+          {
+            used[stack(i, 2)] = true;
+          }
+        }
+        return used;
+      }
+
+      std::string value(int row)
+      {
+        return "v" + std::to_string(row);
+      }
+
+      std::string adjoint(int row)
+      {
+        return "a" + std::to_string(row);
+      }
+
+      // expression for the forward value of a row, matching operator_eval
+      std::string forward_expression(int node, int param1, int param2)
+      {
+        std::string p1 = value(param1);
+        std::string p2 = value(param2);
+        switch (node)
+        {
+        case Op::kInteger:
+          return std::to_string(param1) + ".0";
+        case Op::kVariable:
+          return "x[i + " + std::to_string(param1) + " * n]";
+        case Op::kConstant:
+          return "c[" + std::to_string(param1) + "]";
+        case Op::kAddition:
+          return p1 + " + " + p2;
+        case Op::kSubtraction:
+          return p1 + " - " + p2;
+        case Op::kMultiplication:
+          return p1 + " * " + p2;
+        case Op::kDivision:
+          return p1 + " / " + p2;
+        case Op::kSin:
+          return "std::sin(" + p1 + ")";
+        case Op::kCos:
+          return "std::cos(" + p1 + ")";
+        case Op::kExponential:
+          return "std::exp(" + p1 + ")";
+        case Op::kLogarithm:
+          return "std::log(std::fabs(" + p1 + "))";
+        case Op::kPower:
+          return "std::pow(" + p1 + ", " + p2 + ")";
+        case Op::kAbs:
+          return "std::fabs(" + p1 + ")";
+        case Op::kSqrt:
+          return "std::sqrt(std::fabs(" + p1 + "))";
+        case Op::kSafePower:
+          return "std::pow(std::fabs(" + p1 + "), " + p2 + ")";
+        case Op::kSinh:
+          return "std::sinh(" + p1 + ")";
+        case Op::kCosh:
+          return "std::cosh(" + p1 + ")";
+        default:
+          throw std::invalid_argument("Unknown operator in JIT compilation");
+        }
+      }
+
+      // statements propagating the adjoint of a row to its operands,
+      // matching the reverse kernels of operator_eval
+      std::string reverse_statements(int row, int node, int param1,
+                                     int param2)
+      {
+        std::string a = adjoint(row);
+        std::string v = value(row);
+        std::string a1 = adjoint(param1);
+        std::string a2 = adjoint(param2);
+        std::string p1 = value(param1);
+        std::string p2 = value(param2);
+        switch (node)
+        {
+        case Op::kAddition:
+          return a1 + " += " + a + "; " + a2 + " += " + a + ";";
+        case Op::kSubtraction:
+          return a1 + " += " + a + "; " + a2 + " -= " + a + ";";
+        case Op::kMultiplication:
+          return a1 + " += " + a + " * " + p2 + "; " +
+                 a2 + " += " + a + " * " + p1 + ";";
+        case Op::kDivision:
+          return a1 + " += " + a + " / " + p2 + "; " +
+                 a2 + " -= " + a + " * " + v + " / " + p2 + ";";
+        case Op::kSin:
+          return a1 + " += " + a + " * std::cos(" + p1 + ");";
+        case Op::kCos:
+          return a1 + " -= " + a + " * std::sin(" + p1 + ");";
+        case Op::kExponential:
+          return a1 + " += " + a + " * " + v + ";";
+        case Op::kLogarithm:
+          return a1 + " += " + a + " / " + p1 + ";";
+        case Op::kPower:
+          return a1 + " += " + a + " * " + v + " * " + p2 + " / " + p1 +
+                 "; " + a2 + " += " + a + " * " + v + " * std::log(" + p1 +
+                 ");";
+        case Op::kAbs:
+          return a1 + " += " + a + " * sign(" + p1 + ");";
+        case Op::kSqrt:
+          return a1 + " += 0.5 * " + a + " / " + v + " * sign(" + p1 + ");";
+        case Op::kSafePower:
+          return a1 + " += " + a + " * " + v + " * " + p2 + " / " + p1 +
+                 "; " + a2 + " += " + a + " * " + v +
+                 " * std::log(std::fabs(" + p1 + "));";
+        case Op::kSinh:
+          return a1 + " += " + a + " * std::cosh(" + p1 + ");";
+        case Op::kCosh:
+          return a1 + " += " + a + " * std::sinh(" + p1 + ");";
+        default:
+          return "";
+        }
+      }
+
+      void write_forward_pass(const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+                              const std::vector<bool> &used,
+                              std::ostringstream &source)
+      {
+        for (int row = 0; row < stack.rows(); ++row)
+        {
+          if (used[row])
+          {
+            source << "    const double " << value(row) << " = "
+                   << forward_expression(stack(row, 0), stack(row, 1),
+                                         stack(row, 2))
+                   << ";\n";
+          }
+        }
+        source << "    f[i] = " << value(stack.rows() - 1) << ";\n";
+      }
+
+      // runs the compiler without a shell, discarding its output
+      bool run_compiler(const std::vector<std::string> &arguments)
+      {
+        if (arguments.empty())
+        {
+          return false;
+        }
+        std::vector<char *> argv;
+        for (const std::string &argument : arguments)
+        {
+          argv.push_back(const_cast<char *>(argument.c_str()));
+        }
+        argv.push_back(nullptr);
+        posix_spawn_file_actions_t actions;
+        if (posix_spawn_file_actions_init(&actions) != 0)
+        {
+          return false;
+        }
+        posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null",
+                                         O_WRONLY, 0);
+        posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO,
+                                         STDERR_FILENO);
+        pid_t pid;
+        int error = posix_spawnp(&pid, argv[0], &actions, nullptr,
+                                 argv.data(), environ);
+        posix_spawn_file_actions_destroy(&actions);
+        if (error != 0)
+        {
+          return false;
+        }
+        int status;
+        while (waitpid(pid, &status, 0) == -1)
+        {
+          if (errno != EINTR)
+          {
+            return false;
+          }
+        }
+        return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+      }
+
+      std::shared_ptr<const JitFunction> build(
+          const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+          std::vector<std::string> compiler)
+      {
+        const char *tmpdir = getenv("TMPDIR");
+        std::string directory =
+            std::string(tmpdir != nullptr ? tmpdir : "/tmp") +
+            "/bingocpp_jit_XXXXXX";
+        if (mkdtemp(&directory[0]) == nullptr)
+        {
+          return nullptr;
+        }
+        std::string source_file = directory + "/equation.cpp";
+        std::string library_file = directory + "/equation.so";
+        try
+        {
+          std::ofstream source(source_file);
+          source << GenerateJitSource(stack);
+        }
+        catch (const std::invalid_argument &)
+        {
+          std::remove(source_file.c_str());
+          rmdir(directory.c_str());
+          return nullptr;
+        }
+        compiler.push_back(source_file);
+        compiler.push_back("-o");
+        compiler.push_back(library_file);
+        void *handle = nullptr;
+        if (run_compiler(compiler))
+        {
+          handle = dlopen(library_file.c_str(), RTLD_NOW | RTLD_LOCAL);
+        }
+        // the loaded library stays mapped after its file is removed
+        std::remove(source_file.c_str());
+        std::remove(library_file.c_str());
+        rmdir(directory.c_str());
+        if (handle == nullptr)
+        {
+          return nullptr;
+        }
+        auto forward = reinterpret_cast<JitFunction::ForwardFunction>(
+            dlsym(handle, "bingo_jit_forward"));
+        auto gradient = reinterpret_cast<JitFunction::GradientFunction>(
+            dlsym(handle, "bingo_jit_gradient"));
+        if (forward == nullptr || gradient == nullptr)
+        {
+          dlclose(handle);
+          return nullptr;
+        }
+        return std::make_shared<const JitFunction>(handle, forward, gradient);
+      }
+    } // namespace
+
+    JitFunction::JitFunction(void *handle, ForwardFunction forward,
+                             GradientFunction gradient)
+        : handle_(handle), forward_(forward), gradient_(gradient) {}
+
+    JitFunction::~JitFunction()
+    {
+      dlclose(handle_);
+    }
+
+    void JitFunction::Evaluate(const Eigen::ArrayXXd &x,
+                               const Eigen::ArrayXXd &constants,
+                               Eigen::ArrayXXd &value) const
+    {
+      value.resize(x.rows(), 1);
+      forward_(x.data(), x.rows(), constants.data(), value.data());
+    }
+
+    void JitFunction::EvaluateWithConstantDerivative(
+        const Eigen::ArrayXXd &x, const Eigen::ArrayXXd &constants,
+        EvalAndDerivative &result) const
+    {
+      result.first.resize(x.rows(), 1);
+      result.second.setZero(x.rows(), constants.size());
+      gradient_(x.data(), x.rows(), constants.data(), result.first.data(),
+                result.second.data());
+    }
+
+    std::string GenerateJitSource(
+        const Eigen::Ref<const Eigen::ArrayX3i> &stack)
+    {
+      std::vector<bool> used = used_rows(stack);
+      std::ostringstream source;
+      source << "#include <cmath>\n\n"
+             << "static inline double sign(double v) {\n"
+             << "  return (0.0 < v) - (v < 0.0);\n"
+             << "}\n\n"
+             << "extern \"C\" void bingo_jit_forward(const double *x, long n,\n"
+             << "                                  const double *c, double *f) {\n"
+             << "  for (long i = 0; i < n; ++i) {\n";
+      write_forward_pass(stack, used, source);
+      source << "  }\n"
+             << "}\n\n"
+             << "extern \"C\" void bingo_jit_gradient(const double *x, long n,\n"
+             << "                                   const double *c, double *f,\n"
+             << "                                   double *df_dc) {\n"
+             << "  for (long i = 0; i < n; ++i) {\n";
+      write_forward_pass(stack, used, source);
+      int last = stack.rows() - 1;
+      for (int row = 0; row < last; ++row)
+      {
+        if (used[row])
+        {
+          source << "    double " << adjoint(row) << " = 0.0;\n";
+        }
+      }
+      source << "    const double " << adjoint(last) << " = 1.0;\n";
+      for (int row = last; row >= 0; --row)
+      {
+        if (!used[row])
+        {
+          continue;
+        }
+        int node = stack(row, 0);
+        if (node == Op::kConstant)
+        {
+          source << "    df_dc[i + " << stack(row, 1) << " * n] += "
+                 << adjoint(row) << ";\n";
+        }
+        else if (!is_terminal(node))
+        {
+          source << "    "
+                 << reverse_statements(row, node, stack(row, 1),
+                                       stack(row, 2))
+                 << "\n";
+        }
+      }
+      source << "  }\n"
+             << "}\n";
+      return source.str();
+    }
+
+    std::shared_ptr<const JitFunction> JitCompile(
+        const Eigen::Ref<const Eigen::ArrayX3i> &stack)
+    {
+      if (stack.rows() == 0)
+      {
+        return nullptr;
+      }
+      std::size_t hash = hash_stack(stack);
+      JitCache &jit_cache = cache();
+      std::promise<std::shared_ptr<const JitFunction>> promise;
+      FutureFunction function;
+      std::vector<std::string> compiler;
+      long id = 0;
+      bool compile = false;
+      {
+        std::lock_guard<std::mutex> lock(jit_cache.mutex);
+        EntryIterator entry = jit_cache.find(stack, hash);
+        if (entry != jit_cache.entries.end())
+        {
+          jit_cache.entries.splice(jit_cache.entries.begin(),
+                                   jit_cache.entries, entry);
+          function = entry->function;
+        }
+        else
+        {
+          // mark the stack as in flight and compile it below
+          function = promise.get_future().share();
+          id = jit_cache.next_id++;
+          jit_cache.entries.push_front(CacheEntry{hash, id, stack, function});
+          jit_cache.index.emplace(hash, jit_cache.entries.begin());
+          jit_cache.evict();
+          compiler = jit_cache.compiler;
+          compile = true;
+        }
+      }
+      if (compile)
+      {
+        try
+        {
+          promise.set_value(build(stack, std::move(compiler)));
+        }
+        catch (...)
+        {
+          // errors other than failed compiles are not cached
+          std::lock_guard<std::mutex> lock(jit_cache.mutex);
+          auto range = jit_cache.index.equal_range(hash);
+          for (auto it = range.first; it != range.second; ++it)
+          {
+            if (it->second->id == id)
+            {
+              jit_cache.erase(it->second);
+              break;
+            }
+          }
+          promise.set_exception(std::current_exception());
+          throw;
+        }
+      }
+      // waits if another thread is compiling the same stack
+      return function.get();
+    }
+
+    void SetJitCompiler(const std::string &command)
+    {
+      std::lock_guard<std::mutex> lock(cache().mutex);
+      cache().compiler = split_arguments(command);
+    }
+
+    void SetJitCacheCapacity(std::size_t capacity)
+    {
+      JitCache &jit_cache = cache();
+      std::lock_guard<std::mutex> lock(jit_cache.mutex);
+      jit_cache.capacity = capacity;
+      jit_cache.evict();
+    }
+
+    std::size_t GetJitCacheCapacity()
+    {
+      JitCache &jit_cache = cache();
+      std::lock_guard<std::mutex> lock(jit_cache.mutex);
+      return jit_cache.capacity;
+    }
+  } // namespace evaluation_backend
+} // namespace bingo
@@ -1,7 +1,10 @@
+#include <algorithm>
 #include <stdexcept>
+#include <type_traits>
 #include <iostream>
 
 #include <bingocpp/agraph/evaluation_backend/operator_eval.h>
+#include <bingocpp/agraph/evaluation_backend/fast_math.h>
 #include <bingocpp/agraph/operator_definitions.h>
 
 namespace bingo
@@ -10,494 +13,1299 @@ namespace bingo
   {
     namespace
     {
-      //reshaping utility
-      std::vector<Eigen::ArrayXXd> do_reshape(Eigen::ArrayXXd &buffer0, Eigen::ArrayXXd &buffer1)
-      {
-        Eigen::ArrayXXd tmp;
-        std::vector<Eigen::ArrayXXd> reshaped_buffers(2);
-        reshaped_buffers[0] = buffer0;
-        reshaped_buffers[1] = buffer1;
-        if (reshaped_buffers[0].rows() == reshaped_buffers[1].rows() 
-            && reshaped_buffers[0].cols() == reshaped_buffers[1].cols()) {
-          return reshaped_buffers;
+      typedef const Eigen::Ref<const Eigen::ArrayXXd> &ConstArrayRef;
+
+      //transcendental functions of the kStrict kernels
+      struct StrictMath
+      {
+        template <typename T>
+        static auto sin(const T &x) { return x.sin(); }
+        template <typename T>
+        static auto cos(const T &x) { return x.cos(); }
+        template <typename T>
+        static auto sinh(const T &x) { return x.sinh(); }
+        template <typename T>
+        static auto cosh(const T &x) { return x.cosh(); }
+        template <typename T1, typename T2>
+        static auto pow(const T1 &x, const T2 &y) { return x.pow(y); }
+      };
+
+      //transcendental functions of the kFast kernels; exp, log and sqrt
+      //are already vectorized by Eigen and shared with StrictMath
+      struct FastMath
+      {
+        template <typename T>
+        static auto sin(const T &x) { return x.unaryExpr(FastSinOp()); }
+        template <typename T>
+        static auto cos(const T &x) { return x.unaryExpr(FastCosOp()); }
+        template <typename T>
+        static auto sinh(const T &x) { return x.unaryExpr(FastSinhOp()); }
+        template <typename T>
+        static auto cosh(const T &x) { return x.unaryExpr(FastCoshOp()); }
+        template <typename T1, typename T2>
+        static auto pow(const T1 &x, const T2 &y)
+        {
+          return x.binaryExpr(y, FastPowOp());
         }
+      };
 
-        if (reshaped_buffers[0].rows() == 1 && reshaped_buffers[1].rows() > 1) {
-          tmp = reshaped_buffers[0].replicate(reshaped_buffers[1].rows(), 1);
-          reshaped_buffers[0] = tmp;
-        } else if (reshaped_buffers[1].rows() == 1 && reshaped_buffers[0].rows() > 1) {
-          tmp = reshaped_buffers[1].replicate(reshaped_buffers[0].rows(), 1);
-          reshaped_buffers[1] = tmp;
-        } 
+      //call function with the column of buffer used for column col of a
+      //result with the given number of rows; single values are broadcast
+      //as constants instead of being replicated
+      template <typename View, typename Function>
+      void with_column(const View &buffer, int col, int rows,
+                       Function function)
+      {
+        typedef Eigen::Array<typename View::Scalar, Eigen::Dynamic, 1> Column;
+        int source_col = buffer.cols() == 1 ? 0 : col;
+        if (buffer.rows() == rows)
+        {
+          function(buffer.col(source_col));
+        }
+        else
+        {
+          function(Column::Constant(rows, buffer(0, source_col)));
+        }
+      }
 
-        if (reshaped_buffers[0].cols() == 1 && reshaped_buffers[1].cols() > 1) {
-          tmp = reshaped_buffers[0].replicate(1, reshaped_buffers[1].cols());
-          reshaped_buffers[0] = tmp;
-        } else if (reshaped_buffers[1].cols() == 1 && reshaped_buffers[0].cols() > 1) {
-          tmp = reshaped_buffers[1].replicate(1, reshaped_buffers[0].cols());
-          reshaped_buffers[1] = tmp;
-        } 
+      //evaluate function(first, second) into the result buffer
+      template <bool kBroadcast, typename Function>
+      typename std::enable_if<!kBroadcast>::type
+      binary_forward(int result, int param1, int param2,
+                          EvaluationWorkspace &workspace, Function function)
+      {
+        const BufferView &first = workspace.forward_eval[param1];
+        const BufferView &second = workspace.forward_eval[param2];
+        workspace.ShapeForwardBuffer(result, first.rows(), first.cols()) =
+            function(first, second);
+      }
 
-        return reshaped_buffers;
+      //the result may share its buffer with an operand it reads for the last
+      //time, so columns are written last to first: a column or a single value
+      //aliased with the result is then only overwritten once it has been read
+      template <bool kBroadcast, typename Function>
+      typename std::enable_if<kBroadcast>::type
+      binary_forward(int result, int param1, int param2,
+                          EvaluationWorkspace &workspace, Function function)
+      {
+        // copies of the views: reshaping the result may reshape an operand
+        const BufferView first = workspace.forward_eval[param1];
+        const BufferView second = workspace.forward_eval[param2];
+        int rows = std::max(first.rows(), second.rows());
+        int cols = std::max(first.cols(), second.cols());
+        BufferView &out = workspace.ShapeForwardBuffer(result, rows, cols);
+        for (int col = cols - 1; col >= 0; --col)
+        {
+          with_column(first, col, rows, [&](const auto &first_col) {
+            with_column(second, col, rows, [&](const auto &second_col) {
+              out.col(col) = function(first_col, second_col);
+            });
+          });
+        }
       }
 
-      Eigen::ArrayXXd broadcast(const Eigen::ArrayXXd &array, int rows, int cols)
+      //call function with a forward value in the shape of the adjoint
+      template <bool kBroadcast, typename Function>
+      typename std::enable_if<!kBroadcast>::type
+      with_operand(const BufferView &buffer, const BufferView &,
+                   Function function)
       {
-          return array.replicate(rows / array.rows(), cols / array.cols());
+        function(buffer);
+      }
+
+      //adjoints have one column per constant set, so columns of values are
+      //repeated across them and rows of values down them
+      template <bool kBroadcast, typename Function>
+      typename std::enable_if<kBroadcast>::type
+      with_operand(const BufferView &buffer, const BufferView &adjoint,
+                   Function function)
+      {
+        if (buffer.rows() == adjoint.rows() && buffer.cols() == adjoint.cols())
+        {
+          function(buffer);
+        }
+        else if (buffer.rows() == adjoint.rows())
+        {
+          function(buffer.replicate(1, adjoint.cols()));
+        }
+        else if (buffer.cols() == adjoint.cols())
+        {
+          function(buffer.replicate(adjoint.rows(), 1));
+        }
+        else
+        {
+          function(Eigen::ArrayXXd::Constant(adjoint.rows(), adjoint.cols(),
+                                             buffer(0, 0)));
+        }
       }
 
+      //shape a result buffer like the given operand
+      BufferView &shape_like(int result, const BufferView &operand,
+                             EvaluationWorkspace &workspace)
+      {
+        return workspace.ShapeForwardBuffer(result, operand.rows(),
+                                            operand.cols());
+      }
 
       // Integer
-      Eigen::ArrayXXd integer_forward_eval(int param1, int,
-                                           const Eigen::ArrayXXd &x,
-                                           const Eigen::ArrayXXd &,
-                                           std::vector<Eigen::ArrayXXd> &)
+      void integer_forward_eval(int result, int param1, int,
+                                ConstArrayRef,
+                                ConstArrayRef,
+                                EvaluationWorkspace &workspace)
       {
-        return Eigen::ArrayXXd::Constant(1, 1, param1);
+        workspace.ShapeForwardBuffer(result, 1, 1).setConstant(param1);
       }
 
-      void integer_reverse_eval(int, int, int,
-                                const std::vector<Eigen::ArrayXXd> &,
-                                std::vector<Eigen::ArrayXXd> &)
+      void integer_reverse_eval(const RowBuffers &, const RowBuffers &,
+                                EvaluationWorkspace &)
       {
         return;
       }
 
       // Load x
-      Eigen::ArrayXXd loadx_forward_eval(int param1, int,
-                                         const Eigen::ArrayXXd &x,
-                                         const Eigen::ArrayXXd &constants,
-                                         std::vector<Eigen::ArrayXXd> &)
+      void loadx_forward_eval(int result, int param1, int,
+                              ConstArrayRef x,
+                              ConstArrayRef,
+                              EvaluationWorkspace &workspace)
       {
-        return x.col(param1);
-        // int num_cols = (constants.cols() == 0) ? 1 : constants.cols();
-        // return x.col(param1).replicate(1, num_cols);
+        workspace.ShapeForwardBuffer(result, x.rows(), 1) = x.col(param1);
       }
 
-      void loadx_reverse_eval(int, int, int,
-                              const std::vector<Eigen::ArrayXXd> &,
-                              std::vector<Eigen::ArrayXXd> &)
+      void loadx_reverse_eval(const RowBuffers &, const RowBuffers &,
+                              EvaluationWorkspace &)
       {
         return;
       }
 
       // Load c
-      Eigen::ArrayXXd loadc_forward_eval(int param1, int,
-                                         const Eigen::ArrayXXd &x,
-                                         const Eigen::ArrayXXd &constants,
-                                         std::vector<Eigen::ArrayXXd> &)
+      void loadc_forward_eval(int result, int param1, int,
+                              ConstArrayRef,
+                              ConstArrayRef constants,
+                              EvaluationWorkspace &workspace)
       {
-        // return Eigen::ArrayXXd::Constant(x.rows(), constants.columns(), constants(param1, 0));
-        // return constants.row(param1).replicate(x.rows(), 1);
-        return constants.row(param1);
+        workspace.ShapeForwardBuffer(result, 1, constants.cols()) =
+            constants.row(param1);
       }
 
-      void loadc_reverse_eval(int, int, int,
-                              const std::vector<Eigen::ArrayXXd> &,
-                              std::vector<Eigen::ArrayXXd> &)
+      void loadc_reverse_eval(const RowBuffers &, const RowBuffers &,
+                              EvaluationWorkspace &)
       {
         return;
       }
 
       // Addition
-      Eigen::ArrayXXd add_forward_eval(int param1, int param2,
-                                       const Eigen::ArrayXXd &,
-                                       const Eigen::ArrayXXd &,
-                                       std::vector<Eigen::ArrayXXd> &forward_eval)
+      template <bool kBroadcast>
+      void add_forward_eval(int result, int param1, int param2,
+                            ConstArrayRef,
+                            ConstArrayRef,
+                            EvaluationWorkspace &workspace)
       {
-        std::vector<Eigen::ArrayXXd> reshaped_buffers = do_reshape(forward_eval[param1], forward_eval[param2]);
-        return reshaped_buffers[0] + reshaped_buffers[1];
+        binary_forward<kBroadcast>(
+            result, param1, param2, workspace,
+            [](const auto &first, const auto &second) {
+              return first + second;
+            });
       }
 
-      void add_reverse_eval(int reverse_index, int param1, int param2,
-                            const std::vector<Eigen::ArrayXXd> &,
-                            std::vector<Eigen::ArrayXXd> &reverse_eval)
+      void add_reverse_eval(const RowBuffers &,
+                            const RowBuffers &reverse,
+                            EvaluationWorkspace &workspace)
       {
-        reverse_eval[param1] += reverse_eval[reverse_index];
-        reverse_eval[param2] += reverse_eval[reverse_index];
+        const BufferView &adjoint = workspace.reverse_eval[reverse.result];
+        workspace.reverse_eval[reverse.param1] += adjoint;
+        workspace.reverse_eval[reverse.param2] += adjoint;
       }
 
       // Subtraction
-      Eigen::ArrayXXd subtract_forward_eval(int param1, int param2,
-                                            const Eigen::ArrayXXd &,
-                                            const Eigen::ArrayXXd &,
-                                            std::vector<Eigen::ArrayXXd> &forward_eval)
+      template <bool kBroadcast>
+      void subtract_forward_eval(int result, int param1, int param2,
+                                 ConstArrayRef,
+                                 ConstArrayRef,
+                                 EvaluationWorkspace &workspace)
       {
-        std::vector<Eigen::ArrayXXd> reshaped_buffers = do_reshape(forward_eval[param1], forward_eval[param2]);
-        return reshaped_buffers[0] - reshaped_buffers[1];
+        binary_forward<kBroadcast>(
+            result, param1, param2, workspace,
+            [](const auto &first, const auto &second) {
+              return first - second;
+            });
       }
 
-      void subtract_reverse_eval(int reverse_index, int param1, int param2,
-                                 const std::vector<Eigen::ArrayXXd> &,
-                                 std::vector<Eigen::ArrayXXd> &reverse_eval)
+      void subtract_reverse_eval(const RowBuffers &,
+                                 const RowBuffers &reverse,
+                                 EvaluationWorkspace &workspace)
       {
-        reverse_eval[param1] += reverse_eval[reverse_index];
-        reverse_eval[param2] -= reverse_eval[reverse_index];
+        const BufferView &adjoint = workspace.reverse_eval[reverse.result];
+        workspace.reverse_eval[reverse.param1] += adjoint;
+        workspace.reverse_eval[reverse.param2] -= adjoint;
       }
 
       // Multiplication
-      Eigen::ArrayXXd multiply_forward_eval(int param1, int param2,
-                                            const Eigen::ArrayXXd &,
-                                            const Eigen::ArrayXXd &,
-                                            std::vector<Eigen::ArrayXXd> &forward_eval)
+      template <bool kBroadcast>
+      void multiply_forward_eval(int result, int param1, int param2,
+                                 ConstArrayRef,
+                                 ConstArrayRef,
+                                 EvaluationWorkspace &workspace)
       {
-        std::vector<Eigen::ArrayXXd> reshaped_buffers = do_reshape(forward_eval[param1], forward_eval[param2]);
-        return reshaped_buffers[0] * reshaped_buffers[1];
+        binary_forward<kBroadcast>(
+            result, param1, param2, workspace,
+            [](const auto &first, const auto &second) {
+              return first * second;
+            });
       }
 
-      void multiply_reverse_eval(int reverse_index, int param1, int param2,
-                                 const std::vector<Eigen::ArrayXXd> &forward_eval,
-                                 std::vector<Eigen::ArrayXXd> &reverse_eval)
+      template <bool kBroadcast>
+      void multiply_reverse_eval(const RowBuffers &forward,
+                                 const RowBuffers &reverse,
+                                 EvaluationWorkspace &workspace)
       {
-        Eigen::ArrayXXd fe1 = broadcast(forward_eval[param1], 
-                                        reverse_eval[reverse_index].rows(),
-                                        reverse_eval[reverse_index].cols());
-        Eigen::ArrayXXd fe2 = broadcast(forward_eval[param2], 
-                                        reverse_eval[reverse_index].rows(),
-                                        reverse_eval[reverse_index].cols());
-        reverse_eval[param1] += reverse_eval[reverse_index] * fe2;
-        reverse_eval[param2] += reverse_eval[reverse_index] * fe1;
+        const BufferView &adjoint = workspace.reverse_eval[reverse.result];
+        with_operand<kBroadcast>(
+            workspace.forward_eval[forward.param1], adjoint,
+            [&](const auto &fe1) {
+              with_operand<kBroadcast>(
+                  workspace.forward_eval[forward.param2], adjoint,
+                  [&](const auto &fe2) {
+                    workspace.reverse_eval[reverse.param1] += adjoint * fe2;
+                    workspace.reverse_eval[reverse.param2] += adjoint * fe1;
+                  });
+            });
       }
 
       // Division
-      Eigen::ArrayXXd divide_forward_eval(int param1, int param2,
-                                          const Eigen::ArrayXXd &,
-                                          const Eigen::ArrayXXd &,
-                                          std::vector<Eigen::ArrayXXd> &forward_eval)
+      template <bool kBroadcast>
+      void divide_forward_eval(int result, int param1, int param2,
+                               ConstArrayRef,
+                               ConstArrayRef,
+                               EvaluationWorkspace &workspace)
       {
-        std::vector<Eigen::ArrayXXd> reshaped_buffers = do_reshape(forward_eval[param1], forward_eval[param2]);
-        return reshaped_buffers[0] / reshaped_buffers[1];
+        binary_forward<kBroadcast>(
+            result, param1, param2, workspace,
+            [](const auto &first, const auto &second) {
+              return first / second;
+            });
       }
 
-      void divide_reverse_eval(int reverse_index, int param1, int param2,
-                               const std::vector<Eigen::ArrayXXd> &forward_eval,
-                               std::vector<Eigen::ArrayXXd> &reverse_eval)
+      template <bool kBroadcast>
+      void divide_reverse_eval(const RowBuffers &forward,
+                               const RowBuffers &reverse,
+                               EvaluationWorkspace &workspace)
       {
-        Eigen::ArrayXXd fe2 = broadcast(forward_eval[param2], 
-                                        reverse_eval[reverse_index].rows(),
-                                        reverse_eval[reverse_index].cols());
-        Eigen::ArrayXXd fer = broadcast(forward_eval[reverse_index], 
-                                        reverse_eval[reverse_index].rows(),
-                                        reverse_eval[reverse_index].cols());
-        reverse_eval[param1] += reverse_eval[reverse_index] / fe2;
-        reverse_eval[param2] -= reverse_eval[reverse_index] * fer / fe2;
+        const BufferView &adjoint = workspace.reverse_eval[reverse.result];
+        with_operand<kBroadcast>(
+            workspace.forward_eval[forward.param2], adjoint,
+            [&](const auto &fe2) {
+              with_operand<kBroadcast>(
+                  workspace.forward_eval[forward.result], adjoint,
+                  [&](const auto &fer) {
+                    workspace.reverse_eval[reverse.param1] += adjoint / fe2;
+                    workspace.reverse_eval[reverse.param2] -=
+                        adjoint * fer / fe2;
+                  });
+            });
       }
 
       // Sine
-      Eigen::ArrayXXd sin_forward_eval(int param1, int,
-                                       const Eigen::ArrayXXd &,
-                                       const Eigen::ArrayXXd &,
-                                       std::vector<Eigen::ArrayXXd> &forward_eval)
+      template <typename Math>
+      void sin_forward_eval(int result, int param1, int,
+                            ConstArrayRef,
+                            ConstArrayRef,
+                            EvaluationWorkspace &workspace)
       {
-        return forward_eval.at(param1).sin();
+        const BufferView &operand = workspace.forward_eval[param1];
+        shape_like(result, operand, workspace) = Math::sin(operand);
       }
 
-      void sin_reverse_eval(int reverse_index, int param1, int,
-                            const std::vector<Eigen::ArrayXXd> &forward_eval,
-                            std::vector<Eigen::ArrayXXd> &reverse_eval)
+      template <bool kBroadcast, typename Math>
+      void sin_reverse_eval(const RowBuffers &forward,
+                            const RowBuffers &reverse,
+                            EvaluationWorkspace &workspace)
       {
-        Eigen::ArrayXXd fe1 = broadcast(forward_eval[param1], 
-                                        reverse_eval[reverse_index].rows(),
-                                        reverse_eval[reverse_index].cols());
-        reverse_eval[param1] += reverse_eval[reverse_index] * fe1.cos();
+        const BufferView &adjoint = workspace.reverse_eval[reverse.result];
+        with_operand<kBroadcast>(
+            workspace.forward_eval[forward.param1], adjoint,
+            [&](const auto &fe1) {
+              workspace.reverse_eval[reverse.param1] += adjoint * Math::cos(fe1);
+            });
       }
 
       // Cosine
-      Eigen::ArrayXXd cos_forward_eval(int param1, int,
-                                       const Eigen::ArrayXXd &,
-                                       const Eigen::ArrayXXd &,
-                                       std::vector<Eigen::ArrayXXd> &forward_eval)
+      template <typename Math>
+      void cos_forward_eval(int result, int param1, int,
+                            ConstArrayRef,
+                            ConstArrayRef,
+                            EvaluationWorkspace &workspace)
       {
-        return forward_eval[param1].cos();
+        const BufferView &operand = workspace.forward_eval[param1];
+        shape_like(result, operand, workspace) = Math::cos(operand);
       }
 
-      void cos_reverse_eval(int reverse_index, int param1, int,
-                            const std::vector<Eigen::ArrayXXd> &forward_eval,
-                            std::vector<Eigen::ArrayXXd> &reverse_eval)
+      template <bool kBroadcast, typename Math>
+      void cos_reverse_eval(const RowBuffers &forward,
+                            const RowBuffers &reverse,
+                            EvaluationWorkspace &workspace)
       {
-        Eigen::ArrayXXd fe1 = broadcast(forward_eval[param1], 
-                                        reverse_eval[reverse_index].rows(),
-                                        reverse_eval[reverse_index].cols());
-        reverse_eval[param1] -= reverse_eval[reverse_index] * fe1.sin();
+        const BufferView &adjoint = workspace.reverse_eval[reverse.result];
+        with_operand<kBroadcast>(
+            workspace.forward_eval[forward.param1], adjoint,
+            [&](const auto &fe1) {
+              workspace.reverse_eval[reverse.param1] -= adjoint * Math::sin(fe1);
+            });
       }
 
       // Exponential
-      Eigen::ArrayXXd exp_forward_eval(int param1, int,
-                                       const Eigen::ArrayXXd &,
-                                       const Eigen::ArrayXXd &,
-                                       std::vector<Eigen::ArrayXXd> &forward_eval)
+      void exp_forward_eval(int result, int param1, int,
+                            ConstArrayRef,
+                            ConstArrayRef,
+                            EvaluationWorkspace &workspace)
       {
-        return forward_eval[param1].exp();
+        const BufferView &operand = workspace.forward_eval[param1];
+        shape_like(result, operand, workspace) = operand.exp();
       }
 
-      void exp_reverse_eval(int reverse_index, int param1, int,
-                            const std::vector<Eigen::ArrayXXd> &forward_eval,
-                            std::vector<Eigen::ArrayXXd> &reverse_eval)
+      template <bool kBroadcast>
+      void exp_reverse_eval(const RowBuffers &forward,
+                            const RowBuffers &reverse,
+                            EvaluationWorkspace &workspace)
       {
-        Eigen::ArrayXXd fer = broadcast(forward_eval[reverse_index], 
-                                        reverse_eval[reverse_index].rows(),
-                                        reverse_eval[reverse_index].cols());
-        reverse_eval[param1] += reverse_eval[reverse_index] * fer;
+        const BufferView &adjoint = workspace.reverse_eval[reverse.result];
+        with_operand<kBroadcast>(
+            workspace.forward_eval[forward.result], adjoint,
+            [&](const auto &fer) {
+              workspace.reverse_eval[reverse.param1] += adjoint * fer;
+            });
       }
 
       // Logarithm
-      Eigen::ArrayXXd log_forward_eval(int param1, int,
-                                       const Eigen::ArrayXXd &,
-                                       const Eigen::ArrayXXd &,
-                                       std::vector<Eigen::ArrayXXd> &forward_eval)
+      void log_forward_eval(int result, int param1, int,
+                            ConstArrayRef,
+                            ConstArrayRef,
+                            EvaluationWorkspace &workspace)
       {
-        return forward_eval[param1].abs().log();
+        const BufferView &operand = workspace.forward_eval[param1];
+        shape_like(result, operand, workspace) = operand.abs().log();
       }
 
-      void log_reverse_eval(int reverse_index, int param1, int,
-                            const std::vector<Eigen::ArrayXXd> &forward_eval,
-                            std::vector<Eigen::ArrayXXd> &reverse_eval)
+      template <bool kBroadcast>
+      void log_reverse_eval(const RowBuffers &forward,
+                            const RowBuffers &reverse,
+                            EvaluationWorkspace &workspace)
       {
-        Eigen::ArrayXXd fe1 = broadcast(forward_eval[param1], 
-                                        reverse_eval[reverse_index].rows(),
-                                        reverse_eval[reverse_index].cols());
-        reverse_eval[param1] += reverse_eval[reverse_index] / fe1;
+        const BufferView &adjoint = workspace.reverse_eval[reverse.result];
+        with_operand<kBroadcast>(
+            workspace.forward_eval[forward.param1], adjoint,
+            [&](const auto &fe1) {
+              workspace.reverse_eval[reverse.param1] += adjoint / fe1;
+            });
       }
 
       // Power
-      Eigen::ArrayXXd pow_forward_eval(int param1, int param2,
-                                       const Eigen::ArrayXXd &,
-                                       const Eigen::ArrayXXd &,
-                                       std::vector<Eigen::ArrayXXd> &forward_eval)
+      template <bool kBroadcast, typename Math>
+      void pow_forward_eval(int result, int param1, int param2,
+                            ConstArrayRef,
+                            ConstArrayRef,
+                            EvaluationWorkspace &workspace)
       {
-        std::vector<Eigen::ArrayXXd> reshaped_buffers = do_reshape(forward_eval[param1], forward_eval[param2]);
-        return reshaped_buffers[0].pow(reshaped_buffers[1]);
+        binary_forward<kBroadcast>(
+            result, param1, param2, workspace,
+            [](const auto &first, const auto &second) {
+              return Math::pow(first, second);
+            });
       }
 
-      void pow_reverse_eval(int reverse_index, int param1, int param2,
-                            const std::vector<Eigen::ArrayXXd> &forward_eval,
-                            std::vector<Eigen::ArrayXXd> &reverse_eval)
+      template <bool kBroadcast>
+      void pow_reverse_eval(const RowBuffers &forward,
+                            const RowBuffers &reverse,
+                            EvaluationWorkspace &workspace)
       {
-        Eigen::ArrayXXd fe1 = broadcast(forward_eval[param1], 
-                                        reverse_eval[reverse_index].rows(),
-                                        reverse_eval[reverse_index].cols());
-        Eigen::ArrayXXd fe2 = broadcast(forward_eval[param2], 
-                                        reverse_eval[reverse_index].rows(),
-                                        reverse_eval[reverse_index].cols());
-        Eigen::ArrayXXd fer = broadcast(forward_eval[reverse_index], 
-                                        reverse_eval[reverse_index].rows(),
-                                        reverse_eval[reverse_index].cols());
-        reverse_eval[param1] += reverse_eval[reverse_index] * fer * fe2 / fe1;
-        reverse_eval[param2] += reverse_eval[reverse_index] * fer * (fe1.log());
+        const BufferView &adjoint = workspace.reverse_eval[reverse.result];
+        with_operand<kBroadcast>(
+            workspace.forward_eval[forward.param1], adjoint,
+            [&](const auto &fe1) {
+              with_operand<kBroadcast>(
+                  workspace.forward_eval[forward.param2], adjoint,
+                  [&](const auto &fe2) {
+                    with_operand<kBroadcast>(
+                        workspace.forward_eval[forward.result], adjoint,
+                        [&](const auto &fer) {
+                          workspace.reverse_eval[reverse.param1] +=
+                              adjoint * fer * fe2 / fe1;
+                          workspace.reverse_eval[reverse.param2] +=
+                              adjoint * fer * (fe1.log());
+                        });
+                  });
+            });
       }
 
       // Safe Power
-      Eigen::ArrayXXd safepow_forward_eval(int param1, int param2,
-                                           const Eigen::ArrayXXd &,
-                                           const Eigen::ArrayXXd &,
-                                           std::vector<Eigen::ArrayXXd> &forward_eval)
+      template <bool kBroadcast, typename Math>
+      void safepow_forward_eval(int result, int param1, int param2,
+                                ConstArrayRef,
+                                ConstArrayRef,
+                                EvaluationWorkspace &workspace)
       {
-        std::vector<Eigen::ArrayXXd> reshaped_buffers = do_reshape(forward_eval[param1], forward_eval[param2]);
-        return reshaped_buffers[0].abs().pow(reshaped_buffers[1]);
+        binary_forward<kBroadcast>(
+            result, param1, param2, workspace,
+            [](const auto &first, const auto &second) {
+              return Math::pow(first.abs(), second);
+            });
       }
 
-      void safepow_reverse_eval(int reverse_index, int param1, int param2,
-                                const std::vector<Eigen::ArrayXXd> &forward_eval,
-                                std::vector<Eigen::ArrayXXd> &reverse_eval)
+      template <bool kBroadcast>
+      void safepow_reverse_eval(const RowBuffers &forward,
+                                const RowBuffers &reverse,
+                                EvaluationWorkspace &workspace)
       {
-        Eigen::ArrayXXd fe1 = broadcast(forward_eval[param1], 
-                                        reverse_eval[reverse_index].rows(),
-                                        reverse_eval[reverse_index].cols());
-        Eigen::ArrayXXd fe2 = broadcast(forward_eval[param2], 
-                                        reverse_eval[reverse_index].rows(),
-                                        reverse_eval[reverse_index].cols());
-        Eigen::ArrayXXd fer = broadcast(forward_eval[reverse_index], 
-                                        reverse_eval[reverse_index].rows(),
-                                        reverse_eval[reverse_index].cols());
-        reverse_eval[param1] += reverse_eval[reverse_index] * fer * fe2 / fe1;
-        reverse_eval[param2] += reverse_eval[reverse_index] * fer * (fe1.abs().log());
+        const BufferView &adjoint = workspace.reverse_eval[reverse.result];
+        with_operand<kBroadcast>(
+            workspace.forward_eval[forward.param1], adjoint,
+            [&](const auto &fe1) {
+              with_operand<kBroadcast>(
+                  workspace.forward_eval[forward.param2], adjoint,
+                  [&](const auto &fe2) {
+                    with_operand<kBroadcast>(
+                        workspace.forward_eval[forward.result], adjoint,
+                        [&](const auto &fer) {
+                          workspace.reverse_eval[reverse.param1] +=
+                              adjoint * fer * fe2 / fe1;
+                          workspace.reverse_eval[reverse.param2] +=
+                              adjoint * fer * (fe1.abs().log());
+                        });
+                  });
+            });
       }
 
       // Absolute Value
-      Eigen::ArrayXXd abs_forward_eval(int param1, int,
-                                       const Eigen::ArrayXXd &,
-                                       const Eigen::ArrayXXd &,
-                                       std::vector<Eigen::ArrayXXd> &forward_eval)
+      void abs_forward_eval(int result, int param1, int,
+                            ConstArrayRef,
+                            ConstArrayRef,
+                            EvaluationWorkspace &workspace)
       {
-        return forward_eval[param1].abs();
+        const BufferView &operand = workspace.forward_eval[param1];
+        shape_like(result, operand, workspace) = operand.abs();
       }
 
-      void abs_reverse_eval(int reverse_index, int param1, int,
-                            const std::vector<Eigen::ArrayXXd> &forward_eval,
-                            std::vector<Eigen::ArrayXXd> &reverse_eval)
+      template <bool kBroadcast>
+      void abs_reverse_eval(const RowBuffers &forward,
+                            const RowBuffers &reverse,
+                            EvaluationWorkspace &workspace)
       {
-        Eigen::ArrayXXd fe1 = broadcast(forward_eval[param1], 
-                                        reverse_eval[reverse_index].rows(),
-                                        reverse_eval[reverse_index].cols());
-        reverse_eval[param1] += reverse_eval[reverse_index] * fe1.sign();
+        const BufferView &adjoint = workspace.reverse_eval[reverse.result];
+        with_operand<kBroadcast>(
+            workspace.forward_eval[forward.param1], adjoint,
+            [&](const auto &fe1) {
+              workspace.reverse_eval[reverse.param1] += adjoint * fe1.sign();
+            });
       }
 
       // Sqruare root
-      Eigen::ArrayXXd sqrt_forward_eval(int param1, int,
-                                        const Eigen::ArrayXXd &,
-                                        const Eigen::ArrayXXd &,
-                                        std::vector<Eigen::ArrayXXd> &forward_eval)
+      void sqrt_forward_eval(int result, int param1, int,
+                             ConstArrayRef,
+                             ConstArrayRef,
+                             EvaluationWorkspace &workspace)
       {
-        return forward_eval[param1].abs().sqrt();
+        const BufferView &operand = workspace.forward_eval[param1];
+        shape_like(result, operand, workspace) = operand.abs().sqrt();
       }
 
-      void sqrt_reverse_eval(int reverse_index, int param1, int,
-                             const std::vector<Eigen::ArrayXXd> &forward_eval,
-                             std::vector<Eigen::ArrayXXd> &reverse_eval)
+      template <bool kBroadcast>
+      void sqrt_reverse_eval(const RowBuffers &forward,
+                             const RowBuffers &reverse,
+                             EvaluationWorkspace &workspace)
       {
-        Eigen::ArrayXXd fe1 = broadcast(forward_eval[param1], 
-                                        reverse_eval[reverse_index].rows(),
-                                        reverse_eval[reverse_index].cols());
-        Eigen::ArrayXXd fer = broadcast(forward_eval[reverse_index], 
-                                        reverse_eval[reverse_index].rows(),
-                                        reverse_eval[reverse_index].cols());
-        reverse_eval[param1] += 0.5 * reverse_eval[reverse_index] / fer * fe1.sign();
+        const BufferView &adjoint = workspace.reverse_eval[reverse.result];
+        with_operand<kBroadcast>(
+            workspace.forward_eval[forward.param1], adjoint,
+            [&](const auto &fe1) {
+              with_operand<kBroadcast>(
+                  workspace.forward_eval[forward.result], adjoint,
+                  [&](const auto &fer) {
+                    workspace.reverse_eval[reverse.param1] +=
+                        0.5 * adjoint / fer * fe1.sign();
+                  });
+            });
       }
 
       // Sinh
-      Eigen::ArrayXXd sinh_forward_eval(int param1, int,
-                                        const Eigen::ArrayXXd &,
-                                        const Eigen::ArrayXXd &,
-                                        std::vector<Eigen::ArrayXXd> &forward_eval)
+      template <typename Math>
+      void sinh_forward_eval(int result, int param1, int,
+                             ConstArrayRef,
+                             ConstArrayRef,
+                             EvaluationWorkspace &workspace)
       {
-        return forward_eval.at(param1).sinh();
+        const BufferView &operand = workspace.forward_eval[param1];
+        shape_like(result, operand, workspace) = Math::sinh(operand);
       }
 
-      void sinh_reverse_eval(int reverse_index, int param1, int,
-                             const std::vector<Eigen::ArrayXXd> &forward_eval,
-                             std::vector<Eigen::ArrayXXd> &reverse_eval)
+      template <bool kBroadcast, typename Math>
+      void sinh_reverse_eval(const RowBuffers &forward,
+                             const RowBuffers &reverse,
+                             EvaluationWorkspace &workspace)
       {
-        Eigen::ArrayXXd fe1 = broadcast(forward_eval[param1], 
-                                        reverse_eval[reverse_index].rows(),
-                                        reverse_eval[reverse_index].cols());
-        reverse_eval[param1] += reverse_eval[reverse_index] * fe1.cosh();
+        const BufferView &adjoint = workspace.reverse_eval[reverse.result];
+        with_operand<kBroadcast>(
+            workspace.forward_eval[forward.param1], adjoint,
+            [&](const auto &fe1) {
+              workspace.reverse_eval[reverse.param1] += adjoint * Math::cosh(fe1);
+            });
       }
 
       // Cosh
-      Eigen::ArrayXXd cosh_forward_eval(int param1, int,
-                                        const Eigen::ArrayXXd &,
-                                        const Eigen::ArrayXXd &,
-                                        std::vector<Eigen::ArrayXXd> &forward_eval)
+      template <typename Math>
+      void cosh_forward_eval(int result, int param1, int,
+                             ConstArrayRef,
+                             ConstArrayRef,
+                             EvaluationWorkspace &workspace)
       {
-        return forward_eval[param1].cosh();
+        const BufferView &operand = workspace.forward_eval[param1];
+        shape_like(result, operand, workspace) = Math::cosh(operand);
       }
 
-      void cosh_reverse_eval(int reverse_index, int param1, int,
-                             const std::vector<Eigen::ArrayXXd> &forward_eval,
-                             std::vector<Eigen::ArrayXXd> &reverse_eval)
+      template <bool kBroadcast, typename Math>
+      void cosh_reverse_eval(const RowBuffers &forward,
+                             const RowBuffers &reverse,
+                             EvaluationWorkspace &workspace)
       {
-        Eigen::ArrayXXd fe1 = broadcast(forward_eval[param1], 
-                                        reverse_eval[reverse_index].rows(),
-                                        reverse_eval[reverse_index].cols());
-        reverse_eval[param1] += reverse_eval[reverse_index] * fe1.sinh();
+        const BufferView &adjoint = workspace.reverse_eval[reverse.result];
+        with_operand<kBroadcast>(
+            workspace.forward_eval[forward.param1], adjoint,
+            [&](const auto &fe1) {
+              workspace.reverse_eval[reverse.param1] += adjoint * Math::sinh(fe1);
+            });
+      }
+
+      // Fused chains
+
+      //samples per block of a fused chain; small enough for the running
+      //values to stay in L1, large enough to amortize dispatching each step
+      constexpr int kFusedBlockSize = 128;
+
+      typedef Eigen::Array<double, Eigen::Dynamic, 1, Eigen::ColMajor,
+                           kFusedBlockSize, 1> FusedBlock;
+
+      //call function with rows [start, start + size) of column col of an
+      //operand, broadcast values are passed as constants
+      template <typename Function>
+      void with_fused_operand(const FusedOperand &operand, int col,
+                              int start, int size, double saved,
+                              ConstArrayRef x, ConstArrayRef constants,
+                              const EvaluationWorkspace &workspace,
+                              Function function)
+      {
+        typedef Eigen::Map<const Eigen::ArrayXd> Segment;
+        switch (operand.source)
+        {
+        case kFromX:
+          function(Segment(x.col(operand.index).data() + start, size));
+          return;
+        case kFromConstants:
+          function(Eigen::ArrayXd::Constant(
+              size, constants(operand.index, col)));
+          return;
+        case kFromInteger:
+          function(Eigen::ArrayXd::Constant(
+              size, static_cast<double>(operand.index)));
+          return;
+        case kFromSaved:
+          function(Eigen::ArrayXd::Constant(size, saved));
+          return;
+        case kFromBuffer:
+          break;
+        }
+        const BufferView &buffer = workspace.forward_eval[operand.index];
+        const double *data = buffer.data();
+        switch (operand.shape)
+        {
+        case kScalar:
+          function(Eigen::ArrayXd::Constant(size, data[0]));
+          break;
+        case kRow:
+          function(Eigen::ArrayXd::Constant(size, data[col]));
+          break;
+        case kColumn:
+          function(Segment(data + start, size));
+          break;
+        case kMatrix:
+          function(Segment(data + col * x.rows() + start, size));
+          break;
+        }
+      }
+
+      template <typename Math>
+      void unary_step(int node, FusedBlock &value)
+      {
+        switch (node)
+        {
+        case Op::kSin:
+          value = Math::sin(value);
+          break;
+        case Op::kCos:
+          value = Math::cos(value);
+          break;
+        case Op::kExponential:
+          value = value.exp();
+          break;
+        case Op::kLogarithm:
+          value = value.abs().log();
+          break;
+        case Op::kAbs:
+          value = value.abs();
+          break;
+        case Op::kSqrt:
+          value = value.abs().sqrt();
+          break;
+        case Op::kSinh:
+          value = Math::sinh(value);
+          break;
+        case Op::kCosh:
+          value = Math::cosh(value);
+          break;
+        }
+      }
+
+      template <typename Math, typename Operand>
+      void binary_step(int node, bool chain_is_param1, FusedBlock &value,
+                       const Operand &operand)
+      {
+        switch (node)
+        {
+        case Op::kAddition:
+          value += operand;
+          break;
+        case Op::kSubtraction:
+          if (chain_is_param1)
+          {
+            value -= operand;
+          }
+          else
+          {
+            value = operand - value;
+          }
+          break;
+        case Op::kMultiplication:
+          value *= operand;
+          break;
+        case Op::kDivision:
+          if (chain_is_param1)
+          {
+            value /= operand;
+          }
+          else
+          {
+            value = operand / value;
+          }
+          break;
+        case Op::kPower:
+          if (chain_is_param1)
+          {
+            value = Math::pow(value, operand);
+          }
+          else
+          {
+            value = Math::pow(operand, value);
+          }
+          break;
+        case Op::kSafePower:
+          if (chain_is_param1)
+          {
+            value = Math::pow(value.abs(), operand);
+          }
+          else
+          {
+            value = Math::pow(operand.abs(), value);
+          }
+          break;
+        }
+      }
+
+      //the result may share its buffer with an operand, so columns are
+      //written last to first like the broadcasting kernels, and each block
+      //reads all of its operands before it is written
+      template <typename Math>
+      void fused_forward_eval(const FusedChain &chain, int result,
+                              ShapeClass shape, ConstArrayRef x,
+                              ConstArrayRef constants,
+                              EvaluationWorkspace &workspace)
+      {
+        int rows = x.rows();
+        int cols = (shape & kRow) ? constants.cols() : 1;
+        BufferView &out = workspace.ShapeForwardBuffer(result, rows, cols);
+        FusedBlock value;
+        for (int col = cols - 1; col >= 0; --col)
+        {
+          double saved = out.data()[chain.saved_shape == kRow ? col : 0];
+          for (int start = 0; start < rows; start += kFusedBlockSize)
+          {
+            int size = std::min(kFusedBlockSize, rows - start);
+            with_fused_operand(chain.first, col, start, size, saved, x,
+                               constants, workspace,
+                               [&](const auto &first) { value = first; });
+            for (const FusedStep &step : chain.steps)
+            {
+              if (!step.arity_2)
+              {
+                unary_step<Math>(step.node, value);
+                continue;
+              }
+              with_fused_operand(
+                  step.operand, col, start, size, saved, x, constants,
+                  workspace, [&](const auto &operand) {
+                    binary_step<Math>(step.node, step.chain_is_param1, value,
+                                      operand);
+                  });
+            }
+            out.col(col).segment(start, size) = value;
+          }
+        }
+      }
+
+      // Forward mode
+
+      bool is_arity_2(int node)
+      {
+        switch (node)
+        {
+        case Op::kAddition:
+        case Op::kSubtraction:
+        case Op::kMultiplication:
+        case Op::kDivision:
+        case Op::kPower:
+        case Op::kSafePower:
+          return true;
+        }
+        return false;
+      }
+
+      //add the tangent t of one operand times the partial derivative of
+      //node with respect to that operand to the tangent of the row; the
+      //partial derivatives are the ones of the reverse kernels
+      template <typename Math>
+      void add_tangent(int node, bool first_operand,
+                       const BufferView &value1, const BufferView &value2,
+                       const BufferView &result, const BufferView &t,
+                       BufferView &tangent)
+      {
+        switch (node)
+        {
+        case Op::kAddition:
+          tangent += t;
+          return;
+        case Op::kSubtraction:
+          if (first_operand)
+          {
+            tangent += t;
+          }
+          else
+          {
+            tangent -= t;
+          }
+          return;
+        case Op::kMultiplication:
+          with_operand<true>(first_operand ? value2 : value1, tangent,
+                             [&](const auto &other) {
+                               tangent += t * other;
+                             });
+          return;
+        case Op::kDivision:
+          with_operand<true>(value2, tangent, [&](const auto &fe2) {
+            if (first_operand)
+            {
+              tangent += t / fe2;
+              return;
+            }
+            with_operand<true>(result, tangent, [&](const auto &fer) {
+              tangent -= t * fer / fe2;
+            });
+          });
+          return;
+        case Op::kSin:
+          with_operand<true>(value1, tangent, [&](const auto &fe1) {
+            tangent += t * Math::cos(fe1);
+          });
+          return;
+        case Op::kCos:
+          with_operand<true>(value1, tangent, [&](const auto &fe1) {
+            tangent -= t * Math::sin(fe1);
+          });
+          return;
+        case Op::kExponential:
+          with_operand<true>(result, tangent, [&](const auto &fer) {
+            tangent += t * fer;
+          });
+          return;
+        case Op::kLogarithm:
+          with_operand<true>(value1, tangent, [&](const auto &fe1) {
+            tangent += t / fe1;
+          });
+          return;
+        case Op::kPower:
+        case Op::kSafePower:
+          with_operand<true>(value1, tangent, [&](const auto &fe1) {
+            with_operand<true>(result, tangent, [&](const auto &fer) {
+              if (first_operand)
+              {
+                with_operand<true>(value2, tangent, [&](const auto &fe2) {
+                  tangent += t * fer * fe2 / fe1;
+                });
+              }
+              else if (node == Op::kPower)
+              {
+                tangent += t * fer * (fe1.log());
+              }
+              else
+              {
+                tangent += t * fer * (fe1.abs().log());
+              }
+            });
+          });
+          return;
+        case Op::kAbs:
+          with_operand<true>(value1, tangent, [&](const auto &fe1) {
+            tangent += t * fe1.sign();
+          });
+          return;
+        case Op::kSqrt:
+          with_operand<true>(value1, tangent, [&](const auto &fe1) {
+            with_operand<true>(result, tangent, [&](const auto &fer) {
+              tangent += 0.5 * t / fer * fe1.sign();
+            });
+          });
+          return;
+        case Op::kSinh:
+          with_operand<true>(value1, tangent, [&](const auto &fe1) {
+            tangent += t * Math::cosh(fe1);
+          });
+          return;
+        case Op::kCosh:
+          with_operand<true>(value1, tangent, [&](const auto &fe1) {
+            tangent += t * Math::sinh(fe1);
+          });
+          return;
+        }
+        throw std::runtime_error("Unknown Operator In Tangent Evaluation");
+      }
+
+      //tangents that are known to be zero are empty buffers, so rows that
+      //do not depend on a direction cost nothing and, like in reverse
+      //mode, singular partial derivatives of such rows are never used
+      template <typename Math>
+      void tangent_eval(int node, const RowBuffers &forward,
+                        const RowBuffers &tangent, int num_directions,
+                        EvaluationWorkspace &workspace)
+      {
+        const BufferView &value1 = workspace.forward_eval[forward.param1];
+        const BufferView &value2 = workspace.forward_eval[forward.param2];
+        const BufferView &result = workspace.forward_eval[forward.result];
+        bool arity_2 = is_arity_2(node);
+        for (int direction = 0; direction < num_directions; ++direction)
+        {
+          const BufferView &t1 =
+              workspace.forward_eval[tangent.param1 + direction];
+          const BufferView &t2 =
+              workspace.forward_eval[tangent.param2 + direction];
+          bool has_t1 = t1.size() > 0;
+          bool has_t2 = arity_2 && t2.size() > 0;
+          if (!has_t1 && !has_t2)
+          {
+            workspace.ShapeForwardBuffer(tangent.result + direction, 0, 0);
+            continue;
+          }
+          const BufferView &shape = has_t1 ? t1 : t2;
+          BufferView &out = workspace.ShapeForwardBuffer(
+              tangent.result + direction, shape.rows(), shape.cols());
+          out.setZero();
+          if (has_t1)
+          {
+            add_tangent<Math>(node, true, value1, value2, result, t1, out);
+          }
+          if (has_t2)
+          {
+            add_tangent<Math>(node, false, value1, value2, result, t2, out);
+          }
+        }
+      }
+
+      // Single precision
+
+      //evaluate function(first, second) into a single precision buffer,
+      //broadcasting and ordering the writes like binary_forward
+      template <typename Function>
+      void single_binary_forward(int result, int param1, int param2,
+                                 EvaluationWorkspace &workspace,
+                                 Function function)
+      {
+        const SingleBufferView first = workspace.single_eval[param1];
+        const SingleBufferView second = workspace.single_eval[param2];
+        int rows = std::max(first.rows(), second.rows());
+        int cols = std::max(first.cols(), second.cols());
+        SingleBufferView &out = workspace.ShapeSingleBuffer(result, rows, cols);
+        for (int col = cols - 1; col >= 0; --col)
+        {
+          with_column(first, col, rows, [&](const auto &first_col) {
+            with_column(second, col, rows, [&](const auto &second_col) {
+              out.col(col) = function(first_col, second_col);
+            });
+          });
+        }
+      }
+
+      template <typename Function>
+      void single_unary_forward(int result, int param1,
+                                EvaluationWorkspace &workspace,
+                                Function function)
+      {
+        const SingleBufferView operand = workspace.single_eval[param1];
+        workspace.ShapeSingleBuffer(result, operand.rows(), operand.cols()) =
+            function(operand);
       }
 
     } // namespace
 
-    Eigen::ArrayXXd ForwardEvalFunction(int node, int param1, int param2,
-                                        const Eigen::ArrayXXd &x,
-                                        const Eigen::ArrayXXd &constants,
-                                        std::vector<Eigen::ArrayXXd> &forward_eval)
+    ForwardKernel GetForwardKernel(int node, bool broadcast, Accuracy accuracy)
     {
       switch (node)
       {
       case Op::kInteger:
-        return integer_forward_eval(param1, param2, x, constants, forward_eval);
+        return integer_forward_eval;
       case Op::kVariable:
-        return loadx_forward_eval(param1, param2, x, constants, forward_eval);
+        return loadx_forward_eval;
       case Op::kConstant:
-        return loadc_forward_eval(param1, param2, x, constants, forward_eval);
+        return loadc_forward_eval;
       case Op::kAddition:
-        return add_forward_eval(param1, param2, x, constants, forward_eval);
+        return broadcast ? add_forward_eval<true>
+                         : add_forward_eval<false>;
       case Op::kSubtraction:
-        return subtract_forward_eval(param1, param2, x, constants, forward_eval);
+        return broadcast ? subtract_forward_eval<true>
+                         : subtract_forward_eval<false>;
       case Op::kMultiplication:
-        return multiply_forward_eval(param1, param2, x, constants, forward_eval);
+        return broadcast ? multiply_forward_eval<true>
+                         : multiply_forward_eval<false>;
       case Op::kDivision:
-        return divide_forward_eval(param1, param2, x, constants, forward_eval);
+        return broadcast ? divide_forward_eval<true>
+                         : divide_forward_eval<false>;
       case Op::kSin:
-        return sin_forward_eval(param1, param2, x, constants, forward_eval);
+        return accuracy == kFast ? sin_forward_eval<FastMath>
+                                 : sin_forward_eval<StrictMath>;
       case Op::kCos:
-        return cos_forward_eval(param1, param2, x, constants, forward_eval);
+        return accuracy == kFast ? cos_forward_eval<FastMath>
+                                 : cos_forward_eval<StrictMath>;
       case Op::kExponential:
-        return exp_forward_eval(param1, param2, x, constants, forward_eval);
+        return exp_forward_eval;
       case Op::kLogarithm:
-        return log_forward_eval(param1, param2, x, constants, forward_eval);
+        return log_forward_eval;
       case Op::kPower:
-        return pow_forward_eval(param1, param2, x, constants, forward_eval);
+        if (accuracy == kFast)
+        {
+          return broadcast ? pow_forward_eval<true, FastMath>
+                           : pow_forward_eval<false, FastMath>;
+        }
+        return broadcast ? pow_forward_eval<true, StrictMath>
+                         : pow_forward_eval<false, StrictMath>;
       case Op::kAbs:
-        return abs_forward_eval(param1, param2, x, constants, forward_eval);
+        return abs_forward_eval;
       case Op::kSqrt:
-        return sqrt_forward_eval(param1, param2, x, constants, forward_eval);
+        return sqrt_forward_eval;
       case Op::kSafePower:
-        return safepow_forward_eval(param1, param2, x, constants, forward_eval);
+        if (accuracy == kFast)
+        {
+          return broadcast ? safepow_forward_eval<true, FastMath>
+                           : safepow_forward_eval<false, FastMath>;
+        }
+        return broadcast ? safepow_forward_eval<true, StrictMath>
+                         : safepow_forward_eval<false, StrictMath>;
       case Op::kSinh:
-        return sinh_forward_eval(param1, param2, x, constants, forward_eval);
+        return accuracy == kFast ? sinh_forward_eval<FastMath>
+                                 : sinh_forward_eval<StrictMath>;
       case Op::kCosh:
-        return cosh_forward_eval(param1, param2, x, constants, forward_eval);
+        return accuracy == kFast ? cosh_forward_eval<FastMath>
+                                 : cosh_forward_eval<StrictMath>;
       }
       throw std::runtime_error("Unknown Operator In Forward Evaluation");
     }
 
-    void ReverseEvalFunction(int node, int reverse_index, int param1, int param2,
-                             const std::vector<Eigen::ArrayXXd> &forward_eval,
-                             std::vector<Eigen::ArrayXXd> &reverse_eval)
+    ReverseKernel GetReverseKernel(int node, bool broadcast, Accuracy accuracy)
     {
       switch (node)
       {
       case Op::kInteger:
-        return integer_reverse_eval(reverse_index, param1, param2, forward_eval,
-                                    reverse_eval);
+        return integer_reverse_eval;
       case Op::kVariable:
-        return loadx_reverse_eval(reverse_index, param1, param2, forward_eval,
-                                  reverse_eval);
+        return loadx_reverse_eval;
       case Op::kConstant:
-        return loadc_reverse_eval(reverse_index, param1, param2, forward_eval,
-                                  reverse_eval);
+        return loadc_reverse_eval;
       case Op::kAddition:
-        return add_reverse_eval(reverse_index, param1, param2, forward_eval,
-                                reverse_eval);
+        return add_reverse_eval;
       case Op::kSubtraction:
-        return subtract_reverse_eval(reverse_index, param1, param2, forward_eval,
-                                     reverse_eval);
+        return subtract_reverse_eval;
       case Op::kMultiplication:
-        return multiply_reverse_eval(reverse_index, param1, param2, forward_eval,
-                                     reverse_eval);
+        return broadcast ? multiply_reverse_eval<true>
+                         : multiply_reverse_eval<false>;
       case Op::kDivision:
-        return divide_reverse_eval(reverse_index, param1, param2, forward_eval,
-                                   reverse_eval);
+        return broadcast ? divide_reverse_eval<true>
+                         : divide_reverse_eval<false>;
       case Op::kSin:
-        return sin_reverse_eval(reverse_index, param1, param2, forward_eval,
-                                reverse_eval);
+        if (accuracy == kFast)
+        {
+          return broadcast ? sin_reverse_eval<true, FastMath>
+                           : sin_reverse_eval<false, FastMath>;
+        }
+        return broadcast ? sin_reverse_eval<true, StrictMath>
+                         : sin_reverse_eval<false, StrictMath>;
       case Op::kCos:
-        return cos_reverse_eval(reverse_index, param1, param2, forward_eval,
-                                reverse_eval);
+        if (accuracy == kFast)
+        {
+          return broadcast ? cos_reverse_eval<true, FastMath>
+                           : cos_reverse_eval<false, FastMath>;
+        }
+        return broadcast ? cos_reverse_eval<true, StrictMath>
+                         : cos_reverse_eval<false, StrictMath>;
       case Op::kExponential:
-        return exp_reverse_eval(reverse_index, param1, param2, forward_eval,
-                                reverse_eval);
+        return broadcast ? exp_reverse_eval<true>
+                         : exp_reverse_eval<false>;
       case Op::kLogarithm:
-        return log_reverse_eval(reverse_index, param1, param2, forward_eval,
-                                reverse_eval);
+        return broadcast ? log_reverse_eval<true>
+                         : log_reverse_eval<false>;
       case Op::kPower:
-        return pow_reverse_eval(reverse_index, param1, param2, forward_eval,
-                                reverse_eval);
+        return broadcast ? pow_reverse_eval<true>
+                         : pow_reverse_eval<false>;
       case Op::kAbs:
-        return abs_reverse_eval(reverse_index, param1, param2, forward_eval,
-                                reverse_eval);
+        return broadcast ? abs_reverse_eval<true>
+                         : abs_reverse_eval<false>;
       case Op::kSqrt:
-        return sqrt_reverse_eval(reverse_index, param1, param2, forward_eval,
-                                 reverse_eval);
+        return broadcast ? sqrt_reverse_eval<true>
+                         : sqrt_reverse_eval<false>;
       case Op::kSafePower:
-        return safepow_reverse_eval(reverse_index, param1, param2, forward_eval,
-                                    reverse_eval);
+        return broadcast ? safepow_reverse_eval<true>
+                         : safepow_reverse_eval<false>;
       case Op::kSinh:
-        return sinh_reverse_eval(reverse_index, param1, param2, forward_eval,
-                                 reverse_eval);
+        if (accuracy == kFast)
+        {
+          return broadcast ? sinh_reverse_eval<true, FastMath>
+                           : sinh_reverse_eval<false, FastMath>;
+        }
+        return broadcast ? sinh_reverse_eval<true, StrictMath>
+                         : sinh_reverse_eval<false, StrictMath>;
       case Op::kCosh:
-        return cosh_reverse_eval(reverse_index, param1, param2, forward_eval,
-                                 reverse_eval);
+        if (accuracy == kFast)
+        {
+          return broadcast ? cosh_reverse_eval<true, FastMath>
+                           : cosh_reverse_eval<false, FastMath>;
+        }
+        return broadcast ? cosh_reverse_eval<true, StrictMath>
+                         : cosh_reverse_eval<false, StrictMath>;
       }
       throw std::runtime_error("Unknown Operator In Reverse Evaluation");
     }
+
+    void FusedForwardEval(const FusedChain &chain, int result,
+                          ShapeClass shape,
+                          const Eigen::Ref<const Eigen::ArrayXXd> &x,
+                          const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+                          EvaluationWorkspace &workspace)
+    {
+      if (workspace.GetAccuracy() == kFast)
+      {
+        fused_forward_eval<FastMath>(chain, result, shape, x, constants,
+                                     workspace);
+      }
+      else
+      {
+        fused_forward_eval<StrictMath>(chain, result, shape, x, constants,
+                                       workspace);
+      }
+    }
+
+    void ForwardEvalFunction(int node, int result_index, int param1, int param2,
+                             const Eigen::Ref<const Eigen::ArrayXXd> &x,
+                             const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+                             EvaluationWorkspace &workspace)
+    {
+      ForwardKernel kernel =
+          GetForwardKernel(node, true, workspace.GetAccuracy());
+      kernel(result_index, param1, param2, x, constants, workspace);
+    }
+
+    void TangentEvalFunction(int node, const RowBuffers &forward,
+                             const RowBuffers &tangent, int num_directions,
+                             EvaluationWorkspace &workspace)
+    {
+      if (workspace.GetAccuracy() == kFast)
+      {
+        tangent_eval<FastMath>(node, forward, tangent, num_directions,
+                               workspace);
+      }
+      else
+      {
+        tangent_eval<StrictMath>(node, forward, tangent, num_directions,
+                                 workspace);
+      }
+    }
+
+    void SingleForwardEvalFunction(
+        int node, int result_index, int param1, int param2,
+        const Eigen::Ref<const Eigen::ArrayXXf> &x,
+        const Eigen::Ref<const Eigen::ArrayXXf> &constants,
+        EvaluationWorkspace &workspace)
+    {
+      switch (node)
+      {
+      case Op::kInteger:
+        workspace.ShapeSingleBuffer(result_index, 1, 1).setConstant(param1);
+        return;
+      case Op::kVariable:
+        workspace.ShapeSingleBuffer(result_index, x.rows(), 1) =
+            x.col(param1);
+        return;
+      case Op::kConstant:
+        workspace.ShapeSingleBuffer(result_index, 1, constants.cols()) =
+            constants.row(param1);
+        return;
+      case Op::kAddition:
+        single_binary_forward(
+            result_index, param1, param2, workspace,
+            [](const auto &first, const auto &second) {
+              return first + second;
+            });
+        return;
+      case Op::kSubtraction:
+        single_binary_forward(
+            result_index, param1, param2, workspace,
+            [](const auto &first, const auto &second) {
+              return first - second;
+            });
+        return;
+      case Op::kMultiplication:
+        single_binary_forward(
+            result_index, param1, param2, workspace,
+            [](const auto &first, const auto &second) {
+              return first * second;
+            });
+        return;
+      case Op::kDivision:
+        single_binary_forward(
+            result_index, param1, param2, workspace,
+            [](const auto &first, const auto &second) {
+              return first / second;
+            });
+        return;
+      case Op::kSin:
+        single_unary_forward(result_index, param1, workspace,
+                             [](const auto &operand) {
+                               return operand.sin();
+                             });
+        return;
+      case Op::kCos:
+        single_unary_forward(result_index, param1, workspace,
+                             [](const auto &operand) {
+                               return operand.cos();
+                             });
+        return;
+      case Op::kExponential:
+        single_unary_forward(result_index, param1, workspace,
+                             [](const auto &operand) {
+                               return operand.exp();
+                             });
+        return;
+      case Op::kLogarithm:
+        single_unary_forward(result_index, param1, workspace,
+                             [](const auto &operand) {
+                               return operand.abs().log();
+                             });
+        return;
+      case Op::kPower:
+        single_binary_forward(
+            result_index, param1, param2, workspace,
+            [](const auto &first, const auto &second) {
+              return first.pow(second);
+            });
+        return;
+      case Op::kAbs:
+        single_unary_forward(result_index, param1, workspace,
+                             [](const auto &operand) {
+                               return operand.abs();
+                             });
+        return;
+      case Op::kSqrt:
+        single_unary_forward(result_index, param1, workspace,
+                             [](const auto &operand) {
+                               return operand.abs().sqrt();
+                             });
+        return;
+      case Op::kSafePower:
+        single_binary_forward(
+            result_index, param1, param2, workspace,
+            [](const auto &first, const auto &second) {
+              return first.abs().pow(second);
+            });
+        return;
+      case Op::kSinh:
+        single_unary_forward(result_index, param1, workspace,
+                             [](const auto &operand) {
+                               return operand.sinh();
+                             });
+        return;
+      case Op::kCosh:
+        single_unary_forward(result_index, param1, workspace,
+                             [](const auto &operand) {
+                               return operand.cosh();
+                             });
+        return;
+      }
+      throw std::runtime_error("Unknown Operator In Forward Evaluation");
+    }
+
+    void ReverseEvalFunction(int node, const RowBuffers &forward,
+                             const RowBuffers &reverse,
+                             EvaluationWorkspace &workspace)
+    {
+      ReverseKernel kernel =
+          GetReverseKernel(node, true, workspace.GetAccuracy());
+      kernel(forward, reverse, workspace);
+    }
+
+    bool ReverseUsesParam1(int node)
+    {
+      switch (node)
+      {
+      case Op::kMultiplication:
+      case Op::kSin:
+      case Op::kCos:
+      case Op::kLogarithm:
+      case Op::kPower:
+      case Op::kAbs:
+      case Op::kSqrt:
+      case Op::kSafePower:
+      case Op::kSinh:
+      case Op::kCosh:
+        return true;
+      }
+      return false;
+    }
+
+    bool ReverseUsesParam2(int node)
+    {
+      switch (node)
+      {
+      case Op::kMultiplication:
+      case Op::kDivision:
+      case Op::kPower:
+      case Op::kSafePower:
+        return true;
+      }
+      return false;
+    }
+
+    bool ReverseUsesResult(int node)
+    {
+      switch (node)
+      {
+      case Op::kDivision:
+      case Op::kExponential:
+      case Op::kPower:
+      case Op::kSqrt:
+      case Op::kSafePower:
+        return true;
+      }
+      return false;
+    }
   } // namespace backend
-} // namespace bingo
\ No newline at end of file
+} // namespace bingo
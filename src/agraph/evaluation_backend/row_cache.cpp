@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include <bingocpp/agraph/evaluation_backend/row_cache.h>
+#include <bingocpp/agraph/evaluation_backend/operator_eval.h>
+#include <bingocpp/agraph/constants.h>
+#include <bingocpp/agraph/operator_definitions.h>
+
+namespace bingo
+{
+  namespace evaluation_backend
+  {
+    namespace
+    {
+      // terminals are identified by what they load, operators by their
+      // operands
+      RowCache::RowKey terminal_key(
+          const Eigen::Ref<const Eigen::ArrayX3i> &stack, int row,
+          const Eigen::Ref<const Eigen::ArrayXXd> &constants)
+      {
+        int node = stack(row, kOpIdx);
+        std::int64_t param = stack(row, kParam1Idx);
+        if (node == Op::kConstant)
+        {
+          double value = constants(param, 0);
+          std::memcpy(&param, &value, sizeof(param));
+        }
+        return RowCache::RowKey{{node, param, 0}};
+      }
+
+      // operands are named by ids; a missing id names no row
+      RowCache::RowKey operator_key(
+          const Eigen::Ref<const Eigen::ArrayX3i> &stack, int row,
+          const std::vector<int> &ids)
+      {
+        int node = stack(row, kOpIdx);
+        int id2 = kIsArity2Map.at(node) ? ids[stack(row, kParam2Idx)] : 0;
+        return RowCache::RowKey{{node, ids[stack(row, kParam1Idx)], id2}};
+      }
+
+      int tile_rows(int num_samples, int tile_size)
+      {
+        if (tile_size <= 0 || tile_size > num_samples)
+        {
+          return num_samples;
+        }
+        return tile_size;
+      }
+    } // namespace
+
+    bool RowCache::IsCacheOf(const Eigen::Ref<const Eigen::ArrayXXd> &x,
+                             Accuracy accuracy) const
+    {
+      return accuracy == accuracy_ && dataset_.Matches(x);
+    }
+
+    const Eigen::ArrayXXd &RowCache::GetValue() const
+    {
+      return *values_.back();
+    }
+
+    int RowCache::GetNumReused() const
+    {
+      return num_reused_;
+    }
+
+    std::shared_ptr<const RowCache> EvaluateRows(
+        const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+        const Eigen::Ref<const Eigen::ArrayXXd> &x,
+        const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+        const std::shared_ptr<const RowCache> &previous,
+        EvaluationWorkspace &workspace)
+    {
+      if (constants.cols() > 1)
+      {
+        throw std::invalid_argument(
+            "Row caches take a single set of constants");
+      }
+      if (stack.rows() == 0 || x.rows() == 0)
+      {
+        throw std::invalid_argument("Row caches need rows and samples");
+      }
+      const int stack_depth = stack.rows();
+      const int num_samples = x.rows();
+
+      std::shared_ptr<RowCache> cache = std::make_shared<RowCache>();
+      cache->dataset_ = DatasetFingerprint(x);
+      cache->accuracy_ = workspace.GetAccuracy();
+      cache->values_.resize(stack_depth);
+      cache->num_reused_ = 0;
+      bool use_previous =
+          previous && previous->IsCacheOf(x, workspace.GetAccuracy());
+
+      // match every row to its first occurrence in this stack, and to the
+      // row of the previous stack with the same value if there is one
+      std::vector<int> first(stack_depth);
+      std::vector<int> reused(stack_depth, -1);
+      for (int i = 0; i < stack_depth; ++i)
+      {
+        int node = stack(i, kOpIdx);
+        RowCache::RowKey key;
+        RowCache::RowKey previous_key;
+        bool matchable = use_previous;
+        if (node <= Op::kConstant)
+        {
+          key = terminal_key(stack, i, constants);
+          previous_key = key;
+        }
+        else
+        {
+          key = operator_key(stack, i, first);
+          previous_key = operator_key(stack, i, reused);
+          matchable = matchable && previous_key[1] >= 0 &&
+                      previous_key[2] >= 0;
+        }
+        first[i] = cache->rows_.emplace(key, i).first->second;
+        if (matchable)
+        {
+          auto match = previous->rows_.find(previous_key);
+          if (match != previous->rows_.end())
+          {
+            reused[i] = match->second;
+            cache->values_[i] = previous->values_[match->second];
+            ++cache->num_reused_;
+          }
+        }
+      }
+
+      // reused rows are read in place; the others are evaluated tile by
+      // tile and copied out of the workspace
+      std::vector<std::shared_ptr<Eigen::ArrayXXd>> computed(stack_depth);
+      int tile_size = tile_rows(num_samples, workspace.GetTileSize());
+      workspace.Reserve(stack_depth, tile_size, 1);
+      for (int start = 0; start < num_samples; start += tile_size)
+      {
+        int num_rows = std::min(tile_size, num_samples - start);
+        auto x_tile = x.middleRows(start, num_rows);
+        for (int i = 0; i < stack_depth; ++i)
+        {
+          if (reused[i] >= 0)
+          {
+            const Eigen::ArrayXXd &value = *cache->values_[i];
+            double *data = const_cast<double *>(value.data());
+            if (value.rows() == num_samples)
+            {
+              new (&workspace.forward_eval[i])
+                  BufferView(data + start, num_rows, 1);
+            }
+            else
+            {
+              new (&workspace.forward_eval[i]) BufferView(data, 1, 1);
+            }
+            continue;
+          }
+          ForwardEvalFunction(stack(i, kOpIdx), i, stack(i, kParam1Idx),
+                              stack(i, kParam2Idx), x_tile, constants,
+                              workspace);
+          const BufferView &result = workspace.forward_eval[i];
+          if (!computed[i])
+          {
+            // rows that do not depend on x keep a single value
+            computed[i] = std::make_shared<Eigen::ArrayXXd>(
+                result.rows() == num_rows ? num_samples : 1, 1);
+          }
+          Eigen::ArrayXXd &value = *computed[i];
+          if (value.rows() == num_samples)
+          {
+            value.middleRows(start, num_rows) = result;
+          }
+          else if (start == 0)
+          {
+            value = result;
+          }
+        }
+      }
+      for (int i = 0; i < stack_depth; ++i)
+      {
+        if (computed[i])
+        {
+          cache->values_[i] = computed[i];
+        }
+      }
+      return cache;
+    }
+  } // namespace evaluation_backend
+} // namespace bingo
@@ -0,0 +1,324 @@
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <bingocpp/agraph/evaluation_backend/subexpression_cache.h>
+#include <bingocpp/agraph/evaluation_backend/operator_eval.h>
+#include <bingocpp/agraph/constants.h>
+#include <bingocpp/agraph/operator_definitions.h>
+
+namespace bingo
+{
+  namespace evaluation_backend
+  {
+    namespace
+    {
+      // approximate size of an id in the hash-consing table
+      const std::size_t kIdBytes = 96;
+
+      SubexpressionCache::NodeKey node_key(
+          const Eigen::Ref<const Eigen::ArrayX3i> &stack, int row,
+          const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+          const std::vector<std::int64_t> &ids)
+      {
+        int node = stack(row, kOpIdx);
+        if (node <= Op::kConstant)
+        {
+          std::int64_t param = stack(row, kParam1Idx);
+          if (node == Op::kConstant)
+          {
+            double value = constants(param, 0);
+            std::memcpy(&param, &value, sizeof(param));
+          }
+          return SubexpressionCache::NodeKey{{node, param, 0}};
+        }
+        std::int64_t id1 = ids[stack(row, kParam1Idx)];
+        std::int64_t id2 =
+            kIsArity2Map.at(node) ? ids[stack(row, kParam2Idx)] : -1;
+        if ((node == Op::kAddition || node == Op::kMultiplication) &&
+            id2 < id1)
+        {
+          std::swap(id1, id2);
+        }
+        return SubexpressionCache::NodeKey{{node, id1, id2}};
+      }
+
+      int tile_rows(int num_samples, int tile_size)
+      {
+        if (tile_size <= 0 || tile_size > num_samples)
+        {
+          return num_samples;
+        }
+        return tile_size;
+      }
+    } // namespace
+
+    SubexpressionCache::SubexpressionCache(std::size_t memory_budget)
+        : memory_budget_(memory_budget), column_bytes_(0),
+          has_dataset_(false), accuracy_(kStrict), next_id_(0),
+          generation_(0),
+          num_hits_(0), num_misses_(0) {}
+
+    void SubexpressionCache::NewGeneration()
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto it = columns_.begin(); it != columns_.end();)
+      {
+        if (it->second.last_used < generation_)
+        {
+          column_bytes_ -= it->second.value->size() * sizeof(double);
+          it = columns_.erase(it);
+        }
+        else
+        {
+          ++it;
+        }
+      }
+      // ids are only dropped all together, as values refer to them
+      if (columns_.empty() ||
+          ids_.size() * kIdBytes + column_bytes_ > memory_budget_)
+      {
+        clear();
+      }
+      ++generation_;
+    }
+
+    void SubexpressionCache::Clear()
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      clear();
+    }
+
+    std::size_t SubexpressionCache::GetMemoryBudget() const
+    {
+      return memory_budget_;
+    }
+
+    std::size_t SubexpressionCache::GetMemoryUsage() const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return ids_.size() * kIdBytes + column_bytes_;
+    }
+
+    long SubexpressionCache::GetNumHits() const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return num_hits_;
+    }
+
+    long SubexpressionCache::GetNumMisses() const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return num_misses_;
+    }
+
+    void SubexpressionCache::use_dataset(
+        const Eigen::Ref<const Eigen::ArrayXXd> &x, Accuracy accuracy)
+    {
+      if (has_dataset_ && accuracy == accuracy_ && dataset_.Matches(x))
+      {
+        return;
+      }
+      clear();
+      dataset_ = DatasetFingerprint(x);
+      accuracy_ = accuracy;
+      has_dataset_ = true;
+    }
+
+    std::size_t SubexpressionCache::NodeKeyHash::operator()(
+        const NodeKey &key) const
+    {
+      std::size_t seed = 0;
+      for (std::int64_t value : key)
+      {
+        seed ^= std::hash<std::int64_t>()(value) + 0x9e3779b9 + (seed << 6) +
+                (seed >> 2);
+      }
+      return seed;
+    }
+
+    std::int64_t SubexpressionCache::intern(const NodeKey &key)
+    {
+      // ids are never reused, so a value stored for a dropped id cannot be
+      // mistaken for that of a new one
+      auto id = ids_.emplace(key, next_id_);
+      if (id.second)
+      {
+        ++next_id_;
+      }
+      return id.first->second;
+    }
+
+    void SubexpressionCache::clear()
+    {
+      ids_.clear();
+      columns_.clear();
+      column_bytes_ = 0;
+    }
+
+    Eigen::ArrayXXd EvaluateShared(
+        const Eigen::Ref<const Eigen::ArrayX3i> &stack,
+        const Eigen::Ref<const Eigen::ArrayXXd> &x,
+        const Eigen::Ref<const Eigen::ArrayXXd> &constants,
+        SubexpressionCache &cache,
+        EvaluationWorkspace &workspace)
+    {
+      if (constants.cols() > 1)
+      {
+        throw std::invalid_argument(
+            "Shared evaluation takes a single set of constants");
+      }
+      if (stack.rows() == 0 || x.rows() == 0)
+      {
+        throw std::invalid_argument("Shared evaluation needs rows and samples");
+      }
+      const int stack_depth = stack.rows();
+      const int num_samples = x.rows();
+
+      // name every row, then find the rows that have to be evaluated: those
+      // needed by the output that are neither cached nor identical to an
+      // earlier row
+      std::vector<std::int64_t> ids(stack_depth);
+      std::vector<int> first(stack_depth);
+      std::vector<std::shared_ptr<const Eigen::ArrayXXd>> cached(stack_depth);
+      std::vector<bool> needed(stack_depth, false);
+      {
+        std::lock_guard<std::mutex> lock(cache.mutex_);
+        cache.use_dataset(x, workspace.GetAccuracy());
+        std::unordered_map<std::int64_t, int> rows(2 * stack_depth);
+        for (int i = 0; i < stack_depth; ++i)
+        {
+          ids[i] = cache.intern(node_key(stack, i, constants, ids));
+          first[i] = rows.emplace(ids[i], i).first->second;
+        }
+        needed[stack_depth - 1] = true;
+        for (int i = stack_depth - 1; i >= 0; --i)
+        {
+          if (!needed[i])
+          {
+            continue;
+          }
+          if (first[i] != i)
+          {
+            needed[first[i]] = true;
+            continue;
+          }
+          int node = stack(i, kOpIdx);
+          if (node <= Op::kConstant)
+          {
+            continue;
+          }
+          auto column = cache.columns_.find(ids[i]);
+          if (column != cache.columns_.end())
+          {
+            column->second.last_used = cache.generation_;
+            cached[i] = column->second.value;
+            ++cache.num_hits_;
+            continue;
+          }
+          ++cache.num_misses_;
+          needed[stack(i, kParam1Idx)] = true;
+          if (kIsArity2Map.at(node))
+          {
+            needed[stack(i, kParam2Idx)] = true;
+          }
+        }
+      }
+
+      std::vector<std::shared_ptr<Eigen::ArrayXXd>> computed(stack_depth);
+      Eigen::ArrayXXd f_of_x(num_samples, 1);
+      int tile_size = tile_rows(num_samples, workspace.GetTileSize());
+      workspace.Reserve(stack_depth, tile_size, 1);
+      for (int start = 0; start < num_samples; start += tile_size)
+      {
+        int num_rows = std::min(tile_size, num_samples - start);
+        auto x_tile = x.middleRows(start, num_rows);
+        for (int i = 0; i < stack_depth; ++i)
+        {
+          if (!needed[i])
+          {
+            continue;
+          }
+          if (first[i] != i)
+          {
+            const BufferView &same = workspace.forward_eval[first[i]];
+            new (&workspace.forward_eval[i]) BufferView(
+                const_cast<double *>(same.data()), same.rows(), same.cols());
+            continue;
+          }
+          if (cached[i])
+          {
+            double *data = const_cast<double *>(cached[i]->data());
+            if (cached[i]->rows() == num_samples)
+            {
+              new (&workspace.forward_eval[i])
+                  BufferView(data + start, num_rows, 1);
+            }
+            else
+            {
+              new (&workspace.forward_eval[i]) BufferView(data, 1, 1);
+            }
+            continue;
+          }
+          ForwardEvalFunction(stack(i, kOpIdx), i, stack(i, kParam1Idx),
+                              stack(i, kParam2Idx), x_tile, constants,
+                              workspace);
+          if (stack(i, kOpIdx) <= Op::kConstant)
+          {
+            continue;
+          }
+          const BufferView &result = workspace.forward_eval[i];
+          if (!computed[i])
+          {
+            // rows that do not depend on x keep a single value
+            computed[i] = std::make_shared<Eigen::ArrayXXd>(
+                result.rows() == num_rows ? num_samples : 1, 1);
+          }
+          Eigen::ArrayXXd &value = *computed[i];
+          if (value.rows() == num_samples)
+          {
+            value.middleRows(start, num_rows) = result;
+          }
+          else if (start == 0)
+          {
+            value = result;
+          }
+        }
+        const BufferView &output = workspace.forward_eval[stack_depth - 1];
+        if (output.rows() == num_rows)
+        {
+          f_of_x.middleRows(start, num_rows) = output;
+        }
+        else
+        {
+          f_of_x.middleRows(start, num_rows).setConstant(output(0, 0));
+        }
+      }
+
+      std::lock_guard<std::mutex> lock(cache.mutex_);
+      for (int i = 0; i < stack_depth; ++i)
+      {
+        if (!computed[i])
+        {
+          continue;
+        }
+        std::size_t bytes = computed[i]->size() * sizeof(double);
+        if (cache.ids_.size() * kIdBytes + cache.column_bytes_ + bytes >
+            cache.memory_budget_)
+        {
+          break;
+        }
+        SubexpressionCache::Column column{computed[i], cache.generation_};
+        if (cache.columns_.emplace(ids[i], column).second)
+        {
+          cache.column_bytes_ += bytes;
+        }
+      }
+      return f_of_x;
+    }
+  } // namespace evaluation_backend
+} // namespace bingo
@@ -0,0 +1,96 @@
+#include <limits>
+#include <stdexcept>
+
+#include <bingocpp/agraph/packed_command_array.h>
+#include <bingocpp/agraph/constants.h>
+
+namespace bingo
+{
+
+  namespace
+  {
+
+    static_assert(sizeof(PackedCommand) == 6,
+                  "packed commands take 6 bytes");
+
+    bool fits(int value, int min, int max)
+    {
+      return value >= min && value <= max;
+    }
+
+  } // namespace
+
+  PackedCommandArray::PackedCommandArray() {}
+
+  PackedCommandArray::PackedCommandArray(int rows) : commands_(rows) {}
+
+  PackedCommandArray::PackedCommandArray(
+      const Eigen::Ref<const Eigen::ArrayX3i> &command_array)
+  {
+    if (!CanPack(command_array))
+    {
+      throw std::out_of_range("Command array does not fit in packed commands");
+    }
+    commands_.resize(command_array.rows());
+    for (int i = 0; i < command_array.rows(); ++i)
+    {
+      commands_[i].node = command_array(i, kOpIdx);
+      commands_[i].param1 = command_array(i, kParam1Idx);
+      commands_[i].param2 = command_array(i, kParam2Idx);
+    }
+  }
+
+  bool PackedCommandArray::CanPack(
+      const Eigen::Ref<const Eigen::ArrayX3i> &command_array)
+  {
+    const int node_min = std::numeric_limits<std::int8_t>::min();
+    const int node_max = std::numeric_limits<std::int8_t>::max();
+    const int param_min = std::numeric_limits<std::int16_t>::min();
+    const int param_max = std::numeric_limits<std::int16_t>::max();
+    for (int i = 0; i < command_array.rows(); ++i)
+    {
+      if (!fits(command_array(i, kOpIdx), node_min, node_max) ||
+          !fits(command_array(i, kParam1Idx), param_min, param_max) ||
+          !fits(command_array(i, kParam2Idx), param_min, param_max))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  Eigen::ArrayX3i PackedCommandArray::Unpack() const
+  {
+    Eigen::ArrayX3i command_array(commands_.size(), kArrayCols);
+    for (int i = 0; i < Rows(); ++i)
+    {
+      command_array.row(i) << commands_[i].node, commands_[i].param1,
+          commands_[i].param2;
+    }
+    return command_array;
+  }
+
+  bool PackedCommandArray::Matches(
+      const Eigen::Ref<const Eigen::ArrayX3i> &command_array) const
+  {
+    if (command_array.rows() != Rows())
+    {
+      return false;
+    }
+    for (int i = 0; i < Rows(); ++i)
+    {
+      if (command_array(i, kOpIdx) != commands_[i].node ||
+          command_array(i, kParam1Idx) != commands_[i].param1 ||
+          command_array(i, kParam2Idx) != commands_[i].param2)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::size_t PackedCommandArray::GetMemoryUsage() const
+  {
+    return commands_.size() * sizeof(PackedCommand);
+  }
+} // namespace bingo
@@ -1,5 +1,5 @@
-#include <map>
 #include <numeric>
+#include <vector>
 
 #include <Eigen/Dense>
 
@@ -17,45 +17,100 @@ namespace py = pybind11;
 namespace bingo {
 namespace simplification_backend {
 
-std::vector<bool> GetUtilizedCommands(const Eigen::ArrayX3i &stack) {
-  std::vector<bool> used_commands(stack.rows());
+namespace {
+
+// Commands are read and written the same way in both representations
+int node(const Eigen::ArrayX3i &stack, int row) {
+  return stack(row, kOpIdx);
+}
+
+int param1(const Eigen::ArrayX3i &stack, int row) {
+  return stack(row, kParam1Idx);
+}
+
+int param2(const Eigen::ArrayX3i &stack, int row) {
+  return stack(row, kParam2Idx);
+}
+
+int num_rows(const Eigen::ArrayX3i &stack) {
+  return stack.rows();
+}
+
+void set_command(Eigen::ArrayX3i &stack, int row, int node, int param1,
+                 int param2) {
+  stack.row(row) << node, param1, param2;
+}
+
+Eigen::ArrayX3i make_stack(const Eigen::ArrayX3i & /* like */, int rows) {
+  return Eigen::ArrayX3i(rows, kArrayCols);
+}
+
+int node(const PackedCommandArray &stack, int row) {
+  return stack[row].node;
+}
+
+int param1(const PackedCommandArray &stack, int row) {
+  return stack[row].param1;
+}
+
+int param2(const PackedCommandArray &stack, int row) {
+  return stack[row].param2;
+}
+
+int num_rows(const PackedCommandArray &stack) {
+  return stack.Rows();
+}
+
+void set_command(PackedCommandArray &stack, int row, int node, int param1,
+                 int param2) {
+  stack[row].node = node;
+  stack[row].param1 = param1;
+  stack[row].param2 = param2;
+}
+
+PackedCommandArray make_stack(const PackedCommandArray & /* like */,
+                              int rows) {
+  return PackedCommandArray(rows);
+}
+
+template <typename Stack>
+std::vector<bool> get_utilized_commands(const Stack &stack) {
+  int stack_size = num_rows(stack);
+  std::vector<bool> used_commands(stack_size);
   used_commands.back() = true;
-  int stack_size = stack.rows();
   for (int i = 1; i < stack_size; i++) {
     int row = stack_size - i;
-    int node = stack(row, kOpIdx);
-    int param1 = stack(row, kParam1Idx);
-    int param2 = stack(row, kParam2Idx);
-    if (used_commands[row] && node > Op::kConstant) {
-      used_commands[param1] = true;
-      if (kIsArity2Map.at(node)) {
-        used_commands[param2] = true;
+    int row_node = node(stack, row);
+    if (used_commands[row] && row_node > Op::kConstant) {
+      used_commands[param1(stack, row)] = true;
+      if (kIsArity2Map.at(row_node)) {
+        used_commands[param2(stack, row)] = true;
       }
     }
   }
   return used_commands;
 }
 
-Eigen::ArrayX3i SimplifyStack(const Eigen::ArrayX3i &stack) {
-  std::vector<bool> used_command = GetUtilizedCommands(stack);
-  std::map<int, int> reduced_param_map;
+template <typename Stack>
+Stack simplify_stack(const Stack &stack) {
+  std::vector<bool> used_command = get_utilized_commands(stack);
+  std::vector<int> reduced_param_map(num_rows(stack));
   int num_commands = 0;
   num_commands = std::accumulate(used_command.begin(), used_command.end(), 0);
-  Eigen::ArrayX3i new_stack(num_commands, 3);
+  Stack new_stack = make_stack(stack, num_commands);
 
-  for (int i = 0, j = 0; i < stack.rows(); ++i) {
+  for (int i = 0, j = 0; i < num_rows(stack); ++i) {
     if (used_command[i]) {
-      new_stack(j, kOpIdx) = stack(i, kOpIdx);
-      if (kIsTerminalMap.at(new_stack(j, kOpIdx))) {
-        new_stack(j, kParam1Idx) = stack(i, kParam1Idx);
-        new_stack(j, kParam2Idx) = stack(i, kParam2Idx);
+      int row_node = node(stack, i);
+      if (kIsTerminalMap.at(row_node)) {
+        set_command(new_stack, j, row_node, param1(stack, i),
+                    param2(stack, i));
       } else {
-        new_stack(j, kParam1Idx) = reduced_param_map[stack(i, kParam1Idx)];
-        if (kIsArity2Map.at(new_stack(j, kOpIdx))) {
-          new_stack(j, kParam2Idx) = reduced_param_map[stack(i, kParam2Idx)];
-        } else {
-          new_stack(j, kParam2Idx) = new_stack(j, kParam1Idx);
-        }
+        int new_param1 = reduced_param_map[param1(stack, i)];
+        int new_param2 = kIsArity2Map.at(row_node)
+                             ? reduced_param_map[param2(stack, i)]
+                             : new_param1;
+        set_command(new_stack, j, row_node, new_param1, new_param2);
       }
       reduced_param_map[i] = j;
       ++j;
@@ -63,8 +118,27 @@ Eigen::ArrayX3i SimplifyStack(const Eigen::ArrayX3i &stack) {
   }
   return new_stack;
 }
+} // namespace
+
+std::vector<bool> GetUtilizedCommands(const Eigen::ArrayX3i &stack) {
+  return get_utilized_commands(stack);
+}
+
+std::vector<bool> GetUtilizedCommands(const PackedCommandArray &stack) {
+  return get_utilized_commands(stack);
+}
+
+Eigen::ArrayX3i SimplifyStack(const Eigen::ArrayX3i &stack) {
+  return simplify_stack(stack);
+}
+
+PackedCommandArray SimplifyStack(const PackedCommandArray &stack) {
+  return simplify_stack(stack);
+}
 
 Eigen::ArrayX3i PythonSimplifyStack(const Eigen::ArrayX3i &stack) {
+  // may be called while the GIL is released, e.g. by a PopulationEvaluator
+  py::gil_scoped_acquire gil;
   py::object python_simp_module = py::module::import("bingo.symbolic_regression.agraph.simplification_backend.simplification_backend");
   py::object python_simp = python_simp_module.attr("simplify_stack");
   Eigen::ArrayX3i result = python_simp(stack).cast<Eigen::ArrayX3i>();
@@ -22,22 +22,53 @@ ExplicitTrainingData *ExplicitTrainingData::GetItem(
   return new ExplicitTrainingData(temp_in, temp_out);
 }
 
+const Eigen::ArrayXXf &ExplicitTrainingData::GetXSingle() {
+  std::lock_guard<std::mutex> lock(x_single_mutex_);
+  if (!x_single_of_.Matches(x)) {
+    x_single_ = x.cast<float>();
+    x_single_of_ = evaluation_backend::DatasetFingerprint(x);
+  }
+  return x_single_;
+}
+
 Eigen::ArrayXd ExplicitRegression::EvaluateFitnessVector(
     Equation &individual) const {
   ++ eval_count_;
-  const Eigen::ArrayXXd x = ((ExplicitTrainingData*)training_data_)->x;
-  Eigen::ArrayXXd f_of_x = individual.EvaluateEquationAt(x);
+  evaluation_backend::AccuracyScope accuracy(
+      evaluation_backend::ThreadWorkspace(), accuracy_);
+  Eigen::ArrayXXd f_of_x;
+  if (precision_ == evaluation_backend::kSingle) {
+    f_of_x = individual.EvaluateEquationSingleAt(
+        ((ExplicitTrainingData*)training_data_)->GetXSingle()).cast<double>();
+  } else {
+    f_of_x = individual.EvaluateEquationAt(
+        ((ExplicitTrainingData*)training_data_)->x);
+  }
   Eigen::ArrayXXd error = f_of_x - ((ExplicitTrainingData*)training_data_)->y;
   if (relative_)
     error /= ((ExplicitTrainingData*)training_data_)->y;
   return error;
 }
 
+std::vector<evaluation_backend::DatasetFingerprint>
+ExplicitRegression::FingerprintTrainingData() const {
+  const ExplicitTrainingData *data = (ExplicitTrainingData*)training_data_;
+  return {evaluation_backend::DatasetFingerprint(data->x),
+          evaluation_backend::DatasetFingerprint(data->y)};
+}
+
+std::string ExplicitRegression::GetConfiguration() const {
+  return VectorBasedFunction::GetConfiguration() +
+         (relative_ ? " relative" : " absolute");
+}
+
 FitnessVectorAndJacobian ExplicitRegression::GetFitnessVectorAndJacobian(
     Equation &individual) const {
   ++ eval_count_;
+  evaluation_backend::AccuracyScope accuracy(
+      evaluation_backend::ThreadWorkspace(), accuracy_);
   Eigen::ArrayXXd f_of_x, df_dc;
-  const Eigen::ArrayXXd x = ((ExplicitTrainingData*)training_data_)->x;
+  const Eigen::ArrayXXd &x = ((ExplicitTrainingData*)training_data_)->x;
   std::tie(f_of_x, df_dc) = individual.EvaluateEquationWithLocalOptGradientAt(x);
 
   Eigen::ArrayXXd error = f_of_x - ((ExplicitTrainingData*)training_data_)->y;
@@ -48,6 +79,64 @@ FitnessVectorAndJacobian ExplicitRegression::GetFitnessVectorAndJacobian(
   return FitnessVectorAndJacobian{error, df_dc};
 }
 
+FitnessVectorAndGradient ExplicitRegression::GetFitnessVectorAndGradient(
+    Equation &individual, const FitnessSeed &seed) const {
+  ++ eval_count_;
+  evaluation_backend::AccuracyScope accuracy(
+      evaluation_backend::ThreadWorkspace(), accuracy_);
+  const ExplicitTrainingData *data = (ExplicitTrainingData*)training_data_;
+  // the weights of samples are their fitness seed, chained through the
+  // relative error
+  SeedFunction sample_seed = [&](int start,
+                                 const Eigen::Ref<const Eigen::ArrayXXd> &f_of_x,
+                                 Eigen::Ref<Eigen::ArrayXd> weights) {
+    auto y = data->y.col(0).segment(start, f_of_x.rows());
+    weights = f_of_x.col(0) - y;
+    if (relative_)
+      weights /= y;
+    seed(weights, weights);
+    if (relative_)
+      weights /= y;
+  };
+  EvalAndDerivative f_of_x_and_gradient =
+      individual.EvaluateEquationWithLocalOptVectorJacobianProductAt(
+          data->x, sample_seed);
+
+  Eigen::ArrayXd error = f_of_x_and_gradient.first.col(0) - data->y.col(0);
+  if (relative_)
+    error /= data->y.col(0);
+  return FitnessVectorAndGradient{error, f_of_x_and_gradient.second.col(0)};
+}
+
+FitnessVectorAndNormalEquations ExplicitRegression::GetFitnessVectorAndNormalEquations(
+    Equation &individual) const {
+  ++ eval_count_;
+  evaluation_backend::AccuracyScope accuracy(
+      evaluation_backend::ThreadWorkspace(), accuracy_);
+  const ExplicitTrainingData *data = (ExplicitTrainingData*)training_data_;
+  ResidualFunction residuals = [&](int start,
+                                   const Eigen::Ref<const Eigen::ArrayXXd> &f_of_x,
+                                   Eigen::Ref<Eigen::ArrayXd> error,
+                                   Eigen::Ref<Eigen::ArrayXXd> df_dc) {
+    auto y = data->y.col(0).segment(start, f_of_x.rows());
+    error = f_of_x.col(0) - y;
+    if (relative_) {
+      error /= y;
+      df_dc.colwise() /= y;
+    }
+  };
+  Eigen::ArrayXXd f_of_x;
+  Eigen::MatrixXd jacobian_product;
+  Eigen::VectorXd residual_product;
+  std::tie(f_of_x, jacobian_product, residual_product) =
+      individual.EvaluateEquationWithLocalOptNormalEquationsAt(data->x, residuals);
+
+  Eigen::ArrayXd error = f_of_x.col(0) - data->y.col(0);
+  if (relative_)
+    error /= data->y.col(0);
+  return FitnessVectorAndNormalEquations{error, jacobian_product, residual_product};
+}
+
 ExplicitRegressionState ExplicitRegression::DumpState() {
   return ExplicitRegressionState(
           ((ExplicitTrainingData*)training_data_)->DumpState(),
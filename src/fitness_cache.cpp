@@ -0,0 +1,128 @@
+#include <functional>
+#include <iterator>
+#include <string>
+
+#include "bingocpp/fitness_cache.h"
+
+namespace bingo {
+
+namespace {
+
+void hash_combine(std::size_t &seed, std::size_t value) {
+  seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+std::size_t hash_context(std::size_t seed,
+                         const FitnessCache::Context &context) {
+  for (const evaluation_backend::DatasetFingerprint &fingerprint :
+       std::get<0>(context)) {
+    hash_combine(seed, static_cast<std::size_t>(fingerprint.GetHash()));
+  }
+  hash_combine(seed, std::hash<int>()(std::get<1>(context)));
+  hash_combine(seed, std::hash<int>()(std::get<2>(context)));
+  hash_combine(seed, std::hash<std::string>()(std::get<3>(context)));
+  return seed;
+}
+} // namespace
+
+FitnessCache::FitnessCache(std::size_t capacity)
+    : capacity_(capacity), num_hits_(0), num_misses_(0) { }
+
+bool FitnessCache::Lookup(AGraph &individual, const Context &context,
+                          double &fitness) {
+  std::size_t hash = hash_context(individual.GetStructuralHash(), context);
+  std::lock_guard<std::mutex> lock(mutex_);
+  EntryIterator entry = find(individual, context, hash);
+  if (entry == entries_.end()) {
+    ++num_misses_;
+    return false;
+  }
+  entries_.splice(entries_.begin(), entries_, entry);
+  fitness = entry->fitness;
+  ++num_hits_;
+  return true;
+}
+
+void FitnessCache::Insert(AGraph &individual, const Context &context,
+                          double fitness) {
+  std::size_t hash = hash_context(individual.GetStructuralHash(), context);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (capacity_ == 0) {
+    return;
+  }
+  EntryIterator entry = find(individual, context, hash);
+  if (entry != entries_.end()) {
+    entries_.splice(entries_.begin(), entries_, entry);
+    entry->fitness = fitness;
+    return;
+  }
+  const Eigen::ArrayX3i &command_array =
+      individual.GetSimplifiedCommandArray();
+  if (!PackedCommandArray::CanPack(command_array)) {
+    return;
+  }
+  entries_.push_front(Entry{hash, context,
+                            PackedCommandArray(command_array),
+                            individual.GetLocalOptimizationParams(),
+                            fitness});
+  index_.emplace(hash, entries_.begin());
+  if (entries_.size() > capacity_) {
+    EntryIterator last = std::prev(entries_.end());
+    auto range = index_.equal_range(last->hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second == last) {
+        index_.erase(it);
+        break;
+      }
+    }
+    entries_.pop_back();
+  }
+}
+
+void FitnessCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  index_.clear();
+  num_hits_ = 0;
+  num_misses_ = 0;
+}
+
+std::size_t FitnessCache::GetCapacity() const {
+  return capacity_;
+}
+
+std::size_t FitnessCache::GetSize() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+long FitnessCache::GetNumHits() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return num_hits_;
+}
+
+long FitnessCache::GetNumMisses() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return num_misses_;
+}
+
+FitnessCache::EntryIterator FitnessCache::find(AGraph &individual,
+                                               const Context &context,
+                                               std::size_t hash) {
+  const Eigen::ArrayX3i &command_array =
+      individual.GetSimplifiedCommandArray();
+  const Eigen::ArrayXXd &constants = individual.GetLocalOptimizationParams();
+  auto range = index_.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    const Entry &entry = *it->second;
+    if (entry.context == context &&
+        entry.constants.rows() == constants.rows() &&
+        entry.constants.cols() == constants.cols() &&
+        entry.command_array.Matches(command_array) &&
+        (entry.constants == constants).all()) {
+      return it->second;
+    }
+  }
+  return entries_.end();
+}
+} // namespace bingo
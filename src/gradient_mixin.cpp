@@ -8,13 +8,16 @@ namespace bingo {
 VectorGradientMixin::VectorGradientMixin(TrainingData *training_data, std::string metric) {
   if (metric_functions::metric_found(metric_functions::kMeanAbsoluteError, metric)) {
     metric_function_ = metric_functions::mean_absolute_error;
-    metric_derivative_ = VectorGradientMixin::mean_absolute_error_derivative;
+    metric_seed_ = VectorGradientMixin::mean_absolute_error_seed;
+    metric_scale_ = VectorGradientMixin::mean_scale;
   } else if (metric_functions::metric_found(metric_functions::kMeanSquaredError, metric)) {
     metric_function_ = metric_functions::mean_squared_error;
-    metric_derivative_ = VectorGradientMixin::mean_squared_error_derivative;
+    metric_seed_ = VectorGradientMixin::mean_squared_error_seed;
+    metric_scale_ = VectorGradientMixin::mean_scale;
   } else if (metric_functions::metric_found(metric_functions::kRootMeanSquaredError, metric)) {
     metric_function_ = metric_functions::root_mean_squared_error;
-    metric_derivative_ = VectorGradientMixin::root_mean_squared_error_derivative;
+    metric_seed_ = VectorGradientMixin::root_mean_squared_error_seed;
+    metric_scale_ = VectorGradientMixin::root_mean_squared_error_scale;
   } else {
     throw std::invalid_argument("Invalid metric for VectorGradientMixin");
   }
@@ -22,10 +25,32 @@ VectorGradientMixin::VectorGradientMixin(TrainingData *training_data, std::strin
 
 FitnessAndGradient VectorGradientMixin::GetIndividualFitnessAndGradient(Equation &individual) const {
   Eigen::ArrayXd fitness_vector;
+  Eigen::ArrayXd gradient;
+  std::tie(fitness_vector, gradient) = this->GetFitnessVectorAndGradient(individual, metric_seed_);
+  double fitness = this->metric_function_(fitness_vector);
+  return FitnessAndGradient{fitness, gradient * metric_scale_(fitness_vector.size(), fitness)};
+}
+
+FitnessVectorAndGradient VectorGradientMixin::GetFitnessVectorAndGradient(
+    Equation &individual, const FitnessSeed &seed) const {
+  Eigen::ArrayXd fitness_vector;
   Eigen::ArrayXXd jacobian;
   std::tie(fitness_vector, jacobian) = this->GetFitnessVectorAndJacobian(individual);
-  double fitness = this->metric_function_(fitness_vector);
-  return FitnessAndGradient{fitness, metric_derivative_(fitness_vector, jacobian.transpose())};
+  Eigen::ArrayXd weights(fitness_vector.size());
+  seed(fitness_vector, weights);
+  Eigen::ArrayXd gradient = (jacobian.matrix().transpose() * weights.matrix()).array();
+  return FitnessVectorAndGradient{fitness_vector, gradient};
+}
+
+FitnessVectorAndNormalEquations VectorGradientMixin::GetFitnessVectorAndNormalEquations(
+    Equation &individual) const {
+  Eigen::ArrayXd fitness_vector;
+  Eigen::ArrayXXd jacobian;
+  std::tie(fitness_vector, jacobian) = this->GetFitnessVectorAndJacobian(individual);
+  return FitnessVectorAndNormalEquations{
+      fitness_vector,
+      jacobian.matrix().transpose() * jacobian.matrix(),
+      jacobian.matrix().transpose() * fitness_vector.matrix()};
 }
 
 } // namespace bingo
@@ -34,6 +34,8 @@ bool not_enough_parameters_used(int required_params,
 
 Eigen::ArrayXd ImplicitRegression::EvaluateFitnessVector(
     Equation &individual) const {
+  evaluation_backend::AccuracyScope accuracy(
+      evaluation_backend::ThreadWorkspace(), accuracy_);
   EvalAndDerivative eval_and_grad 
       = individual.EvaluateEquationWithXGradientAt(
       ((ImplicitTrainingData*)training_data_)->x);
@@ -56,6 +58,27 @@ Eigen::ArrayXd ImplicitRegression::EvaluateFitnessVector(
   });
 }
 
+std::vector<evaluation_backend::DatasetFingerprint>
+ImplicitRegression::FingerprintTrainingData() const {
+  const ImplicitTrainingData *data = (ImplicitTrainingData*)training_data_;
+  return {evaluation_backend::DatasetFingerprint(data->x),
+          evaluation_backend::DatasetFingerprint(data->dx_dt)};
+}
+
+std::string ImplicitRegression::GetConfiguration() const {
+  return VectorBasedFunction::GetConfiguration() + " " +
+         std::to_string(required_params_);
+}
+
+void ImplicitRegression::SetPrecision(
+    evaluation_backend::Precision precision) {
+  if (precision == evaluation_backend::kSingle) {
+    throw std::invalid_argument(
+        "ImplicitRegression has no single precision evaluation");
+  }
+  VectorBasedFunction::SetPrecision(precision);
+}
+
 Eigen::ArrayXXd dfdx_dot_dfdt(const Eigen::ArrayXXd &dx_dt,
                               const Eigen::ArrayXXd &grad) {
   Eigen::ArrayXXd left_dot = grad;
@@ -0,0 +1,296 @@
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+
+#include "bingocpp/agraph/operator_definitions.h"
+#include "bingocpp/population_evaluator.h"
+
+namespace bingo {
+
+namespace {
+
+void hash_combine(std::size_t &seed, std::size_t value) {
+  seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+std::size_t hash_individual(const AGraph &individual) {
+  const Eigen::ArrayX3i &command_array = individual.GetCommandArray();
+  const Eigen::ArrayXXd &constants = individual.GetLocalOptimizationParams();
+  std::size_t seed = command_array.rows();
+  for (Eigen::Index i = 0; i < command_array.size(); ++i) {
+    hash_combine(seed, std::hash<int>()(command_array.data()[i]));
+  }
+  for (Eigen::Index i = 0; i < constants.size(); ++i) {
+    hash_combine(seed, std::hash<double>()(constants.data()[i]));
+  }
+  return seed;
+}
+
+bool same_individual(const AGraph &first, const AGraph &second) {
+  const Eigen::ArrayX3i &first_commands = first.GetCommandArray();
+  const Eigen::ArrayX3i &second_commands = second.GetCommandArray();
+  const Eigen::ArrayXXd &first_constants = first.GetLocalOptimizationParams();
+  const Eigen::ArrayXXd &second_constants =
+      second.GetLocalOptimizationParams();
+  return first_commands.rows() == second_commands.rows() &&
+         first_constants.rows() == second_constants.rows() &&
+         first_constants.cols() == second_constants.cols() &&
+         (first_commands == second_commands).all() &&
+         (first_constants == second_constants).all();
+}
+
+// Relative cost of evaluating an individual, from its utilized commands
+double estimate_cost(const AGraph &individual) {
+  const Eigen::ArrayX3i &command_array = individual.GetCommandArray();
+  std::vector<bool> utilized = individual.GetUtilizedCommands();
+  double cost = 0.0;
+  for (int i = 0; i < command_array.rows(); ++i) {
+    if (!utilized[i]) {
+      continue;
+    }
+    switch (command_array(i, 0)) {
+      case Op::kInteger:
+      case Op::kVariable:
+      case Op::kConstant:
+        cost += 0.5;
+        break;
+      case Op::kAddition:
+      case Op::kSubtraction:
+      case Op::kMultiplication:
+      case Op::kAbs:
+        cost += 1.0;
+        break;
+      case Op::kDivision:
+      case Op::kSqrt:
+        cost += 2.0;
+        break;
+      default:
+        // transcendental operators
+        cost += 5.0;
+        break;
+    }
+  }
+  return cost;
+}
+
+// Gives individuals a subexpression cache, restoring their own caches when
+// it goes out of scope, also when a task throws
+class SubexpressionCacheScope {
+ public:
+  SubexpressionCacheScope(
+      const std::vector<AGraph *> &population,
+      const std::vector<int> &individuals,
+      const std::shared_ptr<evaluation_backend::SubexpressionCache> &cache)
+      : population_(population) {
+    previous_.reserve(individuals.size());
+    for (int i : individuals) {
+      previous_.emplace_back(i, population[i]->GetSubexpressionCache());
+      population[i]->SetSubexpressionCache(cache);
+    }
+  }
+  SubexpressionCacheScope(const SubexpressionCacheScope &) = delete;
+  SubexpressionCacheScope &operator=(const SubexpressionCacheScope &) = delete;
+  ~SubexpressionCacheScope() {
+    for (auto &individual : previous_) {
+      population_[individual.first]->SetSubexpressionCache(individual.second);
+    }
+  }
+
+ private:
+  const std::vector<AGraph *> &population_;
+  std::vector<std::pair<
+      int, std::shared_ptr<evaluation_backend::SubexpressionCache>>> previous_;
+};
+
+std::vector<AGraph *> as_pointers(std::vector<AGraph> &population) {
+  std::vector<AGraph *> pointers;
+  pointers.reserve(population.size());
+  for (AGraph &individual : population) {
+    pointers.push_back(&individual);
+  }
+  return pointers;
+}
+} // namespace
+
+PopulationEvaluator::PopulationEvaluator(int num_threads)
+    : num_evaluated_(0) {
+  if (num_threads != 1) {
+    pool_.reset(new WorkStealingPool(num_threads));
+  }
+}
+
+std::vector<Eigen::ArrayXXd> PopulationEvaluator::EvaluatePopulationAt(
+    std::vector<AGraph> &population, const Eigen::ArrayXXd &x) {
+  return EvaluatePopulationAt(as_pointers(population), x);
+}
+
+std::vector<Eigen::ArrayXXd> PopulationEvaluator::EvaluatePopulationAt(
+    const std::vector<AGraph *> &population, const Eigen::ArrayXXd &x) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  find_duplicates(population);
+  std::vector<int> individuals;
+  for (std::size_t i = 0; i < population.size(); ++i) {
+    if (representative_[i] == static_cast<int>(i)) {
+      individuals.push_back(i);
+    }
+  }
+  std::vector<Eigen::ArrayXXd> outputs(population.size());
+  run(population, individuals, [&](int i) {
+    outputs[i] = population[i]->EvaluateEquationAt(x);
+  });
+  for (std::size_t i = 0; i < population.size(); ++i) {
+    if (representative_[i] != static_cast<int>(i)) {
+      outputs[i] = outputs[representative_[i]];
+    }
+  }
+  num_evaluated_ = individuals.size();
+  return outputs;
+}
+
+Eigen::ArrayXd PopulationEvaluator::EvaluatePopulationFitness(
+    std::vector<AGraph> &population,
+    const FitnessFunction &fitness_function) {
+  return EvaluatePopulationFitness(as_pointers(population), fitness_function);
+}
+
+Eigen::ArrayXd PopulationEvaluator::EvaluatePopulationFitness(
+    const std::vector<AGraph *> &population,
+    const FitnessFunction &fitness_function) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  find_duplicates(population);
+  std::vector<int> individuals;
+  for (std::size_t i = 0; i < population.size(); ++i) {
+    if (representative_[i] == static_cast<int>(i) &&
+        !population[i]->IsFitnessSet()) {
+      individuals.push_back(i);
+    }
+  }
+  run(population, individuals, [&](int i) {
+    population[i]->SetFitness(
+        fitness_function.EvaluateIndividualFitness(*population[i]));
+  });
+  Eigen::ArrayXd fitness(population.size());
+  for (std::size_t i = 0; i < population.size(); ++i) {
+    AGraph &individual = *population[i];
+    if (!individual.IsFitnessSet()) {
+      // duplicates take the fitness of their representative
+      individual.SetFitness(population[representative_[i]]->GetFitness());
+    }
+    fitness(i) = individual.GetFitness();
+  }
+  num_evaluated_ = individuals.size();
+  return fitness;
+}
+
+std::vector<FitnessAndGradient>
+PopulationEvaluator::EvaluatePopulationFitnessAndGradient(
+    std::vector<AGraph> &population,
+    const GradientMixin &fitness_function) {
+  return EvaluatePopulationFitnessAndGradient(as_pointers(population),
+                                              fitness_function);
+}
+
+std::vector<FitnessAndGradient>
+PopulationEvaluator::EvaluatePopulationFitnessAndGradient(
+    const std::vector<AGraph *> &population,
+    const GradientMixin &fitness_function) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  find_duplicates(population);
+  std::vector<int> individuals;
+  for (std::size_t i = 0; i < population.size(); ++i) {
+    if (representative_[i] == static_cast<int>(i)) {
+      individuals.push_back(i);
+    }
+  }
+  std::vector<FitnessAndGradient> results(population.size());
+  run(population, individuals, [&](int i) {
+    results[i] = fitness_function.GetIndividualFitnessAndGradient(
+        *population[i]);
+  });
+  for (std::size_t i = 0; i < population.size(); ++i) {
+    if (representative_[i] != static_cast<int>(i)) {
+      results[i] = results[representative_[i]];
+    }
+  }
+  num_evaluated_ = individuals.size();
+  return results;
+}
+
+int PopulationEvaluator::GetNumThreads() const {
+  return pool_ ? pool_->GetNumThreads() : 1;
+}
+
+void PopulationEvaluator::SetSubexpressionCache(
+    std::shared_ptr<evaluation_backend::SubexpressionCache> cache) {
+  std::lock_guard<std::mutex> lock(cache_mutex_);
+  subexpression_cache_ = cache;
+}
+
+std::shared_ptr<evaluation_backend::SubexpressionCache>
+PopulationEvaluator::GetSubexpressionCache() const {
+  std::lock_guard<std::mutex> lock(cache_mutex_);
+  return subexpression_cache_;
+}
+
+int PopulationEvaluator::GetNumEvaluated() const {
+  return num_evaluated_;
+}
+
+void PopulationEvaluator::find_duplicates(
+    const std::vector<AGraph *> &population) {
+  std::unordered_multimap<std::size_t, int> seen;
+  seen.reserve(population.size());
+  representative_.resize(population.size());
+  for (std::size_t i = 0; i < population.size(); ++i) {
+    representative_[i] = i;
+    // brings simplified commands and constants up to date before comparing
+    population[i]->GetNumberLocalOptimizationParams();
+    std::size_t hash = hash_individual(*population[i]);
+    auto range = seen.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (same_individual(*population[it->second], *population[i])) {
+        representative_[i] = it->second;
+        break;
+      }
+    }
+    if (representative_[i] == static_cast<int>(i)) {
+      seen.emplace(hash, i);
+    }
+  }
+}
+
+void PopulationEvaluator::run(const std::vector<AGraph *> &population,
+                              const std::vector<int> &individuals,
+                              const std::function<void(int)> &task) {
+  std::shared_ptr<evaluation_backend::SubexpressionCache> cache =
+      GetSubexpressionCache();
+  if (cache) {
+    cache->NewGeneration();
+    SubexpressionCacheScope scope(population, individuals, cache);
+    run_tasks(population, individuals, task);
+    return;
+  }
+  run_tasks(population, individuals, task);
+}
+
+void PopulationEvaluator::run_tasks(const std::vector<AGraph *> &population,
+                                    const std::vector<int> &individuals,
+                                    const std::function<void(int)> &task) {
+  if (!pool_) {
+    for (int i : individuals) {
+      task(i);
+    }
+    return;
+  }
+  std::vector<double> costs(population.size());
+  for (int i : individuals) {
+    costs[i] = estimate_cost(*population[i]);
+  }
+  std::vector<int> order(individuals);
+  std::stable_sort(order.begin(), order.end(), [&costs](int a, int b) {
+    return costs[a] > costs[b];
+  });
+  pool_->Run(order, task);
+}
+} // namespace bingo
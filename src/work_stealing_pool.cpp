@@ -0,0 +1,126 @@
+#include <algorithm>
+
+#include "bingocpp/work_stealing_pool.h"
+
+namespace bingo {
+
+WorkStealingPool::WorkStealingPool(int num_threads)
+    : task_(nullptr), generation_(0), num_running_(0), stopping_(false) {
+  if (num_threads < 1) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (int i = 0; i < num_threads; ++i) {
+    queues_.emplace_back(new TaskQueue());
+  }
+  // worker 0 is whichever thread calls Run
+  for (int i = 1; i < num_threads; ++i) {
+    threads_.emplace_back(&WorkStealingPool::work_loop, this, i);
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  start_.notify_all();
+  for (std::thread &thread : threads_) {
+    thread.join();
+  }
+}
+
+int WorkStealingPool::GetNumThreads() const {
+  return queues_.size();
+}
+
+void WorkStealingPool::Run(const std::vector<int> &order,
+                           const std::function<void(int)> &task) {
+  if (order.empty()) {
+    return;
+  }
+  const int num_threads = queues_.size();
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    queues_[i % num_threads]->tasks.push_back(order[i]);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = &task;
+    error_ = nullptr;
+    num_running_ = threads_.size();
+    ++generation_;
+  }
+  start_.notify_all();
+
+  run_tasks(0);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this] { return num_running_ == 0; });
+  task_ = nullptr;
+  if (error_) {
+    std::exception_ptr error = error_;
+    error_ = nullptr;
+    std::rethrow_exception(error);
+  }
+}
+
+void WorkStealingPool::work_loop(int worker) {
+  long seen_generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_.wait(lock, [this, seen_generation] {
+        return stopping_ || generation_ != seen_generation;
+      });
+      if (stopping_) {
+        return;
+      }
+      seen_generation = generation_;
+    }
+    run_tasks(worker);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --num_running_;
+    }
+    done_.notify_one();
+  }
+}
+
+void WorkStealingPool::run_tasks(int worker) {
+  int task;
+  while (next_task(worker, task)) {
+    try {
+      (*task_)(task);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!error_) {
+        error_ = std::current_exception();
+      }
+    }
+  }
+}
+
+bool WorkStealingPool::next_task(int worker, int &task) {
+  const int num_threads = queues_.size();
+  {
+    TaskQueue &own = *queues_[worker];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = own.tasks.front();
+      own.tasks.pop_front();
+      return true;
+    }
+  }
+  // no tasks are added during a batch, so once every queue has been seen
+  // empty this worker is done
+  for (int i = 1; i < num_threads; ++i) {
+    TaskQueue &victim = *queues_[(worker + i) % num_threads];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = victim.tasks.back();
+      victim.tasks.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
+} // namespace bingo
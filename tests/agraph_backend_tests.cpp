@@ -1,10 +1,23 @@
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <cmath>
+#include <limits>
+#include <stdexcept>
 #include <vector>
 
 #include <Eigen/Dense>
 #include <gtest/gtest.h>
 
 #include <bingocpp/agraph/evaluation_backend/evaluation_backend.h>
+#include <bingocpp/agraph/evaluation_backend/fast_math.h>
+#include <bingocpp/agraph/evaluation_backend/folded_stack.h>
+#include <bingocpp/agraph/evaluation_backend/jit_compiler.h>
+#include <bingocpp/agraph/evaluation_backend/row_cache.h>
+#include <bingocpp/agraph/evaluation_backend/subexpression_cache.h>
+#include <bingocpp/agraph/operator_definitions.h>
+#include <bingocpp/agraph/packed_command_array.h>
 #include <bingocpp/agraph/simplification_backend/simplification_backend.h>
 
 #include "testing_utils.h"
@@ -178,6 +191,731 @@ TEST_F(AGraphBackend, evaluate_and_derivative) {
   ASSERT_TRUE(testutils::almost_equal(y_and_dy.second, dy_true));
 }
 
+TEST_F(AGraphBackend, evaluate_with_workspace) {
+  EvaluationWorkspace workspace;
+  Eigen::ArrayXXd y_true = x.col(0) * (constants(0,0) + constants(1,0)
+                          / x.col(1)) - x.col(0);
+  ASSERT_TRUE(testutils::almost_equal(
+      Evaluate(simple_stack, x, constants, workspace), y_true));
+  ASSERT_TRUE(testutils::almost_equal(
+      Evaluate(simple_stack2, x, constants, workspace),
+      Evaluate(simple_stack2, x, constants)));
+  ASSERT_TRUE(testutils::almost_equal(
+      Evaluate(simple_stack, x, constants_2d, workspace),
+      Evaluate(simple_stack, x, constants_2d)));
+}
+
+TEST_F(AGraphBackend, evaluate_and_derivative_with_workspace) {
+  EvaluationWorkspace workspace;
+  for (bool param_x_or_c : {true, false, true}) {
+    EvalAndDerivative expected =
+        EvaluateWithDerivative(simple_stack, x, constants, param_x_or_c);
+    const EvalAndDerivative &y_and_dy =
+        EvaluateWithDerivative(simple_stack, x, constants, param_x_or_c,
+                               workspace);
+    ASSERT_TRUE(testutils::almost_equal(y_and_dy.first, expected.first));
+    ASSERT_TRUE(testutils::almost_equal(y_and_dy.second, expected.second));
+  }
+}
+
+TEST_F(AGraphBackend, workspace_buffers_are_reused) {
+  EvaluationWorkspace workspace(simple_stack.rows(), x.rows());
+  const double *result_data = Evaluate(simple_stack, x, constants,
+                                       workspace).data();
+  const double *buffer_data = workspace.forward_eval[0].data();
+  Evaluate(simple_stack2, x, constants, workspace);
+  Evaluate(simple_stack, x, constants, workspace);
+  ASSERT_EQ(result_data, workspace.result.first.data());
+  ASSERT_EQ(buffer_data, workspace.forward_eval[0].data());
+}
+
+TEST_F(AGraphBackend, memory_budget_bounds_buffers) {
+  Eigen::ArrayXXd many_x = Eigen::ArrayXXd::Random(1000, 3) + 2;
+  const std::size_t budget = 4096;
+  EvaluationWorkspace bounded;
+  bounded.SetTileSize(0);
+  bounded.SetMemoryBudget(budget);
+  for (bool param_x_or_c : {true, false}) {
+    EvalAndDerivative expected =
+        EvaluateWithDerivative(simple_stack, many_x, constants, param_x_or_c);
+    const EvalAndDerivative &y_and_dy = EvaluateWithDerivative(
+        simple_stack, many_x, constants, param_x_or_c, bounded);
+    ASSERT_TRUE(testutils::almost_equal(y_and_dy.first, expected.first));
+    ASSERT_TRUE(testutils::almost_equal(y_and_dy.second, expected.second));
+    std::size_t buffer_bytes = 0;
+    for (const BufferView &buffer : bounded.forward_eval) {
+      buffer_bytes = std::max<std::size_t>(buffer_bytes,
+                                           buffer.size() * sizeof(double));
+    }
+    ASSERT_LE(2 * bounded.forward_eval.size() * buffer_bytes, budget);
+  }
+}
+
+TEST_F(AGraphBackend, tiled_evaluation_matches_untiled) {
+  Eigen::ArrayX3i constant_stack(3, 3);
+  constant_stack << 1, 0, 0,
+                    1, 1, 1,
+                    4, 0, 1;
+  EvaluationWorkspace untiled;
+  untiled.SetTileSize(0);
+  EvaluationWorkspace tiled;
+  tiled.SetTileSize(2);
+  for (const Eigen::ArrayX3i &stack : {simple_stack, simple_stack2,
+                                       constant_stack}) {
+    ASSERT_TRUE(testutils::almost_equal(
+        Evaluate(stack, x, constants, tiled),
+        Evaluate(stack, x, constants, untiled)));
+    ASSERT_TRUE(testutils::almost_equal(
+        Evaluate(stack, x, constants_2d, tiled),
+        Evaluate(stack, x, constants_2d, untiled)));
+    for (bool param_x_or_c : {true, false}) {
+      EvalAndDerivative expected = EvaluateWithDerivative(
+          stack, x, constants, param_x_or_c, untiled);
+      const EvalAndDerivative &y_and_dy = EvaluateWithDerivative(
+          stack, x, constants, param_x_or_c, tiled);
+      ASSERT_TRUE(testutils::almost_equal(y_and_dy.first, expected.first));
+      ASSERT_TRUE(testutils::almost_equal(y_and_dy.second, expected.second));
+    }
+  }
+}
+
+TEST_F(AGraphBackend, parallel_evaluation_matches_serial) {
+  Eigen::ArrayX3i constant_stack(3, 3);
+  constant_stack << 1, 0, 0,
+                    1, 1, 1,
+                    4, 0, 1;
+  EvaluationWorkspace serial;
+  serial.SetTileSize(2);
+  EvaluationWorkspace parallel;
+  parallel.SetTileSize(2);
+  parallel.SetNumThreads(3);
+  parallel.SetParallelThreshold(1);
+  ASSERT_EQ(parallel.GetNumThreads(), 3);
+  ASSERT_TRUE(parallel.IsParallel(x.rows()));
+  for (const Eigen::ArrayX3i &stack : {simple_stack, simple_stack2,
+                                       constant_stack}) {
+    for (const Eigen::ArrayXXd &c : {constants, constants_2d}) {
+      Eigen::ArrayXXd expected = Evaluate(stack, x, c, serial);
+      ASSERT_TRUE((Evaluate(stack, x, c, parallel) == expected).all());
+    }
+    for (bool param_x_or_c : {true, false}) {
+      EvalAndDerivative expected = EvaluateWithDerivative(
+          stack, x, constants, param_x_or_c, serial);
+      const EvalAndDerivative &y_and_dy = EvaluateWithDerivative(
+          stack, x, constants, param_x_or_c, parallel);
+      ASSERT_TRUE((y_and_dy.first == expected.first).all());
+      ASSERT_TRUE((y_and_dy.second == expected.second).all());
+    }
+  }
+}
+
+TEST_F(AGraphBackend, compiled_stack_resolves_shapes) {
+  Eigen::ArrayX3i stack(5, 3);
+  stack << -1, 2, 2,
+            0, 0, 0,
+            1, 0, 0,
+            4, 0, 2,
+            2, 1, 3;
+  CompiledStack program(stack);
+  std::vector<ShapeClass> expected_shapes = {kScalar, kColumn, kRow, kRow,
+                                             kMatrix};
+  ASSERT_EQ(program.value.instructions.size(), expected_shapes.size());
+  for (std::size_t i = 0; i < expected_shapes.size(); ++i) {
+    ASSERT_EQ(program.value.instructions[i].shape, expected_shapes[i]);
+  }
+
+  EvaluationWorkspace workspace;
+  Eigen::ArrayXXd y_true(3, 2);
+  y_true.col(0) = x.col(0) + 2 * constants_2d(0, 0);
+  y_true.col(1) = x.col(0) + 2 * constants_2d(0, 1);
+  ASSERT_TRUE(testutils::almost_equal(
+      Evaluate(program, x, constants_2d, workspace), y_true));
+}
+
+TEST_F(AGraphBackend, compiled_stack_matches_stack_evaluation) {
+  EvaluationWorkspace workspace;
+  for (const Eigen::ArrayX3i &stack : {simple_stack, simple_stack2}) {
+    CompiledStack program(stack);
+    ASSERT_TRUE(testutils::almost_equal(
+        Evaluate(program, x, constants, workspace),
+        Evaluate(stack, x, constants)));
+    for (bool param_x_or_c : {true, false}) {
+      EvalAndDerivative expected =
+          EvaluateWithDerivative(stack, x, constants, param_x_or_c);
+      const EvalAndDerivative &y_and_dy = EvaluateWithDerivative(
+          program, x, constants, param_x_or_c, workspace);
+      ASSERT_TRUE(testutils::almost_equal(y_and_dy.first, expected.first));
+      ASSERT_TRUE(testutils::almost_equal(y_and_dy.second, expected.second));
+    }
+  }
+}
+
+TEST_F(AGraphBackend, fused_chains_match_unfused_evaluation) {
+  // sin(x0 * c0 + x1) / x2
+  Eigen::ArrayX3i chain(8, 3);
+  chain << 0, 0, 0,
+           1, 0, 0,
+           4, 0, 1,
+           0, 1, 1,
+           2, 2, 3,
+           6, 4, 4,
+           0, 2, 2,
+           5, 5, 6;
+  // sin(x0 * c1) * (c0 * 3), the end of the chain reuses the buffer of
+  // c0 * 3
+  Eigen::ArrayX3i saved(8, 3);
+  saved << 1, 0, 0,
+          -1, 3, 3,
+           4, 0, 1,
+           0, 0, 0,
+           1, 1, 1,
+           4, 3, 4,
+           6, 5, 5,
+           4, 6, 2;
+  CompiledStack program(chain);
+  ASSERT_EQ(program.value.instructions.size(), 1u);
+  ASSERT_EQ(program.value.chains[0].steps.size(), 4u);
+  CompiledStack saved_program(saved);
+  ASSERT_EQ(saved_program.value.instructions.size(), 4u);
+  ASSERT_EQ(saved_program.value.chains[0].steps.back().operand.source,
+            kFromSaved);
+
+  Eigen::ArrayXXd x_large = Eigen::ArrayXXd::Random(100, 3);
+  Eigen::ArrayXXd chain_true(100, 2);
+  Eigen::ArrayXXd saved_true(100, 2);
+  for (int col = 0; col < 2; ++col) {
+    chain_true.col(col) = (x_large.col(0) * constants_2d(0, col) +
+                           x_large.col(1)).sin() / x_large.col(2);
+    saved_true.col(col) = (x_large.col(0) * constants_2d(1, col)).sin() *
+                          (constants_2d(0, col) * 3);
+  }
+  for (int tile_size : {0, 48}) {
+    EvaluationWorkspace workspace;
+    workspace.SetTileSize(tile_size);
+    ASSERT_TRUE(testutils::almost_equal(
+        Evaluate(program, x_large, constants_2d, workspace), chain_true));
+    ASSERT_TRUE(testutils::almost_equal(
+        Evaluate(saved_program, x_large, constants_2d, workspace),
+        saved_true));
+    // the derivative stream keeps every intermediate
+    for (const CompiledStack *compiled : {&program, &saved_program}) {
+      Eigen::ArrayXXd fused = Evaluate(*compiled, x_large, constants,
+                                       workspace);
+      const EvalAndDerivative &y_and_dy = EvaluateWithDerivative(
+          *compiled, x_large, constants, true, workspace);
+      ASSERT_TRUE(testutils::almost_equal(fused, y_and_dy.first));
+    }
+  }
+}
+
+TEST_F(AGraphBackend, batch_evaluation_matches_single_evaluations) {
+  std::vector<Eigen::ArrayX3i> stacks;
+  std::vector<Eigen::ArrayXXd> batch_constants;
+  for (int i = 0; i < 2 * kBatchWidth + 3; ++i) {
+    stacks.push_back(i % 3 == 0 ? simple_stack2 : simple_stack);
+    batch_constants.push_back(i % 5 == 0
+                                  ? Eigen::ArrayXXd(constants_2d)
+                                  : Eigen::ArrayXXd::Random(2, 1).eval());
+  }
+  EvaluationWorkspace workspace;
+  std::vector<Eigen::ArrayXXd> values;
+  EvaluateBatch(stacks, x, batch_constants, values, workspace);
+  ASSERT_EQ(values.size(), stacks.size());
+  for (std::size_t i = 0; i < stacks.size(); ++i) {
+    ASSERT_TRUE(testutils::almost_equal(
+        values[i], Evaluate(stacks[i], x, batch_constants[i])));
+  }
+
+  batch_constants.pop_back();
+  ASSERT_THROW(EvaluateBatch(stacks, x, batch_constants, values, workspace),
+               std::invalid_argument);
+}
+
+TEST_F(AGraphBackend, single_precision_matches_double_precision) {
+  Eigen::ArrayXXf x_single = x.cast<float>();
+  EvaluationWorkspace workspace;
+  workspace.SetTileSize(2);
+  for (const Eigen::ArrayX3i &stack : {simple_stack, simple_stack2}) {
+    for (const Eigen::ArrayXXd &c : {constants, constants_2d}) {
+      Eigen::ArrayXXd y_single =
+          EvaluateSingle(stack, x_single, c, workspace).cast<double>();
+      ASSERT_TRUE(testutils::almost_equal(y_single, Evaluate(stack, x, c),
+                                          1e-4));
+    }
+  }
+}
+
+TEST_F(AGraphBackend, forward_mode_matches_reverse_mode) {
+  EvaluationWorkspace forward;
+  forward.SetDerivativeMode(kForwardMode);
+  forward.SetTileSize(2);
+  EvaluationWorkspace reverse;
+  reverse.SetDerivativeMode(kReverseMode);
+  std::vector<Eigen::ArrayX3i> stacks = {simple_stack, simple_stack2};
+  for (int op : {Op::kSin, Op::kCos, Op::kExponential, Op::kLogarithm,
+                 Op::kAbs, Op::kSqrt, Op::kSinh, Op::kCosh}) {
+    stacks.push_back(testutils::stack_unary_operator(op));
+  }
+  for (int op : {Op::kAddition, Op::kSubtraction, Op::kMultiplication,
+                 Op::kDivision, Op::kPower, Op::kSafePower}) {
+    stacks.push_back(testutils::stack_binary_operator(op));
+  }
+  for (const Eigen::ArrayX3i &stack : stacks) {
+    for (bool param_x_or_c : {true, false}) {
+      EvalAndDerivative expected =
+          EvaluateWithDerivative(stack, x, constants, param_x_or_c, reverse);
+      const EvalAndDerivative &y_and_dy =
+          EvaluateWithDerivative(stack, x, constants, param_x_or_c, forward);
+      ASSERT_TRUE(testutils::almost_equal(y_and_dy.first, expected.first));
+      ASSERT_TRUE(testutils::almost_equal(y_and_dy.second, expected.second));
+    }
+  }
+}
+
+TEST_F(AGraphBackend, vector_jacobian_product_matches_reduced_jacobian) {
+  Eigen::ArrayXd y = Eigen::ArrayXd::Random(x.rows());
+  SeedFunction seed = [&](int start,
+                          const Eigen::Ref<const Eigen::ArrayXXd> &values,
+                          Eigen::Ref<Eigen::ArrayXd> weights) {
+    weights = 2.0 * (values.col(0) - y.segment(start, values.rows()));
+  };
+  EvaluationWorkspace workspace;
+  workspace.SetTileSize(2);
+  for (const Eigen::ArrayX3i &stack : {simple_stack, simple_stack2}) {
+    EvalAndDerivative expected =
+        EvaluateWithDerivative(stack, x, constants, false);
+    Eigen::ArrayXd weights = 2.0 * (expected.first.col(0) - y);
+    Eigen::ArrayXXd product =
+        (expected.second.matrix().transpose() * weights.matrix()).array();
+    const EvalAndDerivative &result =
+        EvaluateVectorJacobianProduct(stack, x, constants, seed, workspace);
+    ASSERT_TRUE(testutils::almost_equal(result.first, expected.first));
+    ASSERT_TRUE(testutils::almost_equal(result.second, product));
+  }
+}
+
+TEST_F(AGraphBackend, normal_equations_match_jacobian_products) {
+  Eigen::ArrayXd y = Eigen::ArrayXd::Random(x.rows());
+  ResidualFunction residuals = [&](int start,
+                                   const Eigen::Ref<const Eigen::ArrayXXd> &values,
+                                   Eigen::Ref<Eigen::ArrayXd> residual,
+                                   Eigen::Ref<Eigen::ArrayXXd>) {
+    residual = values.col(0) - y.segment(start, values.rows());
+  };
+  EvaluationWorkspace workspace;
+  workspace.SetTileSize(2);
+  for (const Eigen::ArrayX3i &stack : {simple_stack, simple_stack2}) {
+    EvalAndDerivative expected =
+        EvaluateWithDerivative(stack, x, constants, false);
+    Eigen::MatrixXd jacobian = expected.second.matrix();
+    Eigen::VectorXd residual = (expected.first.col(0) - y).matrix();
+    const EvalAndNormalEquations &result =
+        EvaluateNormalEquations(stack, x, constants, residuals, workspace);
+    ASSERT_TRUE(testutils::almost_equal(std::get<0>(result), expected.first));
+    ASSERT_TRUE(testutils::almost_equal(std::get<1>(result).array(),
+                                        (jacobian.transpose() * jacobian).array()));
+    ASSERT_TRUE(testutils::almost_equal(std::get<2>(result).array(),
+                                        (jacobian.transpose() * residual).array()));
+  }
+}
+
+TEST_F(AGraphBackend, constant_sets_match_single_set_evaluations) {
+  const int num_sets = 5;
+  Eigen::ArrayXXd constant_sets = Eigen::ArrayXXd::Random(2, num_sets) + 2;
+  EvaluationWorkspace workspace;
+  workspace.SetTileSize(2);
+  for (const Eigen::ArrayX3i &stack : {simple_stack, simple_stack2}) {
+    EvalAndDerivative sets =
+        EvaluateConstantSets(stack, x, constant_sets, workspace);
+    ASSERT_EQ(sets.first.cols(), num_sets);
+    ASSERT_EQ(sets.second.cols(), num_sets * constant_sets.rows());
+    for (int set = 0; set < num_sets; ++set) {
+      Eigen::ArrayXXd c = constant_sets.col(set);
+      EvalAndDerivative single = EvaluateWithDerivative(stack, x, c, false);
+      ASSERT_TRUE(testutils::almost_equal(sets.first.col(set),
+                                          single.first));
+      ASSERT_TRUE(testutils::almost_equal(
+          sets.second.middleCols(set * c.rows(), c.rows()), single.second));
+    }
+  }
+}
+
+TEST_F(AGraphBackend, packed_stacks_simplify_like_unpacked_stacks) {
+  PackedCommandArray packed(simple_stack);
+  ASSERT_TRUE((packed.Unpack() == simple_stack).all());
+  ASSERT_TRUE(packed.Matches(simple_stack));
+  ASSERT_EQ(GetUtilizedCommands(packed), GetUtilizedCommands(simple_stack));
+  ASSERT_TRUE(SimplifyStack(packed).Matches(SimplifyStack(simple_stack)));
+  ASSERT_LT(packed.GetMemoryUsage(),
+            static_cast<std::size_t>(simple_stack.size()) * sizeof(int));
+
+  Eigen::ArrayX3i wide_stack = simple_stack;
+  wide_stack(0, 1) = 1 << 16;
+  ASSERT_FALSE(PackedCommandArray::CanPack(wide_stack));
+  ASSERT_THROW(PackedCommandArray packed_wide(wide_stack), std::out_of_range);
+}
+
+TEST_F(AGraphBackend, buffer_assignment_skips_unused_rows) {
+  BufferAssignment assignment;
+  AssignBuffers(simple_stack, true, assignment);
+  std::vector<bool> used_commands = GetUtilizedCommands(simple_stack);
+  for (int i = 0; i < simple_stack.rows(); ++i) {
+    ASSERT_EQ(assignment.last_use[i] >= 0, used_commands[i]);
+  }
+}
+
+TEST_F(AGraphBackend, buffer_assignment_reuses_buffers) {
+  Eigen::ArrayX3i chain(6, 3);
+  chain << 0, 0, 0,
+           6, 0, 0,
+           6, 1, 1,
+           2, 2, 0,
+           6, 3, 3,
+           6, 4, 4;
+  BufferAssignment assignment;
+  AssignBuffers(chain, false, assignment);
+  ASSERT_EQ(assignment.num_forward_buffers, 2);
+
+  AssignBuffers(chain, true, assignment);
+  ASSERT_EQ(assignment.num_forward_buffers, 5);
+  ASSERT_EQ(assignment.num_reverse_buffers, 3);
+
+  Eigen::ArrayXXd y_true = ((x.col(0).sin().sin() + x.col(0)).sin()).sin();
+  Eigen::ArrayXXd dy_true = Eigen::ArrayXXd::Zero(3, 3);
+  dy_true.col(0) = (x.col(0).sin().sin() + x.col(0)).sin().cos()
+                   * (x.col(0).sin().sin() + x.col(0)).cos()
+                   * (x.col(0).sin().cos() * x.col(0).cos() + 1.);
+  EvalAndDerivative y_and_dy =
+    EvaluateWithDerivative(chain, x, constants, true);
+  ASSERT_TRUE(testutils::almost_equal(Evaluate(chain, x, constants), y_true));
+  ASSERT_TRUE(testutils::almost_equal(y_and_dy.first, y_true));
+  ASSERT_TRUE(testutils::almost_equal(y_and_dy.second, dy_true));
+}
+
+TEST_F(AGraphBackend, folded_stack_matches_stack_evaluation) {
+  // c0 * exp(c1 / c2) * x0
+  Eigen::ArrayX3i stack(8, 3);
+  stack << 1, 0, 0,
+           1, 1, 1,
+           1, 2, 2,
+           5, 1, 2,
+           8, 3, 3,
+           4, 0, 4,
+           0, 0, 0,
+           4, 5, 6;
+  Eigen::ArrayXXd c(3, 1);
+  c << 2.0, 1.5, 3.0;
+  EvaluationWorkspace workspace;
+  FoldedStack folded;
+  folded.Compile(stack, c.rows());
+  ASSERT_EQ(folded.GetNumFolded(), 1);
+
+  for (int i = 0; i < 2; ++i) {
+    const Eigen::ArrayXXd &program_constants = folded.Fold(c, workspace);
+    ASSERT_TRUE(testutils::almost_equal(
+        Evaluate(folded.GetProgram(), x, program_constants, workspace),
+        Evaluate(stack, x, c)));
+
+    EvalAndDerivative expected = EvaluateWithDerivative(stack, x, c, true);
+    const EvalAndDerivative &df_dx = EvaluateWithDerivative(
+        folded.GetProgram(), x, program_constants, true, workspace);
+    ASSERT_TRUE(testutils::almost_equal(df_dx.second, expected.second));
+
+    expected = EvaluateWithDerivative(stack, x, c, false);
+    const EvalAndDerivative &df_dc = EvaluateWithDerivative(
+        folded.GetProgram(), x, program_constants, false, workspace);
+    ASSERT_TRUE(testutils::almost_equal(
+        folded.ConstantDerivative(df_dc.second), expected.second));
+    // folded values are refreshed when the constants change
+    c(1, 0) = -0.5;
+  }
+}
+
+TEST_F(AGraphBackend, folded_stack_refolds_for_another_accuracy) {
+  // sin(c0) * x0
+  Eigen::ArrayX3i stack(4, 3);
+  stack << Op::kConstant, 0, 0,
+           Op::kSin, 0, 0,
+           Op::kVariable, 0, 0,
+           Op::kMultiplication, 1, 2;
+  Eigen::ArrayXXd c(1, 1);
+  c << 1.2;
+  EvaluationWorkspace strict;
+  EvaluationWorkspace fast;
+  fast.SetAccuracy(kFast);
+  FoldedStack folded;
+  folded.Compile(stack, c.rows());
+  FoldedStack expected;
+  expected.Compile(stack, c.rows());
+
+  folded.Fold(c, fast);
+  ASSERT_TRUE((folded.Fold(c, strict) == expected.Fold(c, strict)).all());
+}
+
+TEST_F(AGraphBackend, forward_tape_derivatives_match_evaluation) {
+  EvaluationWorkspace workspace;
+  workspace.SetTileSize(2);
+  CompiledStack program;
+  program.Compile(simple_stack);
+  std::shared_ptr<const ForwardTape> tape;
+  ASSERT_TRUE(testutils::almost_equal(
+      EvaluateAndRecord(program, x, constants, 1 << 20, tape, workspace),
+      Evaluate(simple_stack, x, constants)));
+  ASSERT_TRUE(tape && tape->IsTapeOf(x, constants, workspace.GetAccuracy()));
+  for (bool param_x_or_c : {true, false}) {
+    EvalAndDerivative expected =
+        EvaluateWithDerivative(simple_stack, x, constants, param_x_or_c);
+    const EvalAndDerivative &y_and_dy =
+        EvaluateWithDerivative(program, *tape, param_x_or_c, workspace);
+    ASSERT_TRUE(testutils::almost_equal(y_and_dy.first, expected.first));
+    ASSERT_TRUE(testutils::almost_equal(y_and_dy.second, expected.second));
+  }
+
+  EvaluateAndRecord(program, x, constants, 1, tape, workspace);
+  ASSERT_EQ(tape, nullptr);
+}
+
+TEST_F(AGraphBackend, row_cache_reevaluates_changed_rows) {
+  // c0 * exp(c1 / c2) * x0
+  Eigen::ArrayX3i stack(8, 3);
+  stack << 1, 0, 0,
+           1, 1, 1,
+           1, 2, 2,
+           5, 1, 2,
+           8, 3, 3,
+           4, 0, 4,
+           0, 0, 0,
+           4, 5, 6;
+  Eigen::ArrayXXd c(3, 1);
+  c << 2.0, 1.5, 3.0;
+  EvaluationWorkspace workspace;
+  workspace.SetTileSize(2);
+  std::shared_ptr<const RowCache> parent =
+      EvaluateRows(stack, x, c, nullptr, workspace);
+  ASSERT_EQ(parent->GetNumReused(), 0);
+  ASSERT_TRUE(testutils::almost_equal(parent->GetValue(),
+                                      Evaluate(stack, x, c)));
+
+  // only the output row depends on the mutated variable
+  stack.row(6) << 0, 1, 1;
+  std::shared_ptr<const RowCache> child =
+      EvaluateRows(stack, x, c, parent, workspace);
+  ASSERT_EQ(child->GetNumReused(), 6);
+  ASSERT_TRUE(testutils::almost_equal(child->GetValue(),
+                                      Evaluate(stack, x, c)));
+
+  // a new constant value invalidates the rows downstream of it
+  c(1, 0) = -0.5;
+  std::shared_ptr<const RowCache> grandchild =
+      EvaluateRows(stack, x, c, child, workspace);
+  ASSERT_EQ(grandchild->GetNumReused(), 3);
+  ASSERT_TRUE(testutils::almost_equal(grandchild->GetValue(),
+                                      Evaluate(stack, x, c)));
+
+  // the same samples in other storage are the same dataset, a rewritten
+  // interior sample is not
+  Eigen::ArrayXXd other_x = x;
+  ASSERT_EQ(EvaluateRows(stack, other_x, c, grandchild,
+                         workspace)->GetNumReused(), 8);
+  other_x(other_x.rows() / 2, 0) += 1.0;
+  std::shared_ptr<const RowCache> rewritten =
+      EvaluateRows(stack, other_x, c, grandchild, workspace);
+  ASSERT_EQ(rewritten->GetNumReused(), 0);
+  ASSERT_TRUE(testutils::almost_equal(rewritten->GetValue(),
+                                      Evaluate(stack, other_x, c)));
+}
+
+TEST_F(AGraphBackend, subexpression_cache_shares_subtrees_between_stacks) {
+  // sin(x0 * x1) + c0
+  Eigen::ArrayX3i first(6, 3);
+  first << 0, 0, 0,
+           0, 1, 1,
+           4, 0, 1,
+           6, 2, 2,
+           1, 0, 0,
+           2, 3, 4;
+  // cos(sin(x1 * x0)), the shared subtree in other rows and order
+  Eigen::ArrayX3i second(5, 3);
+  second << 0, 1, 1,
+            0, 0, 0,
+            4, 0, 1,
+            6, 2, 2,
+            7, 3, 3;
+  // x0 * x1 + x1 * x0
+  Eigen::ArrayX3i third(5, 3);
+  third << 0, 0, 0,
+           0, 1, 1,
+           4, 0, 1,
+           4, 1, 0,
+           2, 2, 3;
+  Eigen::ArrayXXd c(1, 1);
+  c << 2.0;
+  EvaluationWorkspace workspace;
+  workspace.SetTileSize(2);
+  SubexpressionCache cache;
+  ASSERT_TRUE(testutils::almost_equal(
+      EvaluateShared(first, x, c, cache, workspace), Evaluate(first, x, c)));
+  ASSERT_EQ(cache.GetNumHits(), 0);
+  ASSERT_EQ(cache.GetNumMisses(), 3);
+
+  // only the cos row is evaluated
+  ASSERT_TRUE(testutils::almost_equal(
+      EvaluateShared(second, x, c, cache, workspace), Evaluate(second, x, c)));
+  ASSERT_EQ(cache.GetNumHits(), 1);
+  ASSERT_EQ(cache.GetNumMisses(), 4);
+
+  // identical rows are looked up once
+  ASSERT_TRUE(testutils::almost_equal(
+      EvaluateShared(third, x, c, cache, workspace), Evaluate(third, x, c)));
+  ASSERT_EQ(cache.GetNumHits(), 2);
+  ASSERT_EQ(cache.GetNumMisses(), 5);
+
+  // values unused for a whole generation are dropped
+  cache.NewGeneration();
+  ASSERT_GT(cache.GetMemoryUsage(), 0u);
+  cache.NewGeneration();
+  ASSERT_EQ(cache.GetMemoryUsage(), 0u);
+
+  // nothing is kept without a budget
+  SubexpressionCache empty(0);
+  EvaluateShared(first, x, c, empty, workspace);
+  EvaluateShared(first, x, c, empty, workspace);
+  ASSERT_EQ(empty.GetNumHits(), 0);
+  ASSERT_EQ(empty.GetNumMisses(), 6);
+}
+
+TEST_F(AGraphBackend, fast_accuracy_matches_strict) {
+  EvaluationWorkspace strict;
+  EvaluationWorkspace fast;
+  fast.SetAccuracy(kFast);
+  std::vector<Eigen::ArrayX3i> stacks;
+  for (int op : {Op::kSin, Op::kCos, Op::kSinh, Op::kCosh}) {
+    stacks.push_back(testutils::stack_unary_operator(op));
+  }
+  for (int op : {Op::kPower, Op::kSafePower}) {
+    stacks.push_back(testutils::stack_binary_operator(op));
+  }
+  for (const Eigen::ArrayX3i &stack : stacks) {
+    ASSERT_TRUE(testutils::almost_equal(
+        Evaluate(stack, x, constants, fast),
+        Evaluate(stack, x, constants, strict)));
+    for (bool param_x_or_c : {true, false}) {
+      EvalAndDerivative expected =
+          EvaluateWithDerivative(stack, x, constants, param_x_or_c, strict);
+      const EvalAndDerivative &y_and_dy =
+          EvaluateWithDerivative(stack, x, constants, param_x_or_c, fast);
+      ASSERT_TRUE(testutils::almost_equal(y_and_dy.first, expected.first));
+      ASSERT_TRUE(testutils::almost_equal(y_and_dy.second, expected.second));
+    }
+  }
+}
+
+TEST_F(AGraphBackend, jit_compiled_stack_matches_interpreter) {
+  std::vector<Eigen::ArrayX3i> stacks = {simple_stack};
+  for (int op = Op::kSin; op <= Op::kCosh; ++op) {
+    if (op == Op::kPower || op == Op::kSafePower) {
+      stacks.push_back(testutils::stack_binary_operator(op));
+    } else {
+      stacks.push_back(testutils::stack_unary_operator(op));
+    }
+  }
+  EvaluationWorkspace workspace;
+  for (const Eigen::ArrayX3i &stack : stacks) {
+    std::shared_ptr<const JitFunction> function = JitCompile(stack);
+    if (!function) {
+      GTEST_SKIP() << "no C++ compiler available at runtime";
+    }
+    ASSERT_EQ(function, JitCompile(stack));
+    Eigen::ArrayXXd value;
+    function->Evaluate(x, constants, value);
+    ASSERT_TRUE(testutils::almost_equal(
+        value, Evaluate(stack, x, constants, workspace)));
+    EvalAndDerivative result;
+    function->EvaluateWithConstantDerivative(x, constants, result);
+    const EvalAndDerivative &expected =
+        EvaluateWithDerivative(stack, x, constants, false, workspace);
+    ASSERT_TRUE(testutils::almost_equal(result.first, expected.first));
+    ASSERT_TRUE(testutils::almost_equal(result.second, expected.second));
+  }
+}
+
+TEST_F(AGraphBackend, jit_compile_failure_returns_null) {
+  SetJitCompiler("false");
+  Eigen::ArrayX3i stack = testutils::stack_binary_operator(Op::kAddition, 1, 0);
+  ASSERT_EQ(JitCompile(stack), nullptr);
+  SetJitCompiler("c++ -O2 -fPIC -shared");
+}
+
+TEST_F(AGraphBackend, jit_cache_evicts_least_recently_used_stack) {
+  Eigen::ArrayX3i first = testutils::stack_binary_operator(Op::kAddition);
+  Eigen::ArrayX3i second =
+      testutils::stack_binary_operator(Op::kSubtraction);
+  std::size_t capacity = GetJitCacheCapacity();
+  SetJitCacheCapacity(1);
+  std::shared_ptr<const JitFunction> function = JitCompile(first);
+  if (!function) {
+    SetJitCacheCapacity(capacity);
+    GTEST_SKIP() << "no C++ compiler available at runtime";
+  }
+  ASSERT_EQ(JitCompile(first), function);
+  ASSERT_NE(JitCompile(second), nullptr);
+  // the evicted function is still usable, but compiled anew
+  ASSERT_NE(JitCompile(first), function);
+  Eigen::ArrayXXd value;
+  function->Evaluate(x, constants, value);
+  ASSERT_TRUE(testutils::almost_equal(value, Evaluate(first, x, constants)));
+  SetJitCacheCapacity(capacity);
+}
+
+TEST_F(AGraphBackend, jit_compiles_in_temporary_directory_with_spaces) {
+  std::string directory = "/tmp/bingocpp jit; test";
+  mkdir(directory.c_str(), 0700);
+  const char *tmpdir = getenv("TMPDIR");
+  std::string previous = tmpdir != nullptr ? tmpdir : "";
+  setenv("TMPDIR", directory.c_str(), 1);
+  Eigen::ArrayX3i stack =
+      testutils::stack_binary_operator(Op::kMultiplication, 1, 0);
+  std::shared_ptr<const JitFunction> function = JitCompile(stack);
+  if (tmpdir != nullptr) {
+    setenv("TMPDIR", previous.c_str(), 1);
+  } else {
+    unsetenv("TMPDIR");
+  }
+  rmdir(directory.c_str());
+  if (!function && !JitCompile(simple_stack)) {
+    GTEST_SKIP() << "no C++ compiler available at runtime";
+  }
+  ASSERT_NE(function, nullptr);
+  Eigen::ArrayXXd value;
+  function->Evaluate(x, constants, value);
+  ASSERT_TRUE(testutils::almost_equal(value, Evaluate(stack, x, constants)));
+}
+
+TEST_F(AGraphBackend, fast_math_is_within_a_few_ulp) {
+  Eigen::ArrayXd values = Eigen::ArrayXd::LinSpaced(10001, -50, 50);
+  auto max_relative_error = [](const Eigen::ArrayXd &actual,
+                               const Eigen::ArrayXd &expected) {
+    return ((actual - expected).abs() / expected.abs().max(1.0)).maxCoeff();
+  };
+  const double tolerance = 8 * std::numeric_limits<double>::epsilon();
+  ASSERT_LT(max_relative_error(values.unaryExpr(FastSinOp()), values.sin()),
+            tolerance);
+  ASSERT_LT(max_relative_error(values.unaryExpr(FastCosOp()), values.cos()),
+            tolerance);
+  ASSERT_LT(max_relative_error(values.unaryExpr(FastSinhOp()), values.sinh()),
+            tolerance);
+  ASSERT_LT(max_relative_error(values.unaryExpr(FastCoshOp()), values.cosh()),
+            tolerance);
+
+  Eigen::ArrayXd base(8);
+  Eigen::ArrayXd exponent(8);
+  base << -2, -2, -2, 0, 0, 1, 3.5, -0.5;
+  exponent << 3, 2, 0.5, 0, -1, std::numeric_limits<double>::quiet_NaN(),
+              2.2, -3;
+  ASSERT_TRUE(testutils::almost_equal(base.binaryExpr(exponent, FastPowOp()),
+                                      base.pow(exponent)));
+}
+
 TEST_F(AGraphBackend, get_utilized_commands) {
   std::vector<bool> used_commands = GetUtilizedCommands(simple_stack);
   int num_used_commands = 0;
@@ -131,6 +131,72 @@ namespace
     ASSERT_DOUBLE_EQ(agraph_copy.GetLocalOptimizationParams()(0, 0), 1.0);
   }
 
+  TEST_F(AGraphTest, copy_shares_arrays_until_modified)
+  {
+    AGraph agraph_copy = sample_agraph_1.Copy();
+    ASSERT_EQ(&agraph_copy.GetCommandArray(),
+              &sample_agraph_1.GetCommandArray());
+    ASSERT_EQ(&agraph_copy.GetLocalOptimizationParams(),
+              &sample_agraph_1.GetLocalOptimizationParams());
+
+    Eigen::ArrayX3i &command_array = agraph_copy.GetCommandArrayModifiable();
+    ASSERT_NE(&command_array, &sample_agraph_1.GetCommandArray());
+    command_array(1, 1) = 100;
+    ASSERT_EQ(sample_agraph_1.GetCommandArray()(1, 1), 0);
+
+    // writes through a held reference do not reach later copies
+    AGraph second_copy = agraph_copy.Copy();
+    ASSERT_EQ(second_copy.GetCommandArray()(1, 1), 100);
+    command_array(1, 2) = 100;
+    ASSERT_EQ(second_copy.GetCommandArray()(1, 2), 0);
+    ASSERT_EQ(agraph_copy.GetCommandArray()(1, 2), 100);
+    AGraph assigned = sample_agraph_1;
+    assigned = agraph_copy;
+    command_array(1, 2) = 50;
+    ASSERT_EQ(assigned.GetCommandArray()(1, 2), 100);
+
+    // once updated, the modified array is shared by copies again
+    agraph_copy.GetSimplifiedCommandArray();
+    AGraph third_copy = agraph_copy.Copy();
+    ASSERT_EQ(&third_copy.GetCommandArray(), &agraph_copy.GetCommandArray());
+
+    Eigen::ArrayXXd constants = agraph_copy.GetLocalOptimizationParams();
+    constants(0, 0) = 100;
+    agraph_copy.SetLocalOptimizationParams(constants);
+    ASSERT_DOUBLE_EQ(sample_agraph_1.GetLocalOptimizationParams()(0, 0), 1.0);
+    ASSERT_DOUBLE_EQ(second_copy.GetLocalOptimizationParams()(0, 0), 1.0);
+  }
+
+  TEST_F(AGraphTest, compact_agraph_keeps_its_equation)
+  {
+    AGraph agraph = sample_agraph_1.Copy();
+    Eigen::ArrayX3i command_array = agraph.GetCommandArray();
+    std::vector<bool> utilized_commands = agraph.GetUtilizedCommands();
+    ASSERT_TRUE(agraph.Compact());
+    ASSERT_TRUE(agraph.IsCompact());
+    ASSERT_TRUE((agraph.GetCommandArray() == command_array).all());
+    ASSERT_EQ(agraph.GetUtilizedCommands(), utilized_commands);
+    ASSERT_TRUE(agraph.IsFitnessSet() == sample_agraph_1.IsFitnessSet());
+
+    AGraph loaded = AGraph(agraph.DumpState());
+    ASSERT_TRUE((loaded.GetSimplifiedCommandArray() ==
+                 sample_agraph_1.GetSimplifiedCommandArray())
+                    .all());
+
+    AGraph agraph_copy = agraph.Copy();
+    ASSERT_TRUE(agraph_copy.IsCompact());
+    ASSERT_TRUE(testutils::almost_equal(
+        sample_agraph_1_values.f_of_x,
+        agraph_copy.EvaluateEquationAt(sample_agraph_1_values.x)));
+    ASSERT_FALSE(agraph_copy.IsCompact());
+    ASSERT_TRUE(agraph.IsCompact());
+
+    agraph.GetCommandArrayModifiable()(1, 1) = 1;
+    ASSERT_FALSE(agraph.IsCompact());
+    ASSERT_EQ(agraph.GetCommandArray()(1, 1), 1);
+    ASSERT_EQ(agraph_copy.GetCommandArray()(1, 1), command_array(1, 1));
+  }
+
   TEST_F(AGraphTest, dump_load)
   {
     AGraph agraph_copy = AGraph(sample_agraph_1.DumpState());
@@ -220,6 +286,90 @@ namespace
     ASSERT_TRUE(testutils::almost_equal(sample_agraph_1_values.grad_c, df_dc));
   }
 
+  TEST_F(AGraphTest, jit_compiled_evaluation_matches_interpreter)
+  {
+    Eigen::ArrayXXd x = sample_agraph_1_values.x;
+    EvalAndDerivative expected =
+        sample_agraph_1.EvaluateEquationWithLocalOptGradientAt(x);
+    AGraph::SetJitThreshold(2);
+    for (int i = 0; i < 4; ++i)
+    {
+      ASSERT_TRUE(testutils::almost_equal(
+          expected.first, sample_agraph_1.EvaluateEquationAt(x)));
+      EvalAndDerivative result =
+          sample_agraph_1.EvaluateEquationWithLocalOptGradientAt(x);
+      ASSERT_TRUE(testutils::almost_equal(expected.first, result.first));
+      ASSERT_TRUE(testutils::almost_equal(expected.second, result.second));
+    }
+    AGraph::SetJitThreshold(-1);
+  }
+
+  TEST_F(AGraphTest, row_cached_evaluation_matches_interpreter)
+  {
+    Eigen::ArrayXXd x = sample_agraph_1_values.x;
+    AGraph::SetRowCaching(true);
+    ASSERT_TRUE(testutils::almost_equal(
+        sample_agraph_1_values.f_of_x, sample_agraph_1.EvaluateEquationAt(x)));
+    AGraph mutated = sample_agraph_1.Copy();
+    mutated.GetCommandArrayModifiable().row(2) << 6, 1, 0;
+    Eigen::ArrayXXd f_of_x = mutated.EvaluateEquationAt(x);
+    AGraph::SetRowCaching(false);
+    ASSERT_TRUE(testutils::almost_equal(mutated.EvaluateEquationAt(x),
+                                        f_of_x));
+  }
+
+  TEST_F(AGraphTest, row_cached_evaluation_sees_samples_rewritten_in_place)
+  {
+    Eigen::ArrayXXd x = sample_agraph_1_values.x;
+    AGraph::SetRowCaching(true);
+    sample_agraph_1.EvaluateEquationAt(x);
+    x(5, 0) = 100.0;
+    Eigen::ArrayXXd f_of_x = sample_agraph_1.EvaluateEquationAt(x);
+    AGraph::SetRowCaching(false);
+    Eigen::ArrayXXd expected = (x.col(0) + 1.0).sin() + 1.0;
+    ASSERT_TRUE(testutils::almost_equal(expected, f_of_x));
+  }
+
+  TEST_F(AGraphTest, forward_tape_derivatives_match_interpreter)
+  {
+    Eigen::ArrayXXd x = sample_agraph_1_values.x;
+    AGraph::SetForwardTapeBudget(1 << 20);
+    for (int i = 0; i < 2; ++i)
+    {
+      ASSERT_TRUE(testutils::almost_equal(
+          sample_agraph_1_values.f_of_x,
+          sample_agraph_1.EvaluateEquationAt(x)));
+      EvalAndDerivative df_dc =
+          sample_agraph_1.EvaluateEquationWithLocalOptGradientAt(x);
+      ASSERT_TRUE(testutils::almost_equal(sample_agraph_1_values.f_of_x,
+                                          df_dc.first));
+      ASSERT_TRUE(testutils::almost_equal(sample_agraph_1_values.grad_c,
+                                          df_dc.second));
+      EvalAndDerivative df_dx =
+          sample_agraph_1.EvaluateEquationWithXGradientAt(x);
+      ASSERT_TRUE(testutils::almost_equal(sample_agraph_1_values.grad_x,
+                                          df_dx.second));
+      // tapes that do not fit are not kept
+      AGraph::SetForwardTapeBudget(1);
+    }
+    AGraph::SetForwardTapeBudget(0);
+  }
+
+  TEST_F(AGraphTest, forward_tape_is_not_reused_for_samples_rewritten_in_place)
+  {
+    Eigen::ArrayXXd x = sample_agraph_1_values.x;
+    AGraph::SetForwardTapeBudget(1 << 20);
+    sample_agraph_1.EvaluateEquationAt(x);
+    x(5, 0) = 100.0;
+    EvalAndDerivative df_dc =
+        sample_agraph_1.EvaluateEquationWithLocalOptGradientAt(x);
+    AGraph::SetForwardTapeBudget(0);
+    Eigen::ArrayXXd expected_f = (x.col(0) + 1.0).sin() + 1.0;
+    Eigen::ArrayXXd expected_df_dc = (x.col(0) + 1.0).cos() + 1.0;
+    ASSERT_TRUE(testutils::almost_equal(expected_f, df_dc.first));
+    ASSERT_TRUE(testutils::almost_equal(expected_df_dc, df_dc.second));
+  }
+
   TEST_F(AGraphTest, setting_fitness_updates_fit_set)
   {
     AGraph new_graph = AGraph(false);
@@ -43,6 +43,38 @@ TEST_F(TestExplicitRegression, EvaluateIndividualFitness) {
   ASSERT_EQ(regressor.GetEvalCount(), 1);
 }
 
+TEST_F(TestExplicitRegression, EvaluateIndividualFitnessWithFastAccuracy) {
+  ExplicitRegression regressor(training_data_);
+  regressor.SetAccuracy(evaluation_backend::kFast);
+  ASSERT_EQ(regressor.GetAccuracy(), evaluation_backend::kFast);
+  double fitness = regressor.EvaluateIndividualFitness(sum_equation_);
+  ASSERT_NEAR(fitness, 2.5, 1e-10);
+  ASSERT_EQ(evaluation_backend::ThreadWorkspace().GetAccuracy(),
+            evaluation_backend::kStrict);
+}
+
+TEST_F(TestExplicitRegression, EvaluateIndividualFitnessInSinglePrecision) {
+  ExplicitRegression regressor(training_data_);
+  regressor.SetPrecision(evaluation_backend::kSingle);
+  double fitness = regressor.EvaluateIndividualFitness(sum_equation_);
+  ASSERT_NEAR(fitness, 2.5, 1e-5);
+  ExplicitTrainingData *regressor_data =
+      (ExplicitTrainingData *)regressor.GetTrainingData();
+  ASSERT_TRUE(testutils::almost_equal(
+      regressor_data->GetXSingle().cast<double>(), regressor_data->x));
+}
+
+TEST_F(TestExplicitRegression, SinglePrecisionXFollowsReassignedX) {
+  ExplicitTrainingData data(*training_data_);
+  data.GetXSingle();
+  data.x(0, 0) += 1.0;
+  ASSERT_TRUE(testutils::almost_equal(data.GetXSingle().cast<double>(),
+                                      data.x));
+  data = ExplicitTrainingData(data.x.topRows(2), data.y.topRows(2));
+  ASSERT_TRUE(testutils::almost_equal(data.GetXSingle().cast<double>(),
+                                      data.x));
+}
+
 TEST_F(TestExplicitRegression, EvaluateIndividualFitnessRelative) {
   ExplicitRegression regressor(training_data_, "mae", true);
   ASSERT_EQ(regressor.GetEvalCount(), 0);
@@ -51,6 +83,14 @@ TEST_F(TestExplicitRegression, EvaluateIndividualFitnessRelative) {
   ASSERT_EQ(regressor.GetEvalCount(), 1);
 }
 
+TEST_F(TestExplicitRegression, RelativeChangesConfiguration) {
+  ExplicitRegression absolute(training_data_, "mae");
+  ExplicitRegression relative(training_data_, "mae", true);
+  ASSERT_NE(absolute.GetConfiguration(), relative.GetConfiguration());
+  ASSERT_EQ(absolute.GetConfiguration(),
+            ExplicitRegression(training_data_).GetConfiguration());
+}
+
 TEST_F(TestExplicitRegression, EvaluateIndividualFitnessWithNaN) {
   training_data_->x(0, 0) = std::numeric_limits<double>::quiet_NaN();
   ExplicitRegression regressor(training_data_);
@@ -118,6 +158,24 @@ TEST_F(TestExplicitRegression, GetFitnessVectorAndJacobianRelative) {
   ASSERT_EQ(regressor.GetEvalCount(), 1);
 }
 
+TEST_F(TestExplicitRegression, GetFitnessVectorAndNormalEquationsRelative) {
+  ExplicitRegression regressor(training_data_, "mae", true);
+  Eigen::ArrayXd expected_fitness_vector = Eigen::ArrayXd::Constant(10, 1, 1.0);
+  Eigen::MatrixXd expected_jacobian_product = Eigen::MatrixXd::Constant(5, 5, 10.0/6.25);
+  Eigen::VectorXd expected_residual_product = Eigen::VectorXd::Constant(5, 10.0/2.5);
+
+  Eigen::ArrayXd fitness_vector;
+  Eigen::MatrixXd jacobian_product;
+  Eigen::VectorXd residual_product;
+  std::tie(fitness_vector, jacobian_product, residual_product) =
+      regressor.GetFitnessVectorAndNormalEquations(sum_equation_);
+
+  ASSERT_TRUE(expected_fitness_vector.isApprox(fitness_vector));
+  ASSERT_TRUE(expected_jacobian_product.isApprox(jacobian_product));
+  ASSERT_TRUE(expected_residual_product.isApprox(residual_product));
+  ASSERT_EQ(regressor.GetEvalCount(), 1);
+}
+
 TEST_F(TestExplicitRegression, GetSubsetOfTrainingData) {
   Eigen::ArrayXXd data_input = Eigen::ArrayXd::LinSpaced(5, 0, 4);
   ExplicitTrainingData* training_data = new ExplicitTrainingData(data_input, data_input);
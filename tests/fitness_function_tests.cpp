@@ -1,10 +1,12 @@
 #include <cmath>
+#include <memory>
 #include <stdexcept>
 
 #include <gtest/gtest.h>
 #include <Eigen/Dense>
 
 #include <bingocpp/equation.h>
+#include <bingocpp/fitness_cache.h>
 #include <bingocpp/fitness_function.h>
 #include <bingocpp/training_data.h>
 
@@ -42,6 +44,12 @@ class SampleFitnessFunction : public bingo::VectorBasedFunction {
         individual.EvaluateEquationAt(((SampleTrainingData*)training_data_)->x);
     return f_of_x - ((SampleTrainingData*)training_data_)->y;
   }
+  std::vector<bingo::evaluation_backend::DatasetFingerprint>
+  FingerprintTrainingData() const {
+    const SampleTrainingData *data = (SampleTrainingData*)training_data_;
+    return {bingo::evaluation_backend::DatasetFingerprint(data->x),
+            bingo::evaluation_backend::DatasetFingerprint(data->y)};
+  }
 };
 
 class TestFitnessFunction : public testing::Test {
@@ -97,4 +105,81 @@ TEST_F(TestFitnessFunction, CorrectMetricSet) {
               rmse.EvaluateIndividualFitness(agraph),
               error_tol);
 }
+TEST_F(TestFitnessFunction, FitnessCacheSkipsKnownIndividuals) {
+  std::shared_ptr<bingo::FitnessCache> cache =
+      std::make_shared<bingo::FitnessCache>();
+  sample_fitness_function_->SetFitnessCache(cache);
+  bingo::AGraph agraph = testutils::init_sample_agraph_1();
+  double fitness = sample_fitness_function_->EvaluateIndividualFitness(agraph);
+  ASSERT_EQ(cache->GetNumMisses(), 1);
+
+  // only an unused command differs
+  bingo::AGraph offspring = agraph.Copy();
+  offspring.GetCommandArrayModifiable().row(4) << 3, 0, 1;
+  ASSERT_EQ(offspring.GetStructuralHash(), agraph.GetStructuralHash());
+  ASSERT_DOUBLE_EQ(
+      sample_fitness_function_->EvaluateIndividualFitness(offspring), fitness);
+  ASSERT_EQ(cache->GetNumHits(), 1);
+
+  Eigen::VectorXd constants(1);
+  constants << 2.0;
+  offspring.SetLocalOptimizationParams(constants);
+  sample_fitness_function_->EvaluateIndividualFitness(offspring);
+  ASSERT_EQ(cache->GetNumMisses(), 2);
+  ASSERT_EQ(cache->GetSize(), 2);
+}
+
+TEST_F(TestFitnessFunction, FitnessCacheMissesWhenTrainingDataChanges) {
+  std::shared_ptr<bingo::FitnessCache> cache =
+      std::make_shared<bingo::FitnessCache>();
+  sample_fitness_function_->SetFitnessCache(cache);
+  bingo::AGraph agraph = testutils::init_sample_agraph_1();
+  double fitness = sample_fitness_function_->EvaluateIndividualFitness(agraph);
+
+  // rewritten in place
+  training_data_.y(0, 0) += 1.0;
+  double rewritten_fitness =
+      sample_fitness_function_->EvaluateIndividualFitness(agraph);
+  ASSERT_EQ(cache->GetNumHits(), 0);
+  ASSERT_NE(rewritten_fitness, fitness);
+
+  // replaced by other data at the same address
+  Eigen::ArrayXXd x = training_data_.x.topRows(2);
+  Eigen::ArrayXXd y = training_data_.y.topRows(2);
+  training_data_ = SampleTrainingData(x, y);
+  sample_fitness_function_->EvaluateIndividualFitness(agraph);
+  ASSERT_EQ(cache->GetNumHits(), 0);
+  ASSERT_EQ(cache->GetNumMisses(), 3);
+
+  sample_fitness_function_->EvaluateIndividualFitness(agraph);
+  ASSERT_EQ(cache->GetNumHits(), 1);
+}
+
+TEST_F(TestFitnessFunction, FitnessCacheEvictsLeastRecentlyUsed) {
+  std::shared_ptr<bingo::FitnessCache> cache =
+      std::make_shared<bingo::FitnessCache>(1);
+  sample_fitness_function_->SetFitnessCache(cache);
+  bingo::AGraph first = testutils::init_sample_agraph_1();
+  bingo::AGraph second = testutils::init_sample_agraph_2();
+  sample_fitness_function_->EvaluateIndividualFitness(first);
+  sample_fitness_function_->EvaluateIndividualFitness(second);
+  sample_fitness_function_->EvaluateIndividualFitness(first);
+  ASSERT_EQ(cache->GetNumHits(), 0);
+  ASSERT_EQ(cache->GetNumMisses(), 3);
+  ASSERT_EQ(cache->GetSize(), 1);
+}
+
+TEST_F(TestFitnessFunction, FitnessCacheIsNotSharedAcrossMetrics) {
+  std::shared_ptr<bingo::FitnessCache> cache =
+      std::make_shared<bingo::FitnessCache>();
+  SampleFitnessFunction mse(&training_data_, "mse");
+  sample_fitness_function_->SetFitnessCache(cache);
+  mse.SetFitnessCache(cache);
+  bingo::AGraph agraph = testutils::init_sample_agraph_1();
+  double fitness = sample_fitness_function_->EvaluateIndividualFitness(agraph);
+  double mse_fitness = mse.EvaluateIndividualFitness(agraph);
+  ASSERT_EQ(cache->GetNumHits(), 0);
+  ASSERT_NE(fitness, mse_fitness);
+  ASSERT_EQ(cache->GetSize(), 2);
+}
 } // namespace (anonymous)
\ No newline at end of file
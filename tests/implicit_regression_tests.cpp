@@ -1,4 +1,5 @@
 #include <cmath>
+#include <stdexcept>
 
 #include "gtest/gtest.h"
 #include <Eigen/Dense>
@@ -97,6 +98,19 @@ class ImplicitRegressionTest : public ImplicitRegressionFixture,
   }
 };
 
+TEST_F(ImplicitRegressionTest, RequiredParamsChangeConfiguration) {
+  ImplicitRegression regressor(training_data_);
+  ImplicitRegression required(training_data_, 4);
+  ASSERT_NE(regressor.GetConfiguration(), required.GetConfiguration());
+}
+
+TEST_F(ImplicitRegressionTest, SinglePrecisionIsRejected) {
+  ImplicitRegression regressor(training_data_);
+  ASSERT_THROW(regressor.SetPrecision(evaluation_backend::kSingle),
+               std::invalid_argument);
+  ASSERT_EQ(regressor.GetPrecision(), evaluation_backend::kDouble);
+}
+
 TEST_F(ImplicitRegressionTest, GetSubsetOfData) {
   auto data_input = Eigen::ArrayXd::LinSpaced(5, 0, 4);
   auto training_data = new ImplicitTrainingData(data_input, data_input);
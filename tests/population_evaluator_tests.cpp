@@ -0,0 +1,213 @@
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <Eigen/Dense>
+
+#include <bingocpp/agraph/agraph.h>
+#include <bingocpp/explicit_regression.h>
+#include <bingocpp/population_evaluator.h>
+
+#include "test_fixtures.h"
+#include "testing_utils.h"
+
+using namespace bingo;
+
+namespace {
+
+class TestPopulationEvaluator : public testing::Test {
+ public:
+  std::vector<AGraph> population_;
+  Eigen::ArrayXXd x_;
+
+  void SetUp() {
+    AGraph agraph_1 = testutils::init_sample_agraph_1();
+    AGraph agraph_2 = testutils::init_sample_agraph_2();
+    population_ = {agraph_1, agraph_2, agraph_1.Copy(), agraph_2};
+    for (AGraph &individual : population_) {
+      individual.SetFitnessStatus(false);
+    }
+    x_ = testutils::one_to_nine_3_by_3();
+  }
+};
+
+TEST_F(TestPopulationEvaluator, EvaluatePopulationAt) {
+  PopulationEvaluator evaluator;
+  std::vector<Eigen::ArrayXXd> outputs =
+      evaluator.EvaluatePopulationAt(population_, x_);
+  ASSERT_EQ(outputs.size(), population_.size());
+  for (std::size_t i = 0; i < population_.size(); ++i) {
+    ASSERT_TRUE(testutils::almost_equal(
+        outputs[i], population_[i].EvaluateEquationAt(x_)));
+  }
+}
+
+TEST_F(TestPopulationEvaluator, DuplicatesAreEvaluatedOnce) {
+  PopulationEvaluator evaluator;
+  evaluator.EvaluatePopulationAt(population_, x_);
+  ASSERT_EQ(evaluator.GetNumEvaluated(), 2);
+
+  Eigen::VectorXd constants(1);
+  constants << 2.0;
+  population_[2].SetLocalOptimizationParams(constants);
+  evaluator.EvaluatePopulationAt(population_, x_);
+  ASSERT_EQ(evaluator.GetNumEvaluated(), 3);
+}
+
+TEST_F(TestPopulationEvaluator, EvaluatePopulationFitness) {
+  Eigen::ArrayXXd y = Eigen::ArrayXXd::Constant(3, 1, 2.5);
+  ExplicitTrainingData training_data(x_, y);
+  ExplicitRegression regressor(&training_data);
+  std::vector<double> expected;
+  for (AGraph &individual : population_) {
+    expected.push_back(regressor.EvaluateIndividualFitness(individual));
+  }
+  population_[3].SetFitness(-1.0);
+  expected[3] = -1.0;
+
+  PopulationEvaluator evaluator;
+  Eigen::ArrayXd fitness =
+      evaluator.EvaluatePopulationFitness(population_, regressor);
+  ASSERT_EQ(evaluator.GetNumEvaluated(), 2);
+  for (std::size_t i = 0; i < population_.size(); ++i) {
+    ASSERT_TRUE(population_[i].IsFitnessSet());
+    ASSERT_NEAR(fitness(i), expected[i], 1e-10);
+    ASSERT_DOUBLE_EQ(population_[i].GetFitness(), fitness(i));
+  }
+}
+TEST_F(TestPopulationEvaluator, ParallelMatchesSerial) {
+  std::vector<AGraph> population;
+  for (int i = 0; i < 50; ++i) {
+    AGraph individual = (i % 2) ? testutils::init_sample_agraph_1()
+                                : testutils::init_sample_agraph_2();
+    Eigen::VectorXd constants =
+        Eigen::VectorXd::Constant(individual.GetNumberLocalOptimizationParams(),
+                                  1.0 + i);
+    individual.SetLocalOptimizationParams(constants);
+    population.push_back(individual);
+  }
+  PopulationEvaluator serial;
+  PopulationEvaluator parallel(4);
+  ASSERT_EQ(parallel.GetNumThreads(), 4);
+  std::vector<Eigen::ArrayXXd> expected =
+      serial.EvaluatePopulationAt(population, x_);
+  std::vector<Eigen::ArrayXXd> outputs =
+      parallel.EvaluatePopulationAt(population, x_);
+  ASSERT_EQ(parallel.GetNumEvaluated(), 50);
+  for (std::size_t i = 0; i < population.size(); ++i) {
+    ASSERT_TRUE(testutils::almost_equal(outputs[i], expected[i]));
+  }
+}
+
+TEST_F(TestPopulationEvaluator, ConcurrentCallersAreSerialized) {
+  PopulationEvaluator evaluator(3);
+  std::vector<AGraph> other_population = {population_[1], population_[0]};
+  std::vector<std::vector<Eigen::ArrayXXd>> outputs(2);
+  auto evaluate = [&](std::vector<AGraph> &population, int caller) {
+    for (int i = 0; i < 50; ++i) {
+      outputs[caller] = evaluator.EvaluatePopulationAt(population, x_);
+    }
+  };
+  std::thread first(evaluate, std::ref(population_), 0);
+  std::thread second(evaluate, std::ref(other_population), 1);
+  first.join();
+  second.join();
+  ASSERT_EQ(outputs[0].size(), population_.size());
+  ASSERT_EQ(outputs[1].size(), other_population.size());
+  for (std::size_t i = 0; i < population_.size(); ++i) {
+    ASSERT_TRUE(testutils::almost_equal(
+        outputs[0][i], population_[i].EvaluateEquationAt(x_)));
+  }
+  for (std::size_t i = 0; i < other_population.size(); ++i) {
+    ASSERT_TRUE(testutils::almost_equal(
+        outputs[1][i], other_population[i].EvaluateEquationAt(x_)));
+  }
+}
+
+TEST_F(TestPopulationEvaluator, SharedSubexpressionsMatchEvaluation) {
+  std::shared_ptr<evaluation_backend::SubexpressionCache> cache =
+      std::make_shared<evaluation_backend::SubexpressionCache>();
+  PopulationEvaluator evaluator(3);
+  evaluator.SetSubexpressionCache(cache);
+  std::vector<Eigen::ArrayXXd> outputs =
+      evaluator.EvaluatePopulationAt(population_, x_);
+  for (std::size_t i = 0; i < population_.size(); ++i) {
+    ASSERT_EQ(population_[i].GetSubexpressionCache(), nullptr);
+    ASSERT_TRUE(testutils::almost_equal(
+        outputs[i], population_[i].EvaluateEquationAt(x_)));
+  }
+  ASSERT_EQ(cache->GetNumHits(), 0);
+
+  // the next generation reads the equations from the cache
+  long num_misses = cache->GetNumMisses();
+  outputs = evaluator.EvaluatePopulationAt(population_, x_);
+  ASSERT_EQ(cache->GetNumHits(), 2);
+  ASSERT_EQ(cache->GetNumMisses(), num_misses);
+  for (std::size_t i = 0; i < population_.size(); ++i) {
+    ASSERT_TRUE(testutils::almost_equal(
+        outputs[i], population_[i].EvaluateEquationAt(x_)));
+  }
+}
+
+TEST_F(TestPopulationEvaluator, SharedSubexpressionsSeeRewrittenSamples) {
+  std::shared_ptr<evaluation_backend::SubexpressionCache> cache =
+      std::make_shared<evaluation_backend::SubexpressionCache>();
+  PopulationEvaluator evaluator;
+  evaluator.SetSubexpressionCache(cache);
+  evaluator.EvaluatePopulationAt(population_, x_);
+  x_(1, 0) = 100.0;
+  std::vector<Eigen::ArrayXXd> outputs =
+      evaluator.EvaluatePopulationAt(population_, x_);
+  for (std::size_t i = 0; i < population_.size(); ++i) {
+    ASSERT_TRUE(testutils::almost_equal(
+        outputs[i], population_[i].EvaluateEquationAt(x_)));
+  }
+}
+
+class ThrowingFitness : public FitnessFunction {
+ public:
+  double EvaluateIndividualFitness(Equation &) const {
+    throw std::runtime_error("fitness failed");
+  }
+};
+
+TEST_F(TestPopulationEvaluator, FailedEvaluationRestoresSubexpressionCaches) {
+  PopulationEvaluator evaluator(3);
+  evaluator.SetSubexpressionCache(
+      std::make_shared<evaluation_backend::SubexpressionCache>());
+  ThrowingFitness fitness_function;
+  ASSERT_THROW(evaluator.EvaluatePopulationFitness(population_,
+                                                   fitness_function),
+               std::runtime_error);
+  for (const AGraph &individual : population_) {
+    ASSERT_EQ(individual.GetSubexpressionCache(), nullptr);
+  }
+}
+
+TEST_F(TestPopulationEvaluator, ParallelFitnessAndGradient) {
+  Eigen::ArrayXXd y = Eigen::ArrayXXd::Constant(3, 1, 2.5);
+  ExplicitTrainingData training_data(x_, y);
+  ExplicitRegression regressor(&training_data, "mse");
+
+  PopulationEvaluator evaluator(3);
+  std::vector<FitnessAndGradient> results =
+      evaluator.EvaluatePopulationFitnessAndGradient(population_, regressor);
+  ASSERT_EQ(evaluator.GetNumEvaluated(), 2);
+  ASSERT_EQ(regressor.GetEvalCount(), 2);
+  for (std::size_t i = 0; i < population_.size(); ++i) {
+    FitnessAndGradient expected =
+        regressor.GetIndividualFitnessAndGradient(population_[i]);
+    ASSERT_NEAR(std::get<0>(results[i]), std::get<0>(expected), 1e-10);
+    ASSERT_TRUE(testutils::almost_equal(std::get<1>(results[i]),
+                                        std::get<1>(expected)));
+  }
+
+  Eigen::ArrayXd fitness =
+      evaluator.EvaluatePopulationFitness(population_, regressor);
+  for (std::size_t i = 0; i < population_.size(); ++i) {
+    ASSERT_NEAR(fitness(i), std::get<0>(results[i]), 1e-10);
+  }
+}
+} // namespace
@@ -0,0 +1,43 @@
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <bingocpp/work_stealing_pool.h>
+
+using namespace bingo;
+
+namespace {
+
+TEST(WorkStealingPoolTest, RunsEveryTaskOnce) {
+  WorkStealingPool pool(4);
+  std::vector<int> order;
+  for (int i = 0; i < 1000; ++i) {
+    order.push_back(i);
+  }
+  std::vector<std::atomic<int>> counts(order.size());
+  for (int batch = 0; batch < 3; ++batch) {
+    pool.Run(order, [&counts](int i) { ++counts[i]; });
+  }
+  for (const std::atomic<int> &count : counts) {
+    ASSERT_EQ(count.load(), 3);
+  }
+}
+
+TEST(WorkStealingPoolTest, RethrowsTaskException) {
+  WorkStealingPool pool(3);
+  std::vector<int> order = {0, 1, 2, 3, 4, 5};
+  std::atomic<int> num_run(0);
+  ASSERT_THROW(pool.Run(order, [&num_run](int i) {
+                 ++num_run;
+                 if (i == 2) {
+                   throw std::runtime_error("task failed");
+                 }
+               }),
+               std::runtime_error);
+  ASSERT_EQ(num_run.load(), 6);
+  pool.Run(order, [&num_run](int) { ++num_run; });
+  ASSERT_EQ(num_run.load(), 12);
+}
+} // namespace